@@ -0,0 +1,253 @@
+/*
+ *  ======== adc_stream.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Driver Header files */
+#include <ti/drivers/ADCBuf.h>
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+
+#include "adc_stream.h"
+
+/* Largest adjusted sample value, used to calibrate the scale */
+#define ADC_STREAM_FULL_SCALE 4095
+
+/*
+ * The driver callback fills in slot done % 2 and increments done; the
+ * task side delivers block taken and increments taken, so done - taken
+ * is the number of completed blocks not yet delivered. More than one
+ * means the DMA has already started overwriting the older buffer.
+ */
+static struct
+{
+    ADCBuf_Handle handle;
+    ADCBuf_Conversion conversion;
+    AdcStream_Callback consumer;
+    void (*notify)(void);
+
+    const uint32_t *channels;
+    size_t channelCount;
+    size_t current;
+    uint32_t dwellBlocks;
+    uint32_t dwell;
+    uint32_t scale[ADC_STREAM_MAX_CHANNELS]; /* Microvolts per LSB, Q16 */
+
+    SemaphoreP_Struct semStruct;
+    SemaphoreP_Handle sem;
+
+    volatile uint32_t done;
+    uint32_t taken;
+    uint16_t *completed[2];
+    uint32_t completedChannel[2];
+
+    AdcStream_Stats stats;
+    uint16_t raw[2][ADC_STREAM_BLOCK_SIZE];
+    uint32_t microVolts[ADC_STREAM_BLOCK_SIZE];
+} adcStream __attribute__((aligned(4)));
+
+/*
+ *  ======== adc_stream_callback ========
+ */
+static void adc_stream_callback(ADCBuf_Handle handle,
+                                ADCBuf_Conversion *conversion,
+                                void *completedADCBuffer,
+                                uint32_t completedChannel,
+                                int_fast16_t status)
+{
+    uint32_t slot = adcStream.done % 2;
+
+    if (status != ADCBuf_STATUS_SUCCESS)
+    {
+        adcStream.stats.errors++;
+        return;
+    }
+
+    adcStream.completed[slot]        = completedADCBuffer;
+    adcStream.completedChannel[slot] = completedChannel;
+    adcStream.done++;
+
+    SemaphoreP_post(adcStream.sem);
+    if (adcStream.notify != NULL)
+    {
+        adcStream.notify();
+    }
+}
+
+/*
+ *  ======== adc_stream_calibrate ========
+ *  Fold the driver's reference scaling for channel and
+ *  COMPENSATION_FACTOR into one Q16 factor.
+ */
+static uint32_t adc_stream_calibrate(uint32_t channel)
+{
+    uint16_t fullScale = ADC_STREAM_FULL_SCALE;
+    uint32_t microVolts;
+
+    ADCBuf_convertAdjustedToMicroVolts(adcStream.handle, channel, &fullScale, &microVolts, 1);
+
+    return (uint32_t)((((uint64_t)microVolts * COMPENSATION_FACTOR) << 16) /
+                      (1000ULL * ADC_STREAM_FULL_SCALE));
+}
+
+/*
+ *  ======== adc_stream_toMicroVolts ========
+ */
+static void adc_stream_toMicroVolts(const uint16_t *raw, uint32_t *out, size_t count, uint32_t scale)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        out[i] = (uint32_t)(((uint64_t)raw[i] * scale + 0x8000) >> 16);
+    }
+}
+
+/*
+ *  ======== adc_stream_convert ========
+ */
+static bool adc_stream_convert(void)
+{
+    adcStream.conversion.adcChannel = adcStream.channels[adcStream.current];
+    adcStream.dwell                 = 0;
+    adcStream.taken                 = adcStream.done;
+
+    if (ADCBuf_convert(adcStream.handle, &adcStream.conversion, 1) != ADCBuf_STATUS_SUCCESS)
+    {
+        adcStream.stats.errors++;
+        return false;
+    }
+
+    return true;
+}
+
+bool adc_stream_start(uint_least8_t index,
+                      const uint32_t *channels,
+                      size_t channelCount,
+                      uint32_t dwellBlocks,
+                      uint32_t sampleRateHz,
+                      AdcStream_Callback consumer)
+{
+    ADCBuf_Params params;
+    size_t i;
+
+    if (channelCount == 0 || channelCount > ADC_STREAM_MAX_CHANNELS)
+    {
+        return false;
+    }
+
+    if (adcStream.sem == NULL)
+    {
+        adcStream.sem = SemaphoreP_constructBinary(&adcStream.semStruct, 0);
+    }
+
+    ADCBuf_Params_init(&params);
+    params.returnMode        = ADCBuf_RETURN_MODE_CALLBACK;
+    params.recurrenceMode    = ADCBuf_RECURRENCE_MODE_CONTINUOUS;
+    params.callbackFxn       = adc_stream_callback;
+    params.samplingFrequency = sampleRateHz;
+
+    adcStream.handle = ADCBuf_open(index, &params);
+    if (adcStream.handle == NULL)
+    {
+        return false;
+    }
+
+    adcStream.channels     = channels;
+    adcStream.channelCount = channelCount;
+    adcStream.current      = 0;
+    adcStream.dwellBlocks  = (dwellBlocks != 0) ? dwellBlocks : 1;
+    adcStream.consumer     = consumer;
+
+    for (i = 0; i < channelCount; i++)
+    {
+        adcStream.scale[i] = adc_stream_calibrate(channels[i]);
+    }
+
+    adcStream.conversion.arg                   = NULL;
+    adcStream.conversion.sampleBuffer          = adcStream.raw[0];
+    adcStream.conversion.sampleBufferTwo       = adcStream.raw[1];
+    adcStream.conversion.samplesRequestedCount = ADC_STREAM_BLOCK_SIZE;
+
+    if (!adc_stream_convert())
+    {
+        ADCBuf_close(adcStream.handle);
+        adcStream.handle = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void adc_stream_process(uint32_t timeoutMs)
+{
+    AdcStream_Block block;
+    uint32_t slot;
+
+    if (adcStream.handle == NULL)
+    {
+        return;
+    }
+
+    if (adcStream.done == adcStream.taken)
+    {
+        SemaphoreP_pend(adcStream.sem, (timeoutMs * 1000) / ClockP_getSystemTickPeriod());
+    }
+
+    while (adcStream.taken != adcStream.done)
+    {
+        /* Only the newest block is still intact */
+        if (adcStream.done - adcStream.taken > 1)
+        {
+            adcStream.stats.overruns += adcStream.done - adcStream.taken - 1;
+            adcStream.taken           = adcStream.done - 1;
+        }
+
+        slot          = adcStream.taken % 2;
+        block.seq     = adcStream.taken;
+        block.channel = adcStream.completedChannel[slot];
+        block.raw     = adcStream.completed[slot];
+        block.count   = ADC_STREAM_BLOCK_SIZE;
+
+        ADCBuf_adjustRawValues(adcStream.handle, adcStream.completed[slot], ADC_STREAM_BLOCK_SIZE, block.channel);
+        adc_stream_toMicroVolts(block.raw, adcStream.microVolts, block.count, adcStream.scale[adcStream.current]);
+        block.microVolts = adcStream.microVolts;
+
+        adcStream.consumer(&block);
+        adcStream.taken++;
+        adcStream.stats.blocks++;
+
+        /* Move the scan on to the next channel */
+        if (adcStream.channelCount > 1 && ++adcStream.dwell >= adcStream.dwellBlocks)
+        {
+            ADCBuf_convertCancel(adcStream.handle);
+            adcStream.current = (adcStream.current + 1) % adcStream.channelCount;
+            adc_stream_convert();
+            return;
+        }
+    }
+}
+
+void adc_stream_stop(void)
+{
+    if (adcStream.handle == NULL)
+    {
+        return;
+    }
+
+    ADCBuf_convertCancel(adcStream.handle);
+    ADCBuf_close(adcStream.handle);
+    adcStream.handle = NULL;
+}
+
+void adc_stream_setNotify(void (*notify)(void))
+{
+    adcStream.notify = notify;
+}
+
+void adc_stream_getStats(AdcStream_Stats *stats)
+{
+    *stats = adcStream.stats;
+}
@@ -0,0 +1,90 @@
+/*
+ *  ======== adc_stream.h ========
+ *  Continuous ADC acquisition through ADCBuf.
+ *
+ *  ADCBuf runs in continuous callback mode with two sample buffers: the
+ *  DMA fills one while the other, just completed, is handed on. The
+ *  driver callback only records which block finished; adc_stream_process()
+ *  converts the block to microvolts in the caller's task and passes it to
+ *  the consumer callback, which has one block period to return before
+ *  that buffer is refilled. A block that completes while the previous one
+ *  in the same buffer has not been taken is counted as an overrun.
+ *
+ *  ADCBufCC26XX converts one channel at a time, so several channels are
+ *  scanned block-wise: each is sampled for dwellBlocks blocks, then the
+ *  conversion is restarted on the next one from adc_stream_process().
+ *
+ *  Microvolts are computed as adjusted * scale >> 16 with scale taken
+ *  from the driver's own conversion of full scale and COMPENSATION_FACTOR
+ *  folded in, so each sample costs one multiply instead of a driver call.
+ */
+#ifndef ADC_STREAM_H_
+#define ADC_STREAM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ti/devices/DeviceFamily.h>
+
+/* Samples per block */
+#ifndef ADC_STREAM_BLOCK_SIZE
+    #define ADC_STREAM_BLOCK_SIZE 64
+#endif
+
+#ifndef ADC_STREAM_MAX_CHANNELS
+    #define ADC_STREAM_MAX_CHANNELS 4
+#endif
+
+/* Inputs to the ADC on the CC32XX launchpads are downscaled by a factor of 0.42
+ * Multiplying the conversion output with 2.365 will provide compensated output.
+ */
+#ifndef COMPENSATION_FACTOR
+    #if DeviceFamily_PARENT == DeviceFamily_PARENT_CC32XX
+        #define COMPENSATION_FACTOR 2365
+    #else
+        #define COMPENSATION_FACTOR 1000
+    #endif
+#endif
+
+typedef struct
+{
+    uint32_t seq;                 /* Blocks completed before this one */
+    uint32_t channel;             /* ADCBuf channel index */
+    const uint16_t *raw;          /* Gain/offset adjusted samples */
+    const uint32_t *microVolts;
+    size_t count;
+} AdcStream_Block;
+
+typedef void (*AdcStream_Callback)(const AdcStream_Block *block);
+
+typedef struct
+{
+    uint32_t blocks;      /* Blocks delivered */
+    uint32_t overruns;    /* Blocks lost because the consumer fell behind */
+    uint32_t errors;      /* Driver errors and failed restarts */
+} AdcStream_Stats;
+
+/*
+ * Open ADCBuf index and start sampling channels[0] at sampleRateHz.
+ * With more than one channel, each is sampled for dwellBlocks blocks in
+ * turn. consumer runs from adc_stream_process().
+ */
+bool adc_stream_start(uint_least8_t index,
+                      const uint32_t *channels,
+                      size_t channelCount,
+                      uint32_t dwellBlocks,
+                      uint32_t sampleRateHz,
+                      AdcStream_Callback consumer);
+
+/* Wait up to timeoutMs for a block and deliver every completed one */
+void adc_stream_process(uint32_t timeoutMs);
+
+void adc_stream_stop(void);
+
+/* Have notify called from the driver callback as each block completes */
+void adc_stream_setNotify(void (*notify)(void));
+
+void adc_stream_getStats(AdcStream_Stats *stats);
+
+#endif /* ADC_STREAM_H_ */
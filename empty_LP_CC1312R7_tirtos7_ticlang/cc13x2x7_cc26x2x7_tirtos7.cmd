@@ -108,6 +108,8 @@ SECTIONS
     .ramVecs        :   > SRAM, type = NOLOAD, ALIGN(256)
     .data           :   > SRAM
     .bss            :   > SRAM
+    /* Kept across resets, e.g. the watchdog supervisor's loop statistics */
+    .noinit         :   > SRAM, type = NOINIT
     .sysmem         :   > SRAM
     .stack          :   > SRAM (HIGH)
     .nonretenvar    :   > SRAM
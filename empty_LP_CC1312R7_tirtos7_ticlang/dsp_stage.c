@@ -0,0 +1,157 @@
+/*
+ *  ======== dsp_stage.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+    #include <arm_acle.h>
+    #define DSP_STAGE_SIMD 1
+#endif
+
+#include "dsp_stage.h"
+
+/*
+ *  ======== dsp_stage_isqrt ========
+ */
+static uint32_t dsp_stage_isqrt(uint64_t x)
+{
+    uint64_t bit = (uint64_t)1 << 62;
+    uint64_t res = 0;
+
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+
+    while (bit != 0)
+    {
+        if (x >= res + bit)
+        {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)res;
+}
+
+/*
+ *  ======== dsp_stage_emit ========
+ *  Output one decimated value and check it against the thresholds.
+ */
+static inline void dsp_stage_emit(DspStage *stage, int32_t acc, int16_t *out, size_t *n, DspStage_Result *result)
+{
+    int16_t y = (int16_t)(acc >> stage->cfg.decimationShift);
+
+    out[(*n)++] = y;
+
+    if (!stage->above && y > stage->cfg.thresholdHigh)
+    {
+        stage->above = true;
+        result->events |= DSP_STAGE_EVENT_HIGH;
+    }
+    else if (stage->above && y < stage->cfg.thresholdLow)
+    {
+        stage->above = false;
+        result->events |= DSP_STAGE_EVENT_LOW;
+    }
+}
+
+void dsp_stage_init(DspStage *stage, const DspStage_Config *cfg)
+{
+    memset(stage, 0, sizeof(*stage));
+    stage->cfg = *cfg;
+}
+
+size_t dsp_stage_process(DspStage *stage, const int16_t *in, size_t count, int16_t *out, DspStage_Result *result)
+{
+    uint32_t length = 1u << stage->cfg.decimationShift;
+    int32_t acc     = stage->acc;
+    uint32_t phase  = stage->phase;
+    int64_t sumSq   = 0;
+    int32_t min     = INT16_MAX;
+    int32_t max     = INT16_MIN;
+    int64_t blockMeanSquare;
+    size_t n = 0;
+    size_t i;
+
+#if DSP_STAGE_SIMD
+    int16x2_t offset = (int16x2_t)(((uint32_t)(uint16_t)stage->cfg.offset << 16) | (uint16_t)stage->cfg.offset);
+    int16x2_t ones   = 0x00010001;
+    int16x2_t x;
+    int16_t lo;
+    int16_t hi;
+#else
+    int32_t x;
+#endif
+
+    result->events = 0;
+
+#if DSP_STAGE_SIMD
+    for (i = 0; i < count; i += 2)
+    {
+        /* Compiles to a single word load; the block is word aligned */
+        memcpy(&x, &in[i], sizeof(x));
+
+        x     = __qadd16(x, offset);
+        acc   = __smlad(x, ones, acc);
+        sumSq = __smlald(x, x, sumSq);
+
+        lo  = (int16_t)x;
+        hi  = (int16_t)(x >> 16);
+        min = (lo < min) ? lo : min;
+        min = (hi < min) ? hi : min;
+        max = (lo > max) ? lo : max;
+        max = (hi > max) ? hi : max;
+
+        phase += 2;
+        if (phase == length)
+        {
+            dsp_stage_emit(stage, acc, out, &n, result);
+            acc   = 0;
+            phase = 0;
+        }
+    }
+#else
+    for (i = 0; i < count; i++)
+    {
+        x = in[i] + stage->cfg.offset;
+        x = (x > INT16_MAX) ? INT16_MAX : ((x < INT16_MIN) ? INT16_MIN : x);
+
+        acc += x;
+        sumSq += x * x;
+        min = (x < min) ? x : min;
+        max = (x > max) ? x : max;
+
+        if (++phase == length)
+        {
+            dsp_stage_emit(stage, acc, out, &n, result);
+            acc   = 0;
+            phase = 0;
+        }
+    }
+#endif
+
+    stage->acc   = acc;
+    stage->phase = phase;
+
+    if (count != 0)
+    {
+        blockMeanSquare = (sumSq << 8) / (int64_t)count;
+        stage->meanSquare += (blockMeanSquare - stage->meanSquare) >> stage->cfg.rmsShift;
+    }
+
+    result->min = (int16_t)min;
+    result->max = (int16_t)max;
+    result->rms = (uint16_t)(dsp_stage_isqrt((uint64_t)stage->meanSquare) >> 4);
+
+    return n;
+}
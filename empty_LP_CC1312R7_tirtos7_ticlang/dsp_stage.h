@@ -0,0 +1,65 @@
+/*
+ *  ======== dsp_stage.h ========
+ *  Fixed-point reduction of sample blocks.
+ *
+ *  One pass over a block of int16_t samples:
+ *   - adds a saturating offset (e.g. -2048 to centre a 12-bit ADC),
+ *   - boxcar-decimates by 2^decimationShift (a first order CIC, the
+ *     running sum carries over from block to block),
+ *   - tracks the block minimum and maximum,
+ *   - updates a running RMS, smoothed over blocks by 2^-rmsShift,
+ *   - raises threshold events on the decimated output, with hysteresis
+ *     between thresholdLow and thresholdHigh.
+ *
+ *  On cores with the DSP extension (__ARM_FEATURE_DSP, Cortex-M4) two
+ *  samples are handled per step with QADD16, SMLAD and SMLALD; other
+ *  targets use the plain C loop, which gives identical results.
+ *
+ *  Blocks must be 4-byte aligned and hold an even number of samples, and
+ *  decimationShift must be at least 1.
+ */
+#ifndef DSP_STAGE_H_
+#define DSP_STAGE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DSP_STAGE_EVENT_HIGH 0x1 /* Output rose above thresholdHigh */
+#define DSP_STAGE_EVENT_LOW  0x2 /* Output fell below thresholdLow */
+
+typedef struct
+{
+    int16_t offset;
+    uint8_t decimationShift;
+    uint8_t rmsShift;
+    int16_t thresholdHigh;
+    int16_t thresholdLow;
+} DspStage_Config;
+
+typedef struct
+{
+    int16_t min;       /* Of the last block, after the offset */
+    int16_t max;
+    uint16_t rms;      /* Running RMS */
+    uint32_t events;   /* DSP_STAGE_EVENT_* raised by the last block */
+} DspStage_Result;
+
+typedef struct
+{
+    DspStage_Config cfg;
+    int32_t acc;          /* Boxcar sum so far */
+    uint32_t phase;       /* Samples in acc */
+    int64_t meanSquare;   /* Running mean square, Q8 */
+    bool above;           /* Last threshold state */
+} DspStage;
+
+void dsp_stage_init(DspStage *stage, const DspStage_Config *cfg);
+
+/*
+ * Process count samples from in, writing one decimated value to out per
+ * 2^decimationShift input samples. Returns the number written.
+ */
+size_t dsp_stage_process(DspStage *stage, const int16_t *in, size_t count, int16_t *out, DspStage_Result *result);
+
+#endif /* DSP_STAGE_H_ */
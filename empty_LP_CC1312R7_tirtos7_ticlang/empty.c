@@ -52,6 +52,12 @@
 
 #include "test_i2c.h"
 
+#include "test_adc.h"
+
+#include "sched.h"
+
+#include "power_prof.h"
+
 
 /*
  *  ======== gpioButtonIsr ========
@@ -60,6 +66,8 @@ void gpioButtonIsr0(uint_least8_t index)
 {
     GPIO_write(CONFIG_GPIO_LED_1, CONFIG_GPIO_LED_OFF);
 
+    test_uart_bridgeStop();
+
     // while (1) {}
 }
 
@@ -73,11 +81,6 @@ void gpioButtonIsr1(uint_least8_t index)
     // while (1) {} // this will trigger the watchdog
 }
 
-struct _test_empty_
-{
-    /* data */
-} test_empty;
-
 void test_main_init()
 {
     /* Call driver init functions */
@@ -97,29 +100,30 @@ void test_main_init()
     GPIO_enableInt(CONFIG_GPIO_BUTTON_0_INPUT);
     GPIO_enableInt(CONFIG_GPIO_BUTTON_1_INPUT);
 
-    test_wdt_init();
+    power_prof_init();
     test_uart_init();
+    test_wdt_report();
     test_i2c_init();
     test_adc_init();
     test_fatsd_init();
-}
-
-void test_main_loop()
-{
-    test_wdt_loop();
-    test_uart_loop();
     // test_fatsd_loop();
-    // test_i2c_loop();
+    test_fatsd_logStart();
 }
 
 /*
  *  ======== mainThread ========
+ *  Every test module registers a tasklet from its init function; they
+ *  all run from here, woken by their driver callbacks and timers.
+ *
+ *  The watchdog is started last: nothing checks in before sched_run(),
+ *  and init may block for seconds, e.g. while FatFs counts the free
+ *  clusters of a large card.
  */
 void *mainThread(void *arg0)
 {
     test_main_init();
-    while (1)
-    {
-        test_main_loop();
-    }
+    test_wdt_init();
+    sched_run();
+
+    return NULL;
 }
@@ -0,0 +1,298 @@
+/*
+ *  ======== i2c_sampler.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Driver Header files */
+#include <ti/drivers/I2C.h>
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "i2c_sampler.h"
+
+#define I2C_SAMPLER_MASK (I2C_SAMPLER_DEPTH - 1)
+
+#if (I2C_SAMPLER_DEPTH & I2C_SAMPLER_MASK) != 0
+    #error "I2C_SAMPLER_DEPTH must be a power of two"
+#endif
+
+typedef struct
+{
+    const I2cSampler_Config *cfg;
+    I2C_Transaction transaction;
+    uint8_t txBuf[1];
+    uint8_t rxBuf[2];
+    volatile bool busy;
+    volatile bool timedOut;
+    uint32_t dueTick;
+    I2cSampler_DeviceStats stats;
+} I2cSampler_Device;
+
+/*
+ * queue[] lists the devices handed to the driver, in the order it will
+ * run them: poll() adds at qIn, the transfer callback removes at qOut.
+ * activeTick is when the transfer at qOut started, i.e. when the one
+ * before it finished. The sample ring is written by the callback (head)
+ * and read by the task (tail).
+ */
+static struct
+{
+    I2C_Handle handle;
+    size_t count;
+    uint32_t tickPeriod;
+    void (*notify)(void);
+    I2cSampler_Device dev[I2C_SAMPLER_MAX_DEVICES];
+
+    volatile uint32_t qIn;
+    volatile uint32_t qOut;
+    uint8_t queue[I2C_SAMPLER_MAX_DEVICES];
+    volatile uint32_t activeTick;
+
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;
+    I2cSampler_Sample ring[I2C_SAMPLER_DEPTH];
+} i2cSampler;
+
+/*
+ *  ======== i2c_sampler_ticks ========
+ */
+static uint32_t i2c_sampler_ticks(uint32_t ms)
+{
+    return (ms * 1000) / i2cSampler.tickPeriod;
+}
+
+/*
+ *  ======== i2c_sampler_fail ========
+ *  Push the next attempt of dev out by a doubling backoff.
+ */
+static void i2c_sampler_fail(I2cSampler_Device *dev, uint32_t now)
+{
+    if (dev->stats.backoffMs == 0)
+    {
+        dev->stats.backoffMs = I2C_SAMPLER_BACKOFF_MIN_MS;
+    }
+    else if (dev->stats.backoffMs < I2C_SAMPLER_BACKOFF_MAX_MS / 2)
+    {
+        dev->stats.backoffMs *= 2;
+    }
+    else
+    {
+        dev->stats.backoffMs = I2C_SAMPLER_BACKOFF_MAX_MS;
+    }
+
+    dev->stats.failures++;
+    dev->dueTick = now + i2c_sampler_ticks(dev->stats.backoffMs);
+}
+
+/*
+ *  ======== i2c_sampler_callback ========
+ */
+static void i2c_sampler_callback(I2C_Handle handle, I2C_Transaction *transaction, bool transferStatus)
+{
+    I2cSampler_Device *dev = (I2cSampler_Device *)transaction->arg;
+    I2cSampler_Sample *sample;
+    uint32_t now = ClockP_getSystemTicks();
+    uint32_t head;
+
+    i2cSampler.qOut++;
+    i2cSampler.activeTick = now;
+
+    if (transferStatus)
+    {
+        head = i2cSampler.head;
+        if (head - i2cSampler.tail >= I2C_SAMPLER_DEPTH)
+        {
+            i2cSampler.dropped++;
+        }
+        else
+        {
+            sample          = &i2cSampler.ring[head & I2C_SAMPLER_MASK];
+            sample->tick    = now;
+            sample->device  = (uint8_t)(dev - i2cSampler.dev);
+            sample->address = dev->cfg->address;
+            sample->raw     = (int16_t)((dev->rxBuf[0] << 8) | dev->rxBuf[1]);
+
+            __asm volatile("" ::: "memory");
+            i2cSampler.head = head + 1;
+
+            if (i2cSampler.notify != NULL)
+            {
+                i2cSampler.notify();
+            }
+        }
+
+        dev->stats.samples++;
+        dev->stats.failures  = 0;
+        dev->stats.backoffMs = 0;
+
+        /* Keep the cadence, but do not try to catch up after a stall */
+        dev->dueTick += i2c_sampler_ticks(dev->cfg->periodMs);
+        if ((int32_t)(now - dev->dueTick) > 0)
+        {
+            dev->dueTick = now;
+        }
+    }
+    else if (transaction->status == I2C_STATUS_CANCEL && !dev->timedOut)
+    {
+        /* Cancelled because another device timed out; retry on the next poll */
+    }
+    else
+    {
+        if (dev->timedOut)
+        {
+            dev->stats.timeouts++;
+        }
+        else
+        {
+            dev->stats.errors++;
+        }
+        i2c_sampler_fail(dev, now);
+    }
+
+    dev->timedOut = false;
+    dev->busy     = false;
+}
+
+bool i2c_sampler_init(uint_least8_t index, const I2cSampler_Config *devices, size_t count)
+{
+    I2C_Params params;
+    I2cSampler_Device *dev;
+    uint32_t now;
+    size_t i;
+
+    if (count > I2C_SAMPLER_MAX_DEVICES)
+    {
+        return false;
+    }
+
+    I2C_Params_init(&params);
+    params.bitRate             = I2C_400kHz;
+    params.transferMode        = I2C_MODE_CALLBACK;
+    params.transferCallbackFxn = i2c_sampler_callback;
+
+    i2cSampler.handle = I2C_open(index, &params);
+    if (i2cSampler.handle == NULL)
+    {
+        return false;
+    }
+
+    i2cSampler.count      = count;
+    i2cSampler.tickPeriod = ClockP_getSystemTickPeriod();
+
+    now = ClockP_getSystemTicks();
+    for (i = 0; i < count; i++)
+    {
+        dev           = &i2cSampler.dev[i];
+        dev->cfg      = &devices[i];
+        dev->txBuf[0] = devices[i].reg;
+        dev->dueTick  = now;
+
+        dev->transaction.targetAddress = devices[i].address;
+        dev->transaction.writeBuf      = dev->txBuf;
+        dev->transaction.writeCount    = 1;
+        dev->transaction.readBuf       = dev->rxBuf;
+        dev->transaction.readCount     = 2;
+        dev->transaction.arg           = dev;
+    }
+
+    return true;
+}
+
+void i2c_sampler_poll(void)
+{
+    I2cSampler_Device *dev;
+    uint32_t now = ClockP_getSystemTicks();
+    bool cancel  = false;
+    uintptr_t key;
+    size_t i;
+
+    /* Cancel the transfer in progress if it has run past its timeout */
+    if (i2cSampler.qIn != i2cSampler.qOut)
+    {
+        key = HwiP_disable();
+        if (i2cSampler.qIn != i2cSampler.qOut)
+        {
+            dev = &i2cSampler.dev[i2cSampler.queue[i2cSampler.qOut % I2C_SAMPLER_MAX_DEVICES]];
+            if (!dev->timedOut && now - i2cSampler.activeTick > i2c_sampler_ticks(dev->cfg->timeoutMs))
+            {
+                dev->timedOut = true;
+                cancel        = true;
+            }
+        }
+        HwiP_restore(key);
+
+        if (cancel)
+        {
+            /* Completes every queued transfer through the callback */
+            I2C_cancel(i2cSampler.handle);
+        }
+    }
+
+    /* Queue every due device in one pass */
+    for (i = 0; i < i2cSampler.count; i++)
+    {
+        dev = &i2cSampler.dev[i];
+        if (dev->busy || (int32_t)(now - dev->dueTick) < 0)
+        {
+            continue;
+        }
+
+        dev->busy = true;
+
+        key = HwiP_disable();
+        if (i2cSampler.qIn == i2cSampler.qOut)
+        {
+            i2cSampler.activeTick = now;
+        }
+        i2cSampler.queue[i2cSampler.qIn % I2C_SAMPLER_MAX_DEVICES] = (uint8_t)i;
+        i2cSampler.qIn++;
+        HwiP_restore(key);
+
+        if (!I2C_transfer(i2cSampler.handle, &dev->transaction))
+        {
+            /* Not queued, so no callback will remove it */
+            key = HwiP_disable();
+            i2cSampler.qIn--;
+            HwiP_restore(key);
+
+            dev->stats.errors++;
+            i2c_sampler_fail(dev, now);
+            dev->busy = false;
+        }
+    }
+}
+
+bool i2c_sampler_read(I2cSampler_Sample *sample)
+{
+    uint32_t tail = i2cSampler.tail;
+
+    if (tail == i2cSampler.head)
+    {
+        return false;
+    }
+
+    *sample = i2cSampler.ring[tail & I2C_SAMPLER_MASK];
+
+    __asm volatile("" ::: "memory");
+    i2cSampler.tail = tail + 1;
+
+    return true;
+}
+
+void i2c_sampler_setNotify(void (*notify)(void))
+{
+    i2cSampler.notify = notify;
+}
+
+uint32_t i2c_sampler_dropped(void)
+{
+    return i2cSampler.dropped;
+}
+
+void i2c_sampler_getStats(size_t device, I2cSampler_DeviceStats *stats)
+{
+    *stats = i2cSampler.dev[device].stats;
+}
@@ -0,0 +1,87 @@
+/*
+ *  ======== i2c_sampler.h ========
+ *  Non-blocking periodic register reads from I2C sensors.
+ *
+ *  The I2C port is opened in I2C_MODE_CALLBACK. Each call to
+ *  i2c_sampler_poll() queues a read for every device that is due in one
+ *  pass, and the driver runs them back to back across the different
+ *  target addresses without the task being involved in between. Results
+ *  are timestamped with the system tick in the transfer callback and put
+ *  in a sample ring for i2c_sampler_read().
+ *
+ *  A device whose transfer fails, or takes longer than its timeout, is
+ *  retried after a backoff that doubles per consecutive failure up to
+ *  I2C_SAMPLER_BACKOFF_MAX_MS, so an absent sensor or a stuck bus costs
+ *  an occasional failed transfer instead of stalling the caller.
+ */
+#ifndef I2C_SAMPLER_H_
+#define I2C_SAMPLER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef I2C_SAMPLER_MAX_DEVICES
+    #define I2C_SAMPLER_MAX_DEVICES 4
+#endif
+
+/* Sample ring depth, must be a power of two */
+#ifndef I2C_SAMPLER_DEPTH
+    #define I2C_SAMPLER_DEPTH 32
+#endif
+
+/* First retry delay after a failure */
+#ifndef I2C_SAMPLER_BACKOFF_MIN_MS
+    #define I2C_SAMPLER_BACKOFF_MIN_MS 100
+#endif
+
+#ifndef I2C_SAMPLER_BACKOFF_MAX_MS
+    #define I2C_SAMPLER_BACKOFF_MAX_MS 10000
+#endif
+
+typedef struct
+{
+    uint8_t address;     /* 7-bit target address */
+    uint8_t reg;         /* Register to read, 2 bytes big-endian */
+    uint16_t periodMs;   /* Sampling period */
+    uint16_t timeoutMs;  /* Longest a transfer may take once started */
+} I2cSampler_Config;
+
+typedef struct
+{
+    uint32_t tick;       /* ClockP system tick at completion */
+    uint8_t device;      /* Index into the config table */
+    uint8_t address;
+    int16_t raw;         /* Register value */
+} I2cSampler_Sample;
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t errors;     /* Transfers that failed */
+    uint32_t timeouts;   /* Transfers cancelled for taking too long */
+    uint32_t failures;   /* Consecutive failures, 0 while healthy */
+    uint32_t backoffMs;  /* Current retry delay, 0 while healthy */
+} I2cSampler_DeviceStats;
+
+/*
+ * Open I2C index in callback mode for the count devices in devices[],
+ * which must stay valid. Nothing is transferred until i2c_sampler_poll().
+ */
+bool i2c_sampler_init(uint_least8_t index, const I2cSampler_Config *devices, size_t count);
+
+/* Queue reads for due devices and cancel overdue transfers; never blocks */
+void i2c_sampler_poll(void);
+
+/* Take the oldest sample; returns false if there is none */
+bool i2c_sampler_read(I2cSampler_Sample *sample);
+
+/* Have notify called from the transfer callback for each new sample */
+void i2c_sampler_setNotify(void (*notify)(void));
+
+/* Samples lost because the ring was full */
+uint32_t i2c_sampler_dropped(void);
+
+void i2c_sampler_getStats(size_t device, I2cSampler_DeviceStats *stats);
+
+#endif /* I2C_SAMPLER_H_ */
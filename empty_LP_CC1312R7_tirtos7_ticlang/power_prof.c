@@ -0,0 +1,239 @@
+/*
+ *  ======== power_prof.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/Power.h>
+#include <ti/drivers/power/PowerCC26X2.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include <ti/devices/DeviceFamily.h>
+#include DeviceFamily_constructPath(driverlib/aon_rtc.h)
+#include DeviceFamily_constructPath(driverlib/cpu.h)
+#include DeviceFamily_constructPath(driverlib/interrupt.h)
+#include DeviceFamily_constructPath(driverlib/prcm.h)
+#include DeviceFamily_constructPath(driverlib/sys_ctrl.h)
+#include DeviceFamily_constructPath(driverlib/vims.h)
+#include DeviceFamily_constructPath(inc/hw_prcm.h)
+#include DeviceFamily_constructPath(inc/hw_types.h)
+
+#include "power_prof.h"
+
+static struct
+{
+    Power_NotifyObj notifyObj;
+    bool started;
+    /* Set by the AWAKE_STANDBY notification during the current sleep */
+    volatile bool standby;
+    volatile uint32_t wakeTime;
+    volatile PowerProf_Wake wakeSource;
+    uint32_t startTime;
+    PowerProf_Stats stats;
+} prof;
+
+static const char *const stateNames[POWER_PROF_STATE_COUNT] = {"idle", "standby"};
+
+/*
+ *  ======== power_prof_now ========
+ *  AON RTC time in 1/65536 s; wraps after about 18 hours, which is fine
+ *  for differences.
+ */
+static uint32_t power_prof_now(void)
+{
+    return AONRTCCurrentCompareValueGet();
+}
+
+static uint64_t power_prof_toUs(uint32_t rtcTicks)
+{
+    /* 1000000 / 65536 = 15625 / 1024 */
+    return ((uint64_t)rtcTicks * 15625) >> 10;
+}
+
+/*
+ *  ======== power_prof_pending ========
+ *  Source of a wakeup, from the interrupts pending while they are still
+ *  masked. External sources win over the RTC, which is usually armed for
+ *  the next ClockP timeout anyway.
+ */
+static PowerProf_Wake power_prof_pending(void)
+{
+    if (IntPendGet(INT_AON_GPIO_EDGE))
+    {
+        return POWER_PROF_WAKE_GPIO;
+    }
+    if (IntPendGet(INT_UART0_COMB) || IntPendGet(INT_UART1_COMB))
+    {
+        return POWER_PROF_WAKE_UART;
+    }
+    if (IntPendGet(INT_RFC_CPE_0) || IntPendGet(INT_RFC_CPE_1) || IntPendGet(INT_RFC_HW_COMB) ||
+        IntPendGet(INT_RFC_CMD_ACK))
+    {
+        return POWER_PROF_WAKE_RADIO;
+    }
+    if (IntPendGet(INT_AON_RTC_COMB))
+    {
+        return POWER_PROF_WAKE_CLOCK;
+    }
+    return POWER_PROF_WAKE_OTHER;
+}
+
+/*
+ *  ======== power_prof_notify ========
+ *  Called by the standby policy with interrupts disabled.
+ */
+static int power_prof_notify(unsigned int eventType, uintptr_t eventArg, uintptr_t clientArg)
+{
+    if (eventType == PowerCC26XX_AWAKE_STANDBY)
+    {
+        prof.wakeTime   = power_prof_now();
+        prof.wakeSource = power_prof_pending();
+        prof.standby    = true;
+    }
+
+    return Power_NOTIFYDONE;
+}
+
+/*
+ *  ======== power_prof_record ========
+ */
+static void power_prof_record(PowerProf_State state, PowerProf_Wake wake, uint32_t start, uint32_t end)
+{
+    uint32_t us = (uint32_t)power_prof_toUs(end - start);
+    uintptr_t key;
+
+    key = HwiP_disable();
+    prof.stats.entries[state]++;
+    prof.stats.timeUs[state] += us;
+    if (us > prof.stats.maxUs[state])
+    {
+        prof.stats.maxUs[state] = us;
+    }
+    prof.stats.wakeups[wake]++;
+    HwiP_restore(key);
+}
+
+void power_prof_init(void)
+{
+    prof.startTime = power_prof_now();
+    Power_registerNotify(&prof.notifyObj, PowerCC26XX_AWAKE_STANDBY, power_prof_notify, 0);
+    prof.started = true;
+}
+
+/*
+ *  ======== power_prof_idle ========
+ *  The idle step of PowerCC26XX_standbyPolicy() when standby is not
+ *  allowed: power the CPU domain off and deep sleep, or just WFI if idle
+ *  is disallowed too. Called with interrupts disabled.
+ */
+static void power_prof_idle(uint32_t constraints)
+{
+    uint32_t modeVIMS;
+
+    if (constraints & (1 << PowerCC26XX_DISALLOW_IDLE))
+    {
+        PRCMSleep();
+        return;
+    }
+
+    /* Keep flash, and VIMS when it is used as GPRAM, powered if needed */
+    do
+    {
+        modeVIMS = VIMSModeGet(VIMS_BASE);
+    } while (modeVIMS == VIMS_MODE_CHANGING);
+
+    if (!(constraints & (1 << PowerCC26XX_NEED_FLASH_IN_IDLE)) && (modeVIMS != VIMS_MODE_DISABLED))
+    {
+        HWREG(PRCM_BASE + PRCM_O_PDCTL1VIMS) &= ~PRCM_PDCTL1VIMS_ON;
+    }
+    else
+    {
+        HWREG(PRCM_BASE + PRCM_O_PDCTL1VIMS) |= PRCM_PDCTL1VIMS_ON;
+    }
+
+    PRCMCacheRetentionEnable();
+
+    /* Takes effect at PRCMDeepSleep() */
+    PRCMPowerDomainOff(PRCM_DOMAIN_CPU);
+
+    /* Let outstanding AON writes complete, and resync after wakeup */
+    SysCtrlAonSync();
+    PRCMDeepSleep();
+    SysCtrlAonUpdate();
+}
+
+/*
+ *  ======== power_prof_policy ========
+ *  With standby disallowed, do the idle step of the TI policy here so
+ *  the wakeup source can be read before the interrupt is taken.
+ *  Otherwise leave the decision to the TI standby policy.
+ */
+void power_prof_policy(void)
+{
+    uint32_t constraints;
+    uint32_t start;
+    uint32_t end;
+
+    if (!prof.started)
+    {
+        PowerCC26XX_standbyPolicy();
+        return;
+    }
+
+    constraints = Power_getConstraintMask();
+    if (constraints & (1 << PowerCC26XX_DISALLOW_STANDBY))
+    {
+        CPUcpsid();
+        start = power_prof_now();
+        power_prof_idle(constraints);
+        end             = power_prof_now();
+        prof.wakeSource = power_prof_pending();
+        prof.stats.standbyBlocked++;
+        CPUcpsie();
+
+        power_prof_record(POWER_PROF_STATE_IDLE, prof.wakeSource, start, end);
+        return;
+    }
+
+    prof.standby = false;
+    start        = power_prof_now();
+    PowerCC26XX_standbyPolicy();
+
+    if (prof.standby)
+    {
+        power_prof_record(POWER_PROF_STATE_STANDBY, prof.wakeSource, start, prof.wakeTime);
+    }
+    else
+    {
+        /* Idled inside the TI policy; its wakeup has already been serviced */
+        power_prof_record(POWER_PROF_STATE_IDLE, POWER_PROF_WAKE_OTHER, start, power_prof_now());
+    }
+}
+
+void power_prof_getStats(PowerProf_Stats *stats)
+{
+    uintptr_t key;
+
+    key              = HwiP_disable();
+    *stats           = prof.stats;
+    stats->elapsedUs = power_prof_toUs(power_prof_now() - prof.startTime);
+    HwiP_restore(key);
+}
+
+void power_prof_reset(void)
+{
+    uintptr_t key;
+
+    key = HwiP_disable();
+    memset(&prof.stats, 0, sizeof(prof.stats));
+    prof.startTime = power_prof_now();
+    HwiP_restore(key);
+}
+
+const char *power_prof_stateName(PowerProf_State state)
+{
+    return (state < POWER_PROF_STATE_COUNT) ? stateNames[state] : "";
+}
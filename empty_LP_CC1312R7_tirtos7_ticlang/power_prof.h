@@ -0,0 +1,64 @@
+/*
+ *  ======== power_prof.h ========
+ *  Sleep residency profiler.
+ *
+ *  power_prof_policy() is installed as the Power policy function in the
+ *  .syscfg file. Each time the idle task calls it, it times the sleep on
+ *  the AON RTC, which keeps running in standby, and records whether the
+ *  device only idled (CPU domain off, or just WFI while idle is
+ *  disallowed) or went to standby. The time not spent in either is
+ *  active time.
+ *
+ *  Each wakeup is attributed to the interrupt found pending when the CPU
+ *  comes back, before it is serviced: the RTC (ClockP timeouts), GPIO
+ *  edges, UART or the radio. When standby is allowed the TI standby
+ *  policy decides between standby and idle; only its standby wakeups can
+ *  be attributed, from the AWAKE_STANDBY notification, and idle wakeups
+ *  on that path are counted as "other".
+ */
+#ifndef POWER_PROF_H_
+#define POWER_PROF_H_
+
+#include <stdint.h>
+
+typedef enum
+{
+    POWER_PROF_STATE_IDLE,
+    POWER_PROF_STATE_STANDBY,
+    POWER_PROF_STATE_COUNT
+} PowerProf_State;
+
+typedef enum
+{
+    POWER_PROF_WAKE_CLOCK,
+    POWER_PROF_WAKE_GPIO,
+    POWER_PROF_WAKE_UART,
+    POWER_PROF_WAKE_RADIO,
+    POWER_PROF_WAKE_OTHER,
+    POWER_PROF_WAKE_COUNT
+} PowerProf_Wake;
+
+typedef struct
+{
+    uint64_t elapsedUs;                        /* Since init or reset; wraps at 18 h */
+    uint32_t entries[POWER_PROF_STATE_COUNT];
+    uint64_t timeUs[POWER_PROF_STATE_COUNT];
+    uint32_t maxUs[POWER_PROF_STATE_COUNT];    /* Longest single stay */
+    uint32_t wakeups[POWER_PROF_WAKE_COUNT];
+    uint32_t standbyBlocked;                   /* Sleeps with standby disallowed */
+} PowerProf_Stats;
+
+/* Start profiling; call once from a task before the idle task first runs */
+void power_prof_init(void);
+
+/* Power policy function; set as the custom policy in the .syscfg file */
+void power_prof_policy(void);
+
+void power_prof_getStats(PowerProf_Stats *stats);
+
+/* Clear the statistics and start a new measurement interval */
+void power_prof_reset(void);
+
+const char *power_prof_stateName(PowerProf_State state);
+
+#endif /* POWER_PROF_H_ */
@@ -0,0 +1,224 @@
+/*
+ *  ======== sched.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/HwiP.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+
+#include "sched.h"
+#include "wdt_supervisor.h"
+
+typedef struct
+{
+    const char *name;
+    Sched_Fxn fxn;
+    volatile uint32_t events;
+    volatile uint32_t postTick; /* Tick of the first post since the last run */
+    uint32_t timerEvents;
+    ClockP_Struct clockStruct;
+    ClockP_Handle clock;
+    int wdtClient;
+    Sched_Stats stats;
+} Sched_Tasklet;
+
+static struct
+{
+    SemaphoreP_Struct semStruct;
+    SemaphoreP_Handle sem;
+    uint32_t startTick;
+    uint64_t idleTicks;
+    int count;
+    Sched_Tasklet tasklets[SCHED_MAX_TASKLETS];
+} sched;
+
+/*
+ *  ======== sched_ticksToUs ========
+ */
+static uint32_t sched_ticksToUs(uint32_t ticks)
+{
+    return ticks * ClockP_getSystemTickPeriod();
+}
+
+/*
+ *  ======== sched_clockFxn ========
+ */
+static void sched_clockFxn(uintptr_t arg)
+{
+    sched_post((int)arg, sched.tasklets[arg].timerEvents);
+}
+
+/*
+ *  ======== sched_dispatch ========
+ *  Run every tasklet with events once. Returns false if none had any.
+ */
+static bool sched_dispatch(void)
+{
+    Sched_Tasklet *t;
+    uint32_t events;
+    uint32_t postTick;
+    uint32_t start;
+    uint32_t us;
+    bool ran = false;
+    uintptr_t key;
+    int i;
+
+    for (i = 0; i < sched.count; i++)
+    {
+        t = &sched.tasklets[i];
+
+        key       = HwiP_disable();
+        events    = t->events;
+        postTick  = t->postTick;
+        t->events = 0;
+        HwiP_restore(key);
+
+        if (events == 0)
+        {
+            continue;
+        }
+        ran = true;
+
+        start = ClockP_getSystemTicks();
+        us    = sched_ticksToUs(start - postTick);
+        t->stats.latencyUs += us;
+        if (us > t->stats.maxLatencyUs)
+        {
+            t->stats.maxLatencyUs = us;
+        }
+
+        if (t->wdtClient != WDT_SUPERVISOR_NONE)
+        {
+            wdt_supervisor_begin(t->wdtClient);
+        }
+
+        t->fxn(events);
+
+        if (t->wdtClient != WDT_SUPERVISOR_NONE)
+        {
+            wdt_supervisor_checkin(t->wdtClient);
+        }
+
+        us = sched_ticksToUs(ClockP_getSystemTicks() - start);
+        t->stats.runUs += us;
+        if (us > t->stats.maxRunUs)
+        {
+            t->stats.maxRunUs = us;
+        }
+        t->stats.dispatches++;
+    }
+
+    return ran;
+}
+
+int sched_register(const char *name, Sched_Fxn fxn)
+{
+    Sched_Tasklet *t;
+    int id;
+
+    if (sched.sem == NULL)
+    {
+        sched.sem = SemaphoreP_constructBinary(&sched.semStruct, 0);
+    }
+
+    if (sched.count >= SCHED_MAX_TASKLETS)
+    {
+        return SCHED_NONE;
+    }
+
+    id           = sched.count;
+    t            = &sched.tasklets[id];
+    t->name      = name;
+    t->fxn       = fxn;
+    t->events    = 0;
+    t->clock     = NULL;
+    t->wdtClient = wdt_supervisor_register(name, 0);
+
+    sched.count = id + 1;
+
+    return id;
+}
+
+void sched_post(int id, uint32_t events)
+{
+    Sched_Tasklet *t = &sched.tasklets[id];
+    uintptr_t key;
+
+    key = HwiP_disable();
+    if (t->events == 0)
+    {
+        t->postTick = ClockP_getSystemTicks();
+    }
+    t->events |= events;
+    HwiP_restore(key);
+
+    SemaphoreP_post(sched.sem);
+}
+
+void sched_timer(int id, uint32_t events, uint32_t periodMs)
+{
+    Sched_Tasklet *t = &sched.tasklets[id];
+    ClockP_Params clockParams;
+    uint32_t period = (periodMs * 1000) / ClockP_getSystemTickPeriod();
+
+    if (t->clock == NULL)
+    {
+        ClockP_Params_init(&clockParams);
+        clockParams.arg = (uintptr_t)id;
+        t->clock        = ClockP_construct(&t->clockStruct, sched_clockFxn, 0, &clockParams);
+    }
+
+    ClockP_stop(t->clock);
+    if (periodMs == 0)
+    {
+        return;
+    }
+
+    t->timerEvents = events;
+    ClockP_setTimeout(t->clock, period);
+    ClockP_setPeriod(t->clock, period);
+    ClockP_start(t->clock);
+}
+
+void sched_run(void)
+{
+    uint32_t idleStart;
+
+    sched.startTick = ClockP_getSystemTicks();
+
+    while (1)
+    {
+        /* Keep going until a full pass finds nothing to do */
+        while (sched_dispatch()) {}
+
+        idleStart = ClockP_getSystemTicks();
+        SemaphoreP_pend(sched.sem, SemaphoreP_WAIT_FOREVER);
+        sched.idleTicks += ClockP_getSystemTicks() - idleStart;
+    }
+}
+
+uint32_t sched_idlePercent(void)
+{
+    uint32_t total = ClockP_getSystemTicks() - sched.startTick;
+
+    return (total != 0) ? (uint32_t)((sched.idleTicks * 100) / total) : 100;
+}
+
+int sched_count(void)
+{
+    return sched.count;
+}
+
+const char *sched_name(int id)
+{
+    return (id >= 0 && id < sched.count) ? sched.tasklets[id].name : "";
+}
+
+void sched_getStats(int id, Sched_Stats *stats)
+{
+    *stats = sched.tasklets[id].stats;
+}
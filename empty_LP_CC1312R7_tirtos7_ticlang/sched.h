@@ -0,0 +1,70 @@
+/*
+ *  ======== sched.h ========
+ *  Run-to-completion scheduler for the test modules of this example.
+ *
+ *  Each module registers a tasklet: a function that is called with the
+ *  event bits posted to it since its last run, does whatever work they
+ *  ask for without blocking, and returns. Events are posted with
+ *  sched_post() from driver callbacks, other tasklets or a per-tasklet
+ *  ClockP timer, and all tasklets run one after the other in
+ *  sched_run(), so they share the stack of the calling task. When no
+ *  tasklet has events the task pends on a semaphore and the idle task
+ *  can put the device to sleep.
+ *
+ *  Each tasklet is also a statistics-only watchdog supervisor client, so
+ *  the run time of every dispatch and the gaps between them are kept in
+ *  the supervisor's record. A tasklet that does not return starves the
+ *  others, which is caught by whichever client with a deadline stops
+ *  checking in.
+ */
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef SCHED_MAX_TASKLETS
+    #define SCHED_MAX_TASKLETS 8
+#endif
+
+#define SCHED_NONE (-1)
+
+typedef void (*Sched_Fxn)(uint32_t events);
+
+typedef struct
+{
+    uint32_t dispatches;
+    uint32_t maxLatencyUs;  /* Longest time from a post to its dispatch */
+    uint64_t latencyUs;     /* Sum over all dispatches */
+    uint32_t maxRunUs;      /* Longest single run */
+    uint64_t runUs;         /* Total run time */
+} Sched_Stats;
+
+/*
+ * Add a tasklet. Returns its id, or SCHED_NONE if the table is full.
+ * Call before sched_run(), from the task that will run it.
+ */
+int sched_register(const char *name, Sched_Fxn fxn);
+
+/* Set events for tasklet id; safe from any context, including ISRs */
+void sched_post(int id, uint32_t events);
+
+/*
+ * Post events to tasklet id every periodMs, starting periodMs from now.
+ * A period of 0 stops the tasklet's timer.
+ */
+void sched_timer(int id, uint32_t events, uint32_t periodMs);
+
+/* Dispatch tasklets as their events come in; does not return */
+void sched_run(void);
+
+/* Percentage of the time since sched_run() spent waiting for events */
+uint32_t sched_idlePercent(void);
+
+int sched_count(void);
+
+const char *sched_name(int id);
+
+void sched_getStats(int id, Sched_Stats *stats);
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,512 @@
+/*
+ *  ======== sd_logger.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <third_party/fatfs/ff.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/HwiP.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+
+#include "sd_logger.h"
+
+/* Sector size FatFs is built with (FF_MIN_SS == FF_MAX_SS == 512) */
+#define SECTOR_SIZE 512
+
+#define SD_LOGGER_STAGE_SIZE (SD_LOGGER_STAGE_SECTORS * SECTOR_SIZE)
+#define SD_LOGGER_STAGE_MASK (SD_LOGGER_STAGE_SIZE - 1)
+
+#if (SD_LOGGER_STAGE_SECTORS & (SD_LOGGER_STAGE_SECTORS - 1)) != 0
+    #error "SD_LOGGER_STAGE_SECTORS must be a power of two"
+#endif
+
+#if (SD_LOGGER_FILE_SIZE % SECTOR_SIZE) != 0
+    #error "SD_LOGGER_FILE_SIZE must be a multiple of the sector size"
+#endif
+
+#define SD_LOGGER_INDEX_MAGIC 0x4C4F4731 /* "LOG1" */
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;     /* Number of the file being written */
+    uint32_t length;  /* Bytes of it written as of the last sync */
+} SdLogger_Index;
+
+/*
+ * resv and tail are free-running byte offsets into the staging ring.
+ * Producers reserve [resv, resv + len) with interrupts off, copy without
+ * them, then add what they copied to filled[] of each sector touched, so
+ * a sector is complete exactly when its count reaches SECTOR_SIZE even if
+ * producers finish out of order. writers counts producers between the
+ * two steps; when it is zero everything below resv is in place.
+ *
+ * tail is the start of the oldest sector not yet completely written and
+ * only moves in whole sectors; partial is how much of that sector has
+ * already gone to the file to meet a sync. Only the writer task touches
+ * tail, partial and the FIL objects.
+ */
+static struct
+{
+    const char *drive;
+    FIL file;
+    FIL index;
+    uint32_t seq;
+    volatile bool open;
+    volatile bool closing;
+
+    SemaphoreP_Struct semStruct;
+    SemaphoreP_Handle sem;
+
+    volatile uint32_t resv;
+    volatile uint32_t tail;
+    volatile uint32_t writers;
+    volatile uint16_t filled[SD_LOGGER_STAGE_SECTORS];
+    uint32_t partial;
+
+    uint32_t syncTick;
+    uint32_t unsynced;
+
+    SdLogger_Stats stats;
+    uint8_t stage[SD_LOGGER_STAGE_SIZE];
+} sdLogger __attribute__((aligned(4)));
+
+/*
+ *  ======== sd_logger_fileName ========
+ */
+static void sd_logger_fileName(char *name, size_t size, uint32_t seq)
+{
+    snprintf(name, size, "%sLOG%05lu.BIN", sdLogger.drive, (unsigned long)seq);
+}
+
+/*
+ *  ======== sd_logger_writeIndex ========
+ */
+static FRESULT sd_logger_writeIndex(void)
+{
+    SdLogger_Index idx;
+    FRESULT fresult;
+    UINT bytesWritten;
+
+    idx.magic  = SD_LOGGER_INDEX_MAGIC;
+    idx.seq    = sdLogger.seq;
+    idx.length = f_tell(&sdLogger.file);
+
+    fresult = f_lseek(&sdLogger.index, 0);
+    if (fresult == FR_OK)
+    {
+        fresult = f_write(&sdLogger.index, &idx, sizeof(idx), &bytesWritten);
+    }
+    if (fresult == FR_OK)
+    {
+        fresult = f_sync(&sdLogger.index);
+    }
+
+    return fresult;
+}
+
+/*
+ *  ======== sd_logger_openFile ========
+ *  Create log file seq at its full size and drop the oldest one kept.
+ */
+static FRESULT sd_logger_openFile(uint32_t seq)
+{
+    FRESULT fresult;
+    char name[24];
+
+    if (seq >= SD_LOGGER_MAX_FILES)
+    {
+        sd_logger_fileName(name, sizeof(name), seq - SD_LOGGER_MAX_FILES);
+        f_unlink(name);
+    }
+
+    sd_logger_fileName(name, sizeof(name), seq);
+    fresult = f_open(&sdLogger.file, name, FA_CREATE_ALWAYS | FA_WRITE);
+    if (fresult != FR_OK)
+    {
+        return fresult;
+    }
+
+#if FF_USE_EXPAND
+    fresult = f_expand(&sdLogger.file, SD_LOGGER_FILE_SIZE, 1);
+    if (fresult == FR_DENIED)
+#endif
+    {
+        /* No contiguous area (or no f_expand): allocate by seeking */
+        fresult = f_lseek(&sdLogger.file, SD_LOGGER_FILE_SIZE);
+        if (fresult == FR_OK && f_tell(&sdLogger.file) != SD_LOGGER_FILE_SIZE)
+        {
+            fresult = FR_DENIED;
+        }
+        if (fresult == FR_OK)
+        {
+            fresult = f_lseek(&sdLogger.file, 0);
+        }
+    }
+
+    if (fresult != FR_OK)
+    {
+        f_close(&sdLogger.file);
+        return fresult;
+    }
+
+    sdLogger.seq = seq;
+    sdLogger.stats.files++;
+
+    return sd_logger_writeIndex();
+}
+
+/*
+ *  ======== sd_logger_recover ========
+ *  Trim the preallocated tail off the file named in the index and return
+ *  the number to use for the next file.
+ */
+static uint32_t sd_logger_recover(void)
+{
+    SdLogger_Index idx;
+    UINT bytesRead;
+    FIL *fp = &sdLogger.file;
+    char name[24];
+
+    if (f_read(&sdLogger.index, &idx, sizeof(idx), &bytesRead) != FR_OK || bytesRead != sizeof(idx) ||
+        idx.magic != SD_LOGGER_INDEX_MAGIC)
+    {
+        return 0;
+    }
+
+    sd_logger_fileName(name, sizeof(name), idx.seq);
+    if (f_open(fp, name, FA_WRITE) == FR_OK)
+    {
+        if (f_size(fp) > idx.length && f_lseek(fp, idx.length) == FR_OK)
+        {
+            f_truncate(fp);
+        }
+        f_close(fp);
+    }
+
+    return idx.seq + 1;
+}
+
+/*
+ *  ======== sd_logger_writeOut ========
+ */
+static bool sd_logger_writeOut(const uint8_t *data, UINT len)
+{
+    FRESULT fresult;
+    UINT bytesWritten;
+
+    fresult = f_write(&sdLogger.file, data, len, &bytesWritten);
+    sdLogger.unsynced += bytesWritten;
+    if (fresult != FR_OK || bytesWritten != len)
+    {
+        sdLogger.stats.errors++;
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ *  ======== sd_logger_rotate ========
+ */
+static bool sd_logger_rotate(void)
+{
+    f_close(&sdLogger.file);
+    sdLogger.unsynced = 0;
+
+    if (sd_logger_openFile(sdLogger.seq + 1) != FR_OK)
+    {
+        sdLogger.stats.errors++;
+        sdLogger.open = false;
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ *  ======== sd_logger_room ========
+ *  Bytes left in the current file, starting a new one when it is full.
+ */
+static uint32_t sd_logger_room(void)
+{
+    uint32_t room = SD_LOGGER_FILE_SIZE - f_tell(&sdLogger.file);
+
+    if (room == 0 && sd_logger_rotate())
+    {
+        room = SD_LOGGER_FILE_SIZE;
+    }
+
+    return room;
+}
+
+/*
+ *  ======== sd_logger_drain ========
+ *  Write every completed sector, contiguous ones in one f_write so FatFs
+ *  can use multi-block writes straight from the staging ring.
+ */
+static void sd_logger_drain(void)
+{
+    uint32_t first;
+    uint32_t room;
+    uint32_t n;
+    uint32_t i;
+    UINT len;
+
+    while (sdLogger.open)
+    {
+        first = (sdLogger.tail / SECTOR_SIZE) & (SD_LOGGER_STAGE_SECTORS - 1);
+        room  = sd_logger_room();
+
+        /* Stop at the end of the ring and of the file */
+        for (n = 0; first + n < SD_LOGGER_STAGE_SECTORS && sdLogger.filled[first + n] == SECTOR_SIZE &&
+                    (n + 1) * SECTOR_SIZE - sdLogger.partial <= room;
+             n++) {}
+
+        if (n == 0)
+        {
+            return;
+        }
+
+        len = n * SECTOR_SIZE - sdLogger.partial;
+        if (!sd_logger_writeOut(&sdLogger.stage[first * SECTOR_SIZE + sdLogger.partial], len))
+        {
+            return;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            sdLogger.filled[first + i] = 0;
+        }
+        sdLogger.stats.sectorsWritten += n;
+        sdLogger.partial = 0;
+
+        /* Release the sectors to producers only after they are cleared */
+        __asm volatile("" ::: "memory");
+        sdLogger.tail += n * SECTOR_SIZE;
+    }
+}
+
+/*
+ *  ======== sd_logger_sync ========
+ *  Write the committed part of the sector at tail, then sync the file
+ *  and the index.
+ */
+static void sd_logger_sync(void)
+{
+    uint32_t committed;
+    uint32_t avail;
+    uint32_t room;
+    uintptr_t key;
+
+    key       = HwiP_disable();
+    committed = (sdLogger.writers == 0) ? sdLogger.resv : sdLogger.tail + sdLogger.partial;
+    HwiP_restore(key);
+
+    avail = committed - (sdLogger.tail + sdLogger.partial);
+    if (avail > SECTOR_SIZE - sdLogger.partial)
+    {
+        avail = SECTOR_SIZE - sdLogger.partial;
+    }
+
+    room = sd_logger_room();
+    if (avail > room)
+    {
+        avail = room;
+    }
+
+    if (avail != 0 && sdLogger.open &&
+        sd_logger_writeOut(&sdLogger.stage[(sdLogger.tail & SD_LOGGER_STAGE_MASK) + sdLogger.partial], avail))
+    {
+        sdLogger.partial += avail;
+        sdLogger.stats.partialWrites++;
+    }
+
+    if (!sdLogger.open)
+    {
+        return;
+    }
+
+    if (f_sync(&sdLogger.file) != FR_OK || sd_logger_writeIndex() != FR_OK)
+    {
+        sdLogger.stats.errors++;
+    }
+
+    sdLogger.stats.syncs++;
+    sdLogger.unsynced = 0;
+    sdLogger.syncTick = ClockP_getSystemTicks();
+}
+
+bool sd_logger_open(const char *drive)
+{
+    char name[24];
+    uint32_t seq;
+    uint32_t i;
+
+    if (sdLogger.sem == NULL)
+    {
+        sdLogger.sem = SemaphoreP_constructBinary(&sdLogger.semStruct, 0);
+    }
+
+    sdLogger.drive = drive;
+
+    snprintf(name, sizeof(name), "%sLOG.IDX", drive);
+    if (f_open(&sdLogger.index, name, FA_OPEN_ALWAYS | FA_READ | FA_WRITE) != FR_OK)
+    {
+        return false;
+    }
+
+    seq = sd_logger_recover();
+    if (sd_logger_openFile(seq) != FR_OK)
+    {
+        f_close(&sdLogger.index);
+        return false;
+    }
+
+    sdLogger.resv     = 0;
+    sdLogger.tail     = 0;
+    sdLogger.writers  = 0;
+    sdLogger.partial  = 0;
+    sdLogger.unsynced = 0;
+    sdLogger.syncTick = ClockP_getSystemTicks();
+    for (i = 0; i < SD_LOGGER_STAGE_SECTORS; i++)
+    {
+        sdLogger.filled[i] = 0;
+    }
+
+    sdLogger.closing = false;
+    sdLogger.open    = true;
+
+    return true;
+}
+
+bool sd_logger_append(const void *data, size_t len)
+{
+    uint32_t pos;
+    uint32_t end;
+    uint32_t idx;
+    uint32_t sec;
+    size_t first;
+    size_t n;
+    bool wake = false;
+    uintptr_t key;
+
+    if (len == 0)
+    {
+        return true;
+    }
+
+    key = HwiP_disable();
+    if (!sdLogger.open || sdLogger.closing || len > SD_LOGGER_STAGE_SIZE - (sdLogger.resv - sdLogger.tail))
+    {
+        sdLogger.stats.dropped++;
+        HwiP_restore(key);
+        return false;
+    }
+    pos           = sdLogger.resv;
+    sdLogger.resv = pos + len;
+    sdLogger.writers++;
+    sdLogger.stats.records++;
+    sdLogger.stats.bytes += len;
+    HwiP_restore(key);
+
+    idx   = pos & SD_LOGGER_STAGE_MASK;
+    first = SD_LOGGER_STAGE_SIZE - idx;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(&sdLogger.stage[idx], data, first);
+    memcpy(&sdLogger.stage[0], (const uint8_t *)data + first, len - first);
+
+    key = HwiP_disable();
+    for (end = pos + len; pos != end; pos += n)
+    {
+        sec = (pos / SECTOR_SIZE) & (SD_LOGGER_STAGE_SECTORS - 1);
+        n   = SECTOR_SIZE - (pos % SECTOR_SIZE);
+        if (n > end - pos)
+        {
+            n = end - pos;
+        }
+
+        sdLogger.filled[sec] += n;
+        if (sdLogger.filled[sec] == SECTOR_SIZE)
+        {
+            wake = true;
+        }
+    }
+    sdLogger.writers--;
+    HwiP_restore(key);
+
+    if (wake)
+    {
+        SemaphoreP_post(sdLogger.sem);
+    }
+
+    return true;
+}
+
+void sd_logger_process(uint32_t timeoutMs)
+{
+    uint32_t period = ClockP_getSystemTickPeriod();
+    uint32_t elapsedMs;
+
+    if (!sdLogger.open)
+    {
+        return;
+    }
+
+    SemaphoreP_pend(sdLogger.sem, (timeoutMs * 1000) / period);
+
+    sd_logger_drain();
+
+    elapsedMs = ((ClockP_getSystemTicks() - sdLogger.syncTick) * period) / 1000;
+    if (sdLogger.unsynced >= SD_LOGGER_SYNC_BYTES ||
+        (elapsedMs >= SD_LOGGER_SYNC_MS && (sdLogger.unsynced != 0 || sdLogger.resv != sdLogger.tail + sdLogger.partial)))
+    {
+        sd_logger_sync();
+    }
+}
+
+void sd_logger_close(void)
+{
+    uint32_t last;
+
+    if (!sdLogger.open)
+    {
+        return;
+    }
+
+    sdLogger.closing = true;
+
+    /* Flush in sector-sized steps until everything committed is out */
+    do
+    {
+        last = sdLogger.tail + sdLogger.partial;
+        sd_logger_drain();
+        sd_logger_sync();
+    } while (sdLogger.open && sdLogger.tail + sdLogger.partial != last);
+
+    if (!sdLogger.open)
+    {
+        return;
+    }
+    sdLogger.open = false;
+
+    /* Hand back the preallocated space beyond the data */
+    f_truncate(&sdLogger.file);
+    sd_logger_writeIndex();
+    f_close(&sdLogger.file);
+    f_close(&sdLogger.index);
+}
+
+void sd_logger_getStats(SdLogger_Stats *stats)
+{
+    *stats = sdLogger.stats;
+}
@@ -0,0 +1,92 @@
+/*
+ *  ======== sd_logger.h ========
+ *  Append-only data logger on a mounted FatFs drive.
+ *
+ *  Producers append records to a RAM staging ring of whole sectors; they
+ *  never touch the FIL object and only hold interrupts off long enough to
+ *  reserve space and to account the bytes they copied, so any number of
+ *  tasks (or interrupts) can log at once. One writer task runs
+ *  sd_logger_process(), which writes sectors as they fill, contiguous
+ *  ones in a single f_write, and syncs on a time or size budget rather
+ *  than per record.
+ *
+ *  Data goes to LOGnnnnn.BIN files of SD_LOGGER_FILE_SIZE bytes, each
+ *  allocated up front with f_expand (contiguously when FF_USE_EXPAND is
+ *  set) so the FAT is not updated while logging. When a file is full the
+ *  next one is started and the file SD_LOGGER_MAX_FILES back is deleted.
+ *  The files form one byte stream, so a record may continue in the next
+ *  file.
+ *
+ *  LOG.IDX holds the number of the current file and how much of it is
+ *  valid as of the last sync. sd_logger_open() uses it to trim the
+ *  preallocated tail off a file left open by a reset, and to continue
+ *  numbering after it.
+ */
+#ifndef SD_LOGGER_H_
+#define SD_LOGGER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Staging ring size in 512 byte sectors, must be a power of two */
+#ifndef SD_LOGGER_STAGE_SECTORS
+    #define SD_LOGGER_STAGE_SECTORS 8
+#endif
+
+/* Size of each log file in bytes, a multiple of 512 */
+#ifndef SD_LOGGER_FILE_SIZE
+    #define SD_LOGGER_FILE_SIZE (1024UL * 1024UL)
+#endif
+
+/* Log files kept on the card before the oldest is deleted */
+#ifndef SD_LOGGER_MAX_FILES
+    #define SD_LOGGER_MAX_FILES 16
+#endif
+
+/* Sync at least this often while data is pending */
+#ifndef SD_LOGGER_SYNC_MS
+    #define SD_LOGGER_SYNC_MS 5000
+#endif
+
+/* Sync after this many bytes were written since the last sync */
+#ifndef SD_LOGGER_SYNC_BYTES
+    #define SD_LOGGER_SYNC_BYTES (64UL * 1024UL)
+#endif
+
+typedef struct
+{
+    uint32_t records;         /* Records accepted */
+    uint32_t bytes;           /* Bytes accepted */
+    uint32_t dropped;         /* Records dropped, staging ring full */
+    uint32_t sectorsWritten;  /* Whole sectors written */
+    uint32_t partialWrites;   /* Partial sectors written to meet a sync */
+    uint32_t syncs;
+    uint32_t files;           /* Files started */
+    uint32_t errors;          /* FatFs calls that failed */
+} SdLogger_Stats;
+
+/*
+ * Start logging to the drive named by drive (e.g. "0:"), which must be
+ * mounted. Returns false if the index or first log file cannot be created.
+ */
+bool sd_logger_open(const char *drive);
+
+/*
+ * Append a record. Safe from any task or interrupt. Returns false, and
+ * counts a drop, if the staging ring has no room for all of it.
+ */
+bool sd_logger_append(const void *data, size_t len);
+
+/*
+ * Writer side: wait up to timeoutMs for a sector to fill, write whatever
+ * is ready and sync when the budget is used up. Call from one task only.
+ */
+void sd_logger_process(uint32_t timeoutMs);
+
+/* Write out everything appended so far, sync and close the current file */
+void sd_logger_close(void);
+
+void sd_logger_getStats(SdLogger_Stats *stats);
+
+#endif /* SD_LOGGER_H_ */
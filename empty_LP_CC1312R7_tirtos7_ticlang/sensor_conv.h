@@ -0,0 +1,46 @@
+/*
+ *  ======== sensor_conv.h ========
+ *  Integer conversion of raw sensor readings.
+ *
+ *  Most digital sensors report a two's complement value in fixed point,
+ *  e.g. TMP11x gives degrees C in Q7 (1 LSB = 0.0078125 C). A converter
+ *  turns that into an int32_t in milli-units with one multiply and one
+ *  shift, both compile-time constants, so no float code is pulled in.
+ *
+ *  SENSOR_CONV_DEFINE_Q(name, q, scale) defines
+ *      int32_t name(int16_t raw)                    one reading
+ *      void name##Batch(raw, out, count)            an array of readings
+ *  returning floor(raw * scale / 2^q). With scale = 1000 the result is in
+ *  milli-units. The conversion is exact as long as raw * scale fits in
+ *  an int32_t, which holds for any int16_t with scale < 65536.
+ */
+#ifndef SENSOR_CONV_H_
+#define SENSOR_CONV_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int32_t (*SensorConv_Fxn)(int16_t raw);
+typedef void (*SensorConv_BatchFxn)(const int16_t *raw, int32_t *out, size_t count);
+
+/* Arithmetic right shift of a product is floor division on the targets used */
+#define SENSOR_CONV_DEFINE_Q(name, q, scale)                                        \
+    static inline int32_t name(int16_t raw)                                         \
+    {                                                                               \
+        return ((int32_t)raw * (scale)) >> (q);                                     \
+    }                                                                               \
+                                                                                    \
+    static inline void name##Batch(const int16_t *raw, int32_t *out, size_t count) \
+    {                                                                               \
+        size_t i;                                                                   \
+                                                                                    \
+        for (i = 0; i < count; i++)                                                 \
+        {                                                                           \
+            out[i] = ((int32_t)raw[i] * (scale)) >> (q);                            \
+        }                                                                           \
+    }
+
+/* TMP11x temperature result register, Q7 degrees C to milli-degrees C */
+SENSOR_CONV_DEFINE_Q(sensor_conv_tmp11x, 7, 1000)
+
+#endif /* SENSOR_CONV_H_ */
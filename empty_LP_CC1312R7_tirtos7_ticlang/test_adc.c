@@ -36,86 +36,140 @@
 #include <stdint.h>
 #include <stddef.h>
 
-/* POSIX Header files */
-#include <pthread.h>
-
 /* Driver Header files */
-#include <ti/drivers/ADC.h>
+#include <ti/drivers/ADCBuf.h>
+#include <ti/drivers/dpl/ClockP.h>
 
 /* Driver configuration */
 #include "ti_drivers_config.h"
 
-/* ADC sample count */
-#define ADC_SAMPLE_COUNT (10)
+#include "adc_stream.h"
+#include "dsp_stage.h"
+#include "sched.h"
 
-#define THREADSTACKSIZE (768)
+#include "test_fatsd.h"
+#include "test_uart.h"
 
-/* Inputs to the ADC on the CC32XX launchpads are downscaled by a factor of 0.42
- * Multiplying the conversion output with 2.365 will provide compensated output.
- */
-#if DeviceFamily_PARENT == DeviceFamily_PARENT_CC32XX
-    #define COMPENSATION_FACTOR 2365
-#else
-    #define COMPENSATION_FACTOR 1000
-#endif
-
-/* ADC conversion result variables */
-uint16_t adcValue0;
-uint32_t adcValue0MicroVolt;
-uint16_t adcValue1[ADC_SAMPLE_COUNT];
-uint32_t adcValue1MicroVolt[ADC_SAMPLE_COUNT];
+/* Sample rate of the channel being scanned */
+#define ADC_SAMPLE_RATE_HZ 1000
 
-void test_adc_init(void)
-{
-    pthread_t thread0, thread1;
-    pthread_attr_t attrs;
-    struct sched_param priParam;
-    int retc;
-    int detachState;
+/* Blocks taken from one channel before moving to the next */
+#define ADC_DWELL_BLOCKS 16
+
+#define ADC_CHANNEL_COUNT 2
 
-    /* Call driver init functions */
-    ADC_init();
-    test_uart_puts("Starting the ADC Single Channel example\n");
+/* Event of the adc tasklet: a block has completed */
+#define TEST_ADC_EVENT_BLOCK 0x1
 
-    ADC_Handle adc;
-    ADC_Params params;
-    int_fast16_t res;
+static int adcTasklet;
 
-    ADC_Params_init(&params);
-    adc = ADC_open(CONFIG_ADC_0, &params);
+static const uint32_t adcChannels[ADC_CHANNEL_COUNT] = {CONFIG_ADCBUF_CHANNEL_0, CONFIG_ADCBUF_CHANNEL_1};
+
+/* Decimate by 8 around mid-scale, flag excursions of about +-0.5 V */
+static const DspStage_Config adcDspConfig = {
+    .offset          = -2048,
+    .decimationShift = 3,
+    .rmsShift        = 2,
+    .thresholdHigh   = 500,
+    .thresholdLow    = -500,
+};
+
+static DspStage adcDsp[ADC_CHANNEL_COUNT];
+static int16_t adcDecimated[ADC_STREAM_BLOCK_SIZE >> 3];
+
+/*
+ *  ======== adcBlockReady ========
+ *  Runs in the adc tasklet for every completed block.
+ */
+static void adcBlockReady(const AdcStream_Block *block)
+{
+    DspStage_Result result;
+    size_t decimated;
+    uint32_t sum = 0;
+    size_t i;
 
-    if (adc == NULL)
+    for (i = 0; i < block->count; i++)
     {
-        test_uart_puts("Error initializing CONFIG_ADC_0\n");
-        while (1) {}
+        sum += block->microVolts[i];
     }
 
-    /* Blocking mode conversion */
-    res = ADC_convert(adc, &adcValue0);
+    /* Adjusted samples are 12 bit, so they fit an int16_t unchanged */
+    decimated = dsp_stage_process(&adcDsp[block->channel % ADC_CHANNEL_COUNT],
+                                  (const int16_t *)block->raw,
+                                  block->count,
+                                  adcDecimated,
+                                  &result);
+
+    /* Every block goes to the SD log, decimated */
+    test_fatsd_logSample(TEST_FATSD_LOG_ADC,
+                         (uint8_t)block->channel,
+                         ClockP_getSystemTicks(),
+                         adcDecimated,
+                         decimated * sizeof(adcDecimated[0]));
+
+    if (result.events & DSP_STAGE_EVENT_HIGH)
+    {
+        test_uart_printf("ADC ch%lu above threshold, peak %d\r\n", block->channel, result.max);
+    }
+    if (result.events & DSP_STAGE_EVENT_LOW)
+    {
+        test_uart_printf("ADC ch%lu below threshold, peak %d\r\n", block->channel, result.min);
+    }
 
-    if (res == ADC_STATUS_SUCCESS)
+    /* One line per dwell period per channel is enough on the console */
+    if ((block->seq % ADC_DWELL_BLOCKS) == 0)
     {
-        // Convert raw adcValue0 to compensated microvolts
-        adcValue0MicroVolt = (COMPENSATION_FACTOR * ADC_convertRawToMicroVolts(adc, adcValue0)) / 1000;
-        
-        {
-            char *tmpStr[64] = { 0 };
-            sprintf(tmpStr, "CONFIG_ADC_0 raw result: %d\n", adcValue0);
-            test_uart_puts(tmpStr);
-        }
-        
-        {
-            char *tmpStr[64] = { 0 };
-            sprintf(tmpStr, "CONFIG_ADC_0 convert result: %d uV\n", adcValue0MicroVolt);
-            test_uart_puts(tmpStr);
-        }
+        test_uart_printf("ADC ch%lu block %lu: %lu uV, rms %u, min %d, max %d\r\n",
+                         block->channel,
+                         block->seq,
+                         sum / block->count,
+                         result.rms,
+                         result.min,
+                         result.max);
     }
-    else
+}
+
+/*
+ *  ======== test_adc_blockNotify ========
+ *  Called from the ADCBuf callback.
+ */
+static void test_adc_blockNotify(void)
+{
+    sched_post(adcTasklet, TEST_ADC_EVENT_BLOCK);
+}
+
+/*
+ *  ======== test_adc_tasklet ========
+ */
+static void test_adc_tasklet(uint32_t events)
+{
+    adc_stream_process(0);
+}
+
+void test_adc_init(void)
+{
+    size_t i;
+
+    ADCBuf_init();
+    test_uart_puts("Starting the ADC continuous example\n");
+
+    for (i = 0; i < ADC_CHANNEL_COUNT; i++)
     {
-        test_uart_puts("CONFIG_ADC_0 convert failed\n");
+        dsp_stage_init(&adcDsp[i], &adcDspConfig);
     }
 
-    ADC_close(adc);
-    test_uart_puts("CONFIG_ADC_0 closed\n");
+    adcTasklet = sched_register("adc", test_adc_tasklet);
+    adc_stream_setNotify(test_adc_blockNotify);
 
+    if (!adc_stream_start(CONFIG_ADCBUF_0,
+                          adcChannels,
+                          ADC_CHANNEL_COUNT,
+                          ADC_DWELL_BLOCKS,
+                          ADC_SAMPLE_RATE_HZ,
+                          adcBlockReady))
+    {
+        test_uart_puts("Error initializing CONFIG_ADCBUF_0\n");
+        while (1) {}
+    }
 }
+
@@ -1,4 +1,2 @@
 
 void test_adc_init(void);
-
-void test_adc_loop(void);
@@ -58,6 +58,7 @@
 // #include <ti/display/Display.h>
 #include <ti/drivers/GPIO.h>
 #include <ti/drivers/SDFatFS.h>
+#include <ti/drivers/dpl/ClockP.h>
 
 /* Driver configuration */
 #include "ti_drivers_config.h"
@@ -67,6 +68,9 @@
     #define CPY_BUFF_SIZE 2048
 #endif
 
+/* Sector size FatFs is built with (FF_MIN_SS == FF_MAX_SS == 512) */
+#define SECTOR_SIZE 512
+
 /* String conversion macro */
 #define STR_(n) #n
 #define STR(n)  STR_(n)
@@ -89,51 +93,210 @@ const char textarray[]
 
 // static Display_Handle display;
 
-unsigned char cpy_buff[CPY_BUFF_SIZE + 1] __attribute__((aligned(4)));
+unsigned char cpy_buff[CPY_BUFF_SIZE] __attribute__((aligned(4)));
 
 FIL src;
 FIL dst;
 
+#include "test_fatsd.h"
 #include "test_uart.h"
+#include "uart_log.h"
+#include "sd_logger.h"
+#include "sched.h"
 
 /*
- *  ======== printDrive ========
- *  Function to print drive information such as the total disk space
- *  This function was created by referencing FatFs's API documentation
- *  http://elm-chan.org/fsw/ff/en/getfree.html
+ *  ======== mountFreeSpace ========
+ *  Establish the free cluster count of a freshly mounted drive.
  *
- *  This function call may take a while to process, depending on the size of
- *  SD Card used.
+ *  On FAT32 FatFs takes the count from the FSINFO sector when it is valid,
+ *  otherwise, and always on FAT12/16, this scans the whole FAT, which may
+ *  take a while on a large card. It is done once per mount; from then on
+ *  FatFs keeps fs->free_clst current on every cluster allocation and
+ *  release, and writes it back to FSINFO on f_sync/f_close, so
+ *  freeClusters() never has to touch the card.
  */
-void printDrive(const char *driveNumber, FATFS **fatfs)
+static FRESULT mountFreeSpace(const char *driveNumber, FATFS **fatfs)
 {
     FRESULT fresult;
     DWORD freeClusterCount;
-    DWORD totalSectorCount;
-    DWORD freeSectorCount;
+    uint32_t start;
+    char tmpStr[48];
 
     test_uart_puts("Reading disk information...\r\n");
 
+    start   = ClockP_getSystemTicks();
     fresult = f_getfree(driveNumber, &freeClusterCount, fatfs);
-    if (fresult)
+    if (fresult == FR_OK)
     {
-        test_uart_puts("Error getting the free cluster count from the FatFs object\r\n");
-        while (1) {}
+        sprintf(tmpStr, "done in %lu ms\r\n",
+                (unsigned long)((ClockP_getSystemTicks() - start) * ClockP_getSystemTickPeriod() / 1000));
+        test_uart_puts(tmpStr);
+    }
+
+    return fresult;
+}
+
+/*
+ *  ======== freeClusters ========
+ *  Free cluster count maintained by FatFs since mountFreeSpace().
+ */
+static DWORD freeClusters(FATFS *fs)
+{
+    return fs->free_clst;
+}
+
+/*
+ *  ======== printDrive ========
+ *  Function to print drive information such as the total disk space.
+ *  The free space comes from the count set up by mountFreeSpace(), so
+ *  this does not access the card.
+ */
+void printDrive(FATFS *fatfs)
+{
+    DWORD totalSectorCount;
+    DWORD freeSectorCount;
+
+    /* Get total sectors and free sectors */
+    totalSectorCount = (fatfs->n_fatent - 2) * fatfs->csize;
+    freeSectorCount  = freeClusters(fatfs) * fatfs->csize;
+
+    char tmpStr[64] = { 0 };
+    sprintf(tmpStr, "Total Disk size: %10lu KiB\r\nFree Disk space: %10lu KiB\r\n",
+            totalSectorCount / 2,
+            freeSectorCount / 2);
+    test_uart_puts(tmpStr);
+}
+
+/*
+ *  ======== copyFile ========
+ *  Copy the remainder of src to dst, which must be empty.
+ *
+ *  The destination is allocated to its final size before any data is
+ *  written (contiguously when f_expand is available and finds room,
+ *  cluster by cluster otherwise), so the copy loop
+ *  does not interleave FAT updates with data writes. Transfers are whole
+ *  sectors from a sector-aligned file offset into a word-aligned buffer,
+ *  which lets FatFs move them with multi-block reads and writes straight
+ *  into cpy_buff instead of through its sector window. The transfer size
+ *  is chosen from the cluster size: a whole number of clusters when they
+ *  fit in the buffer, otherwise a buffer that divides the cluster, so no
+ *  transfer is split at a cluster boundary.
+ */
+static FRESULT copyFile(FIL *src, FIL *dst, unsigned int *totalBytesCopied)
+{
+    FRESULT fresult;
+    FSIZE_t remaining = f_size(src) - f_tell(src);
+    UINT clusterBytes = src->obj.fs->csize * SECTOR_SIZE;
+    UINT chunk;
+    UINT bytesRead;
+    UINT bytesWritten;
+
+    *totalBytesCopied = 0;
+
+    if (clusterBytes <= CPY_BUFF_SIZE)
+    {
+        chunk = (CPY_BUFF_SIZE / clusterBytes) * clusterBytes;
     }
     else
     {
-        test_uart_puts("done\r\n");
+        chunk = CPY_BUFF_SIZE & ~(SECTOR_SIZE - 1);
+    }
 
-        /* Get total sectors and free sectors */
-        totalSectorCount = ((*fatfs)->n_fatent - 2) * (*fatfs)->csize;
-        freeSectorCount  = freeClusterCount * (*fatfs)->csize;
+    /* An empty or fully read source has nothing to preallocate */
+    if (remaining == 0)
+    {
+        return FR_OK;
+    }
 
-        char tmpStr[64] = { 0 };
-        sprintf(tmpStr, "Total Disk size: %10lu KiB\r\nFree Disk space: %10lu KiB\r\n",
-                totalSectorCount / 2,
-                freeSectorCount / 2);
-        test_uart_puts(tmpStr);
+#if FF_USE_EXPAND
+    fresult = f_expand(dst, remaining, 1);
+    if (fresult == FR_DENIED)
+#endif
+    {
+        /* No contiguous area (or no f_expand): allocate by seeking */
+        fresult = f_lseek(dst, remaining);
+        if (fresult == FR_OK && f_tell(dst) != remaining)
+        {
+            /* The card is really full; give back what was allocated */
+            f_lseek(dst, 0);
+            f_truncate(dst);
+            test_uart_puts("Disk Full\r\n");
+            return FR_DENIED;
+        }
+        if (fresult == FR_OK)
+        {
+            fresult = f_lseek(dst, 0);
+        }
     }
+    if (fresult != FR_OK)
+    {
+        test_uart_puts("Error preallocating the copy\r\n");
+        return fresult;
+    }
+
+    while (remaining > 0)
+    {
+        /*  Read from source file */
+        fresult = f_read(src, cpy_buff, chunk, &bytesRead);
+        if (fresult || bytesRead == 0)
+        {
+            break; /* Error or EOF */
+        }
+
+        /*  Write to dst file */
+        fresult = f_write(dst, cpy_buff, bytesRead, &bytesWritten);
+        if (fresult || bytesWritten < bytesRead)
+        {
+            test_uart_puts("Disk Full\r\n");
+            break; /* Error or Disk Full */
+        }
+
+        /*  Update the total number of bytes copied */
+        *totalBytesCopied += bytesWritten;
+        remaining -= bytesWritten;
+    }
+
+    /* Drop any preallocated tail left by a short copy */
+    f_truncate(dst);
+
+    return fresult;
+}
+
+/*
+ *  ======== catFile ========
+ *  Stream the remainder of fp to the console UART.
+ *
+ *  cpy_buff is used as two halves. Each half is handed to the UART by
+ *  length as soon as it has been read, and the next f_read goes into the
+ *  other half while it is being sent, so the SD card is read while the
+ *  UART keeps transmitting. The data is sent as-is; embedded NULs and
+ *  binary content are passed through.
+ */
+static FRESULT catFile(FIL *fp, unsigned int *totalBytesSent)
+{
+    FRESULT fresult;
+    UINT half = (CPY_BUFF_SIZE / 2) & ~(SECTOR_SIZE - 1);
+    UINT bytesRead;
+    int cur = 0;
+
+    *totalBytesSent = 0;
+
+    fresult = f_read(fp, cpy_buff, half, &bytesRead);
+    while (fresult == FR_OK && bytesRead > 0)
+    {
+        uart_log_writeExternal(&cpy_buff[cur * half], bytesRead);
+        *totalBytesSent += bytesRead;
+        cur ^= 1;
+
+        /* Wait until only the half just queued is left, freeing the other */
+        uart_log_waitExternal(1);
+
+        fresult = f_read(fp, &cpy_buff[cur * half], half, &bytesRead);
+    }
+
+    uart_log_waitExternal(0);
+
+    return fresult;
 }
 
 void test_fatsd_init()
@@ -146,6 +309,7 @@ void test_fatsd_loop()
     FRESULT fresult;
 
     SDFatFS_Handle sdfatfsHandle;
+    FATFS *fatfs;
 
     // return ;
 
@@ -167,7 +331,13 @@ void test_fatsd_loop()
         test_uart_puts("Drive 0 is mounted\r\n");
     }
 
-    printDrive(STR(DRIVE_NUM), &(dst.obj.fs));
+    if (mountFreeSpace(STR(DRIVE_NUM), &fatfs) != FR_OK)
+    {
+        test_uart_puts("Error getting the free cluster count from the FatFs object\r\n");
+        while (1) {}
+    }
+
+    printDrive(fatfs);
 
     /* Try to open the source file */
     fresult = f_open(&src, inputfile, FA_READ);
@@ -207,26 +377,7 @@ void test_fatsd_loop()
     }
 
     /*  Copy the contents from the src to the dst */
-    while (true)
-    {
-        /*  Read from source file */
-        fresult = f_read(&src, cpy_buff, CPY_BUFF_SIZE, &bytesRead);
-        if (fresult || bytesRead == 0)
-        {
-            break; /* Error or EOF */
-        }
-
-        /*  Write to dst file */
-        fresult = f_write(&dst, cpy_buff, bytesRead, &bytesWritten);
-        if (fresult || bytesWritten < bytesRead)
-        {
-            test_uart_puts("Disk Full\r\n");
-            break; /* Error or Disk Full */
-        }
-
-        /*  Update the total number of bytes copied */
-        totalBytesCopied += bytesWritten;
-    }
+    copyFile(&src, &dst, &totalBytesCopied);
 
     f_sync(&dst);
 
@@ -255,23 +406,12 @@ void test_fatsd_loop()
     }
 
     /* Print file contents */
-    while (true)
-    {
-        /* Read from output file */
-        fresult = f_read(&dst, cpy_buff, CPY_BUFF_SIZE, &bytesRead);
-        if (fresult || bytesRead == 0)
-        {
-            break; /* Error or EOF */
-        }
-        cpy_buff[bytesRead] = '\0';
-        /* Write output */
-        test_uart_puts(cpy_buff);
-    }
+    catFile(&dst, &bytesRead);
 
     /* Close the file */
     f_close(&dst);
 
-    printDrive(STR(DRIVE_NUM), &(dst.obj.fs));
+    printDrive(fatfs);
 
     /* Stopping the SDCard */
     SDFatFS_close(sdfatfsHandle);
@@ -280,6 +420,108 @@ void test_fatsd_loop()
 
 }
 
+static SDFatFS_Handle logHandle;
+
+/* Event of the logger tasklet, posted by its timer */
+#define TEST_FATSD_EVENT_LOG 0x1
+
+/* How often staged records are written out */
+#define TEST_FATSD_LOG_PERIOD_MS 100
+
+/* Largest sample payload taken by test_fatsd_logSample() */
+#define TEST_FATSD_LOG_MAX_PAYLOAD 32
+
+static int logTasklet = SCHED_NONE;
+
+/* Set while the logger is open; samples are skipped otherwise */
+static volatile bool logRunning;
+
+/*
+ *  ======== test_fatsd_logTasklet ========
+ */
+static void test_fatsd_logTasklet(uint32_t events)
+{
+    sd_logger_process(0);
+}
+
+/*
+ *  ======== test_fatsd_logStart ========
+ *  Mount the card and start the data logger on it; samples are then
+ *  added with test_fatsd_logSample() and written out by the logger
+ *  tasklet. Without a card the other tests carry on unlogged.
+ */
+void test_fatsd_logStart()
+{
+    FATFS *fatfs;
+
+    logHandle = SDFatFS_open(CONFIG_SD_0, DRIVE_NUM);
+    if (logHandle == NULL)
+    {
+        test_uart_puts("Error starting the SD card\r\n");
+        return;
+    }
+
+    if (mountFreeSpace(STR(DRIVE_NUM), &fatfs) == FR_OK)
+    {
+        printDrive(fatfs);
+    }
+
+    if (!sd_logger_open(STR(DRIVE_NUM) ":"))
+    {
+        test_uart_puts("Error starting the logger\r\n");
+        SDFatFS_close(logHandle);
+        return;
+    }
+
+    if (logTasklet == SCHED_NONE)
+    {
+        logTasklet = sched_register("sdlog", test_fatsd_logTasklet);
+    }
+    sched_timer(logTasklet, TEST_FATSD_EVENT_LOG, TEST_FATSD_LOG_PERIOD_MS);
+    logRunning = true;
+}
+
+/*
+ *  ======== test_fatsd_logStop ========
+ */
+void test_fatsd_logStop()
+{
+    if (logTasklet == SCHED_NONE || !logRunning)
+    {
+        return;
+    }
+
+    logRunning = false;
+    sched_timer(logTasklet, 0, 0);
+    sd_logger_close();
+    SDFatFS_close(logHandle);
+}
+
+/*
+ *  ======== test_fatsd_logSample ========
+ *  Header and payload go in one sd_logger_append() call, so records
+ *  from different producers never interleave.
+ */
+void test_fatsd_logSample(uint8_t source, uint8_t channel, uint32_t tick, const void *data, uint16_t len)
+{
+    uint8_t record[sizeof(TestFatsd_LogHeader) + TEST_FATSD_LOG_MAX_PAYLOAD];
+    TestFatsd_LogHeader header;
+
+    if (!logRunning || len > TEST_FATSD_LOG_MAX_PAYLOAD)
+    {
+        return;
+    }
+
+    header.tick    = tick;
+    header.source  = source;
+    header.channel = channel;
+    header.len     = len;
+    memcpy(record, &header, sizeof(header));
+    memcpy(&record[sizeof(header)], data, len);
+
+    sd_logger_append(record, sizeof(header) + len);
+}
+
 /*
  *  ======== fatfs_getFatTime ========
  */
@@ -1,2 +1,25 @@
+#include <stdint.h>
+
+/* Producers of logged samples */
+#define TEST_FATSD_LOG_I2C 1 /* Payload: int32_t milli-degrees C */
+#define TEST_FATSD_LOG_ADC 2 /* Payload: decimated int16_t samples */
+
+/* In front of every record in the log files */
+typedef struct
+{
+    uint32_t tick;    /* ClockP system tick of the sample */
+    uint8_t source;   /* TEST_FATSD_LOG_* */
+    uint8_t channel;  /* Sensor or ADC channel index */
+    uint16_t len;     /* Payload bytes that follow */
+} TestFatsd_LogHeader;
 
 void test_fatsd_init();
+
+void test_fatsd_loop();
+
+void test_fatsd_logStart();
+
+void test_fatsd_logStop();
+
+/* Log a sample while the logger is running; ignored otherwise */
+void test_fatsd_logSample(uint8_t source, uint8_t channel, uint32_t tick, const void *data, uint16_t len);
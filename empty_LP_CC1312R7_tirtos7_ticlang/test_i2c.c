@@ -44,6 +44,10 @@
 /* Driver configuration */
 #include "ti_drivers_config.h"
 
+#include "i2c_sampler.h"
+#include "sched.h"
+#include "sensor_conv.h"
+
 #define TASKSTACKSIZE 640
 
 /* Temperature result registers */
@@ -65,160 +69,104 @@ static const struct
     uint8_t address;
     uint8_t resultReg;
     char *id;
-} sensors[TMP_COUNT] = {{TMP11X_BASSENSORS_ADDR, TMP11X_RESULT_REG, "11X"},
-                        {TMP116_LAUNCHPAD_ADDR, TMP11X_RESULT_REG, "116"}};
+    SensorConv_BatchFxn convert; /* Raw result to milli-degrees C */
+} sensors[TMP_COUNT] = {{TMP11X_BASSENSORS_ADDR, TMP11X_RESULT_REG, "11X", sensor_conv_tmp11xBatch},
+                        {TMP116_LAUNCHPAD_ADDR, TMP11X_RESULT_REG, "116", sensor_conv_tmp11xBatch}};
+
+/* Events of the i2c tasklet */
+#define TEST_I2C_EVENT_POLL   0x1 /* Check for due and overdue transfers */
+#define TEST_I2C_EVENT_SAMPLE 0x2 /* A sample is waiting */
+
+/* Poll period; bounds how late a timeout is noticed */
+#define TEST_I2C_POLL_MS 20
 
-static uint8_t targetAddress;
+static int i2cTasklet;
 
-static void i2cErrorHandler(I2C_Transaction *transaction);
+/* Samples taken from the sampler and converted per batch */
+#define SAMPLE_BATCH 8
 
+static I2cSampler_Sample samples[SAMPLE_BATCH];
+static int16_t rawValues[SAMPLE_BATCH];
+static int32_t milliDegrees[SAMPLE_BATCH];
+
+/* Sampling schedule for each entry of sensors[] */
+static const I2cSampler_Config sensorConfig[TMP_COUNT] = {{TMP11X_BASSENSORS_ADDR, TMP11X_RESULT_REG, 1000, 20},
+                                                         {TMP116_LAUNCHPAD_ADDR, TMP11X_RESULT_REG, 1000, 20}};
+
+#include "test_fatsd.h"
 #include "test_uart.h"
 
 /*
- *  ======== mainThread ========
+ *  ======== test_i2c_sampleNotify ========
+ *  Called from the I2C transfer callback.
  */
-void test_i2c_init(void)
+static void test_i2c_sampleNotify(void)
 {
-    uint16_t sample;
-    int16_t temperature;
-    uint8_t txBuffer[1];
-    uint8_t rxBuffer[2];
-    int8_t i;
-    I2C_Handle i2c;
-    I2C_Params i2cParams;
-    I2C_Transaction i2cTransaction;
-
-    I2C_init();
+    sched_post(i2cTasklet, TEST_I2C_EVENT_SAMPLE);
+}
 
-    test_uart_puts("Starting the i2ctmp example\n");
+/*
+ *  ======== test_i2c_tasklet ========
+ */
+static void test_i2c_tasklet(uint32_t events)
+{
+    size_t count;
+    size_t i;
+    size_t j;
 
-    /* Create I2C for usage */
-    I2C_Params_init(&i2cParams);
-    i2cParams.bitRate = I2C_400kHz;
-    i2c               = I2C_open(CONFIG_I2C_0, &i2cParams);
-    if (i2c == NULL)
+    if (events & TEST_I2C_EVENT_POLL)
     {
-        test_uart_puts("Error Initializing I2C\n");
-        while (1) {}
-    }
-    else
-    {
-        test_uart_puts("I2C Initialized!\n");
+        i2c_sampler_poll();
     }
 
-    /* Common I2C transaction setup */
-    i2cTransaction.writeBuf   = txBuffer;
-    i2cTransaction.writeCount = 1;
-    i2cTransaction.readBuf    = rxBuffer;
-    i2cTransaction.readCount  = 0;
-
-    /*
-     * Determine which I2C sensors are present by querying known I2C
-     * target addresses.
-     */
-    for (i = TMP_COUNT - 1; i >= 0; i--)
+    do
     {
-        i2cTransaction.targetAddress = sensors[i].address;
-        txBuffer[0]                  = sensors[i].resultReg;
-
-        if (I2C_transfer(i2c, &i2cTransaction))
+        for (count = 0; count < SAMPLE_BATCH && i2c_sampler_read(&samples[count]); count++)
         {
-            targetAddress = sensors[i].address;
-            // Display_printf(display,
-                        //    0,
-                        //    0,
-                        //    "Detected TMP%s sensor with target"
-                        //    " address 0x%x",
-                        //    sensors[i].id,
-                        //    sensors[i].address);
+            rawValues[count] = samples[count].raw;
         }
-        else
-        {
-            i2cErrorHandler(&i2cTransaction);
-        }
-    }
 
-    /* If we never assigned a target address */
-    if (targetAddress == 0)
-    {
-        test_uart_puts("Failed to detect a sensor!\n");
-        I2C_close(i2c);
-        while (1) {}
-    }
-
-    test_uart_puts("\nUsing last known sensor for samples.\n");
-    i2cTransaction.targetAddress = targetAddress;
-
-    /* Take 20 samples and print them out onto the console */
-    i2cTransaction.readCount = 2;
-    for (sample = 0; sample < 20; sample++)
-    {
-        if (I2C_transfer(i2c, &i2cTransaction))
+        /* Convert each run of samples from the same sensor in one call */
+        for (i = 0; i < count; i = j)
         {
-            /*
-             * Extract degrees C from the received data;
-             * see TMP sensor datasheet
-             */
-            temperature = (rxBuffer[0] << 8) | (rxBuffer[1]);
-            temperature *= 0.0078125;
-
-            // test_uart_puts("Sample %u: %d C", sample, temperature);
+            for (j = i + 1; j < count && samples[j].device == samples[i].device; j++) {}
+            sensors[samples[i].device].convert(&rawValues[i], &milliDegrees[i], j - i);
         }
-        else
+
+        for (i = 0; i < count; i++)
         {
-            i2cErrorHandler(&i2cTransaction);
-            /* Sleep for 1 second */
-            sleep(1);
+            test_uart_printf("TMP%s @%lu: %ld mC\r\n", sensors[samples[i].device].id, samples[i].tick, milliDegrees[i]);
+            test_fatsd_logSample(TEST_FATSD_LOG_I2C,
+                                 samples[i].device,
+                                 samples[i].tick,
+                                 &milliDegrees[i],
+                                 sizeof(milliDegrees[i]));
         }
-    }
-
-    I2C_close(i2c);
-
-    test_uart_puts("I2C closed!\n");
-
+    } while (count == SAMPLE_BATCH);
 }
 
 /*
- *  ======== i2cErrorHandler ========
+ *  ======== test_i2c_init ========
+ *  Start sampling every known sensor. Sensors that are not fitted just
+ *  fail and back off in the sampler, so this never waits on the bus.
  */
-static void i2cErrorHandler(I2C_Transaction *transaction)
+void test_i2c_init(void)
 {
-    switch (transaction->status)
+    I2C_init();
+
+    test_uart_puts("Starting the i2ctmp example\n");
+
+    if (!i2c_sampler_init(CONFIG_I2C_0, sensorConfig, TMP_COUNT))
     {
-        case I2C_STATUS_TIMEOUT:
-            // test_uart_puts("I2C transaction timed out!");
-            break;
-        case I2C_STATUS_CLOCK_TIMEOUT:
-            // test_uart_puts("I2C serial clock line timed out!");
-            break;
-        case I2C_STATUS_ADDR_NACK:
-            // Display_printf(display, "I2C target address 0x%x not"
-                        //    " acknowledged!",
-                        //    transaction->targetAddress);
-            break;
-        case I2C_STATUS_DATA_NACK:
-            // test_uart_puts("I2C data byte not acknowledged!");
-            break;
-        case I2C_STATUS_ARB_LOST:
-            // test_uart_puts("I2C arbitration to another controller!");
-            break;
-        case I2C_STATUS_INCOMPLETE:
-            // test_uart_puts("I2C transaction returned before completion!");
-            break;
-        case I2C_STATUS_BUS_BUSY:
-            // test_uart_puts("I2C bus is already in use!");
-            break;
-        case I2C_STATUS_CANCEL:
-            // test_uart_puts("I2C transaction cancelled!");
-            break;
-        case I2C_STATUS_INVALID_TRANS:
-            // test_uart_puts("I2C transaction invalid!");
-            break;
-        case I2C_STATUS_ERROR:
-            // test_uart_puts("I2C generic error!");
-            break;
-        default:
-            // test_uart_puts("I2C undefined error case!");
-            break;
+        test_uart_puts("Error Initializing I2C\n");
+        while (1) {}
     }
+    else
+    {
+        test_uart_puts("I2C Initialized!\n");
+    }
+
+    i2cTasklet = sched_register("i2c", test_i2c_tasklet);
+    i2c_sampler_setNotify(test_i2c_sampleNotify);
+    sched_timer(i2cTasklet, TEST_I2C_EVENT_POLL, TEST_I2C_POLL_MS);
 }
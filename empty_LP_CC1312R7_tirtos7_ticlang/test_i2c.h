@@ -1,4 +1,2 @@
 
 void test_i2c_init(void);
-
-void test_i2c_loop(void);
@@ -34,7 +34,9 @@
  *  ======== uart2echo.c ========
  */
 #include <stdint.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <unistd.h>
 
 /* Driver Header files */
 #include <ti/drivers/GPIO.h>
@@ -43,6 +45,15 @@
 /* Driver configuration */
 #include "ti_drivers_config.h"
 
+#include "power_prof.h"
+#include "sched.h"
+#include "sd_logger.h"
+#include "test_uart.h"
+#include "uart_bridge.h"
+#include "uart_cmd.h"
+#include "uart_log.h"
+#include "uart_trace.h"
+
 /*
  * The following function is from good old K & R.
  */
@@ -89,103 +100,421 @@ UART2_Handle uart_0;
 UART2_Handle uart_1;
 UART2_Params uartParams_0;
 UART2_Params uartParams_1;
-size_t bytesRead;
-size_t bytesWritten = 0;
 
+/* Events of the uart tasklet */
+#define TEST_UART_EVENT_RX     0x1 /* Console input arrived */
+#define TEST_UART_EVENT_FLUSH  0x2 /* Trace records are waiting */
+#define TEST_UART_EVENT_BRIDGE 0x4 /* Bridge start or stop is pending */
+
+/* Retry period while waiting for the console to go quiet */
+#define TEST_UART_BRIDGE_POLL_MS 10
+
+static int uartTasklet = SCHED_NONE;
+
+/* uart_1 is handed from the console to the bridge while bridgeMode is set */
+static volatile bool bridgeMode;
+static bool bridgeStartRequest;
+static volatile bool bridgeStopRequest;
+static volatile bool bridgeStopped;
+
+/*
+ * Console output on uart_1 is queued on the log ring and drained by the
+ * UART2 write callback, so these return without waiting for the wire.
+ */
 void test_uart_puts(char *str)
 {
-    bytesWritten = 0;
-    while (bytesWritten == 0)
+    uart_log_write(str, strlen(str));
+}
+
+void test_uart_print(char *str, size_t len)
+{
+    uart_log_write(str, len);
+}
+
+/* Deferred-format records logged by mainThread through test_uart_printf() */
+static UartTrace_Buffer consoleTrace;
+
+/*
+ * Records the format and arguments only; the text is produced later by
+ * uart_trace_flush() in the uart tasklet. See uart_trace.h for the
+ * argument rules.
+ */
+void test_uart_printf(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    uart_trace_vprintf(&consoleTrace, format, args);
+    va_end(args);
+
+    if (uartTasklet != SCHED_NONE)
     {
-        UART2_write(uart_1, str, strlen(str), &bytesWritten);
+        sched_post(uartTasklet, TEST_UART_EVENT_FLUSH);
     }
 }
 
-void test_uart_print(char *str, size_t len)
+/*
+ *  ======== test_uart_cmdInput ========
+ *  Default for input with no command entry: report the byte and echo it.
+ */
+static void test_uart_cmdInput(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    input = (char)cmd;
+
+    sprintf(tempStr, "\r\ninput:%d\r\n", (int)input);
+    test_uart_puts(tempStr);
+
+    test_uart_print(&input, 1);
+}
+
+/*
+ *  ======== test_uart_cmdPing ========
+ *  Framed command 0x01: echo the payload back.
+ */
+static void test_uart_cmdPing(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_puts("\r\npong:");
+    test_uart_print((char *)payload, len);
+    test_uart_puts("\r\n");
+}
+
+/*
+ *  ======== test_uart_cmdStats ========
+ */
+static void test_uart_cmdStats(uint8_t cmd, const uint8_t *payload, size_t len)
 {
-    bytesWritten = 0;
-    while (bytesWritten == 0)
+    UartLog_Stats logStats;
+    UartCmd_Stats cmdStats;
+    Sched_Stats schedStats;
+    int i;
+
+    uart_log_getStats(&logStats);
+    uart_cmd_getStats(&cmdStats);
+
+    test_uart_printf("\r\nlog: queued %u sent %u dropped %u high %u errors %u\r\n",
+                     logStats.bytesQueued,
+                     logStats.bytesSent,
+                     logStats.dropped,
+                     logStats.highWater,
+                     logStats.writeErrors);
+    test_uart_printf("cmd: read %u frames %u keys %u crc %u unknown %u\r\n",
+                     cmdStats.bytesRead,
+                     cmdStats.frames,
+                     cmdStats.keys,
+                     cmdStats.crcErrors,
+                     cmdStats.unknown);
+    test_uart_printf("cmd: overruns %u stalls %u timeouts %u\r\n",
+                     cmdStats.overruns,
+                     cmdStats.stalls,
+                     cmdStats.timeouts);
+    test_uart_printf("sched: idle %u%%\r\n", sched_idlePercent());
+
+    for (i = 0; i < sched_count(); i++)
     {
-        UART2_write(uart_1, str, len, &bytesWritten);
+        sched_getStats(i, &schedStats);
+        if (schedStats.dispatches == 0)
+        {
+            continue;
+        }
+        test_uart_printf("%s: runs %u latency %u/%u us run %u/%u us\r\n",
+                         sched_name(i),
+                         schedStats.dispatches,
+                         (uint32_t)(schedStats.latencyUs / schedStats.dispatches),
+                         schedStats.maxLatencyUs,
+                         (uint32_t)(schedStats.runUs / schedStats.dispatches),
+                         schedStats.maxRunUs);
     }
 }
 
-//void test_uart_printf(const char *format, ...)
-//{
-//    char buf[256];
-//    va_list args;
-//    va_start(args, format);
-//    vsprintf(buf, format, args);
-//    va_end(args);
-//
-//    test_uart_print(buf, strlen(buf));
-//}
+/*
+ *  ======== test_uart_cmdLog ========
+ *  'l': SD data logger counters.
+ */
+static void test_uart_cmdLog(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    SdLogger_Stats stats;
 
-void test_uart_init(void)
+    sd_logger_getStats(&stats);
+
+    test_uart_printf("\r\nsdlog: records %u bytes %u dropped %u files %u\r\n",
+                     stats.records,
+                     stats.bytes,
+                     stats.dropped,
+                     stats.files);
+    test_uart_printf("sdlog: sectors %u partial %u syncs %u errors %u\r\n",
+                     stats.sectorsWritten,
+                     stats.partialWrites,
+                     stats.syncs,
+                     stats.errors);
+}
+
+/*
+ *  ======== test_uart_cmdPower ========
+ *  'p': sleep residency and wakeup sources since boot or the last 'P',
+ *  which also starts a new interval.
+ */
+static void test_uart_cmdPower(uint8_t cmd, const uint8_t *payload, size_t len)
 {
-    /* Create a UART where the default read and write mode is BLOCKING */
-    UART2_Params_init(&uartParams_0);
-    uartParams_0.baudRate = 9600;
+    PowerProf_Stats stats;
+    uint64_t sleepUs = 0;
+    int i;
 
-    uart_0 = UART2_open(CONFIG_UART2_0, &uartParams_0);
+    power_prof_getStats(&stats);
+    if (stats.elapsedUs == 0)
+    {
+        stats.elapsedUs = 1;
+    }
 
-    if (uart_0 == NULL)
+    for (i = 0; i < POWER_PROF_STATE_COUNT; i++)
     {
-        /* UART2_open() failed */
-        while (1) {}
+        sleepUs += stats.timeUs[i];
     }
 
-    UART2_Params_init(&uartParams_1);
-    uartParams_1.baudRate = 115200;
+    test_uart_printf("\r\npower: %u ms, active %u%%, standby blocked %u times\r\n",
+                     (uint32_t)(stats.elapsedUs / 1000),
+                     (uint32_t)(((stats.elapsedUs - sleepUs) * 100) / stats.elapsedUs),
+                     stats.standbyBlocked);
 
-    uart_1 = UART2_open(CONFIG_UART2_1, &uartParams_1);
+    for (i = 0; i < POWER_PROF_STATE_COUNT; i++)
+    {
+        test_uart_printf("%s: %u%% entries %u avg %u us max %u us\r\n",
+                         power_prof_stateName((PowerProf_State)i),
+                         (uint32_t)((stats.timeUs[i] * 100) / stats.elapsedUs),
+                         stats.entries[i],
+                         stats.entries[i] ? (uint32_t)(stats.timeUs[i] / stats.entries[i]) : 0,
+                         stats.maxUs[i]);
+    }
 
-    if (uart_1 == NULL)
+    test_uart_printf("wake: clock %u gpio %u uart %u radio %u other %u\r\n",
+                     stats.wakeups[POWER_PROF_WAKE_CLOCK],
+                     stats.wakeups[POWER_PROF_WAKE_GPIO],
+                     stats.wakeups[POWER_PROF_WAKE_UART],
+                     stats.wakeups[POWER_PROF_WAKE_RADIO],
+                     stats.wakeups[POWER_PROF_WAKE_OTHER]);
+
+    if (cmd == 'P')
     {
-        /* UART2_open() failed */
-        while (1) {}
+        power_prof_reset();
     }
+}
 
-    UART2_write(uart_1, tempStr, strlen(tempStr), &bytesWritten);
+/*
+ *  ======== test_uart_cmdBridge ========
+ *  'b': bridge uart_0 and uart_1 until test_uart_bridgeStop() is called.
+ *  The console is off the air meanwhile; log output keeps queueing (and
+ *  dropping once full) and is sent when the bridge stops.
+ */
+static void test_uart_cmdBridge(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_puts("\r\nbridge: uart_0 <-> uart_1, press BTN-1 to exit\r\n");
 
+    bridgeStartRequest = true;
+    sched_timer(uartTasklet, TEST_UART_EVENT_BRIDGE, TEST_UART_BRIDGE_POLL_MS);
 }
 
-void test_uart_loop(void)
+/*
+ *  ======== test_uart_bridgeEnter ========
+ *  Let the console finish, then take uart_1 from the log and commands.
+ *  Retried from the bridge timer until the log has gone quiet.
+ */
+static void test_uart_bridgeEnter(void)
 {
-    int status           = UART2_STATUS_SUCCESS;
+    if (uart_log_pending() != 0)
+    {
+        return;
+    }
+    uart_log_suspend();
+    if (uart_log_isBusy())
+    {
+        return;
+    }
+    uart_cmd_stop();
+    sched_timer(uartTasklet, 0, 0);
+
+    bridgeStartRequest = false;
+    bridgeStopRequest  = false;
+    bridgeMode         = true;
+    UART2_rxEnable(uart_0);
+    uart_bridge_start();
+}
 
-    bytesRead = 0;
-    status = UART2_readTimeout(uart_1, &input, 1, &bytesRead, 1000); // 1ms
-    if (status == UART2_STATUS_SUCCESS)
+/*
+ *  ======== test_uart_bridgeStopped ========
+ *  From the UART callback that finished the bridge's last transfer.
+ */
+static void test_uart_bridgeStopped(void)
+{
+    bridgeStopped = true;
+    sched_post(uartTasklet, TEST_UART_EVENT_BRIDGE);
+}
+
+/*
+ *  ======== test_uart_bridgeExit ========
+ *  Hand uart_1 back to the log and commands once the bridge has
+ *  drained.
+ */
+static void test_uart_bridgeExit(void)
+{
+    UartBridge_Stats stats[2];
+    int i;
+
+    UART2_rxDisable(uart_0);
+    bridgeMode = false;
+
+    uart_cmd_start();
+    uart_log_resume();
+
+    for (i = 0; i < 2; i++)
     {
-        bytesWritten = 0;
-        sprintf(tempStr, "\r\ninput:%d\r\n", (int)input);
-        UART2_write(uart_1, tempStr, strlen(tempStr), &bytesWritten);
+        uart_bridge_getStats(i, &stats[i]);
+    }
+    test_uart_printf("\r\nbridge: 0->1 rx %u tx %u overruns %u stalls %u\r\n",
+                     stats[UART_BRIDGE_DIR_0_TO_1].rxBytes,
+                     stats[UART_BRIDGE_DIR_0_TO_1].txBytes,
+                     stats[UART_BRIDGE_DIR_0_TO_1].overruns,
+                     stats[UART_BRIDGE_DIR_0_TO_1].stalls);
+    test_uart_printf("bridge: 1->0 rx %u tx %u overruns %u stalls %u\r\n",
+                     stats[UART_BRIDGE_DIR_1_TO_0].rxBytes,
+                     stats[UART_BRIDGE_DIR_1_TO_0].txBytes,
+                     stats[UART_BRIDGE_DIR_1_TO_0].overruns,
+                     stats[UART_BRIDGE_DIR_1_TO_0].stalls);
+}
 
-        bytesWritten = 0;
-        while (bytesWritten == 0)
-        {
-            status = UART2_write(uart_1, &input, 1, &bytesWritten);
-        }
+/*
+ *  ======== test_uart_bridgeStop ========
+ *  Safe to call from an ISR; the bridge is torn down in the uart tasklet.
+ */
+void test_uart_bridgeStop(void)
+{
+    if (bridgeMode)
+    {
+        bridgeStopRequest = true;
+        sched_post(uartTasklet, TEST_UART_EVENT_BRIDGE);
+    }
+}
 
-        // send other uart to test 
-        bytesWritten = 0;
-        while (bytesWritten == 0)
-        {
-            status = UART2_write(uart_0, &input, 1, &bytesWritten);
-        }
+/*
+ *  ======== test_uart_readCallback1 ========
+ *  uart_1 callbacks go to whichever of console and bridge owns the port.
+ */
+static void test_uart_readCallback1(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status)
+{
+    if (bridgeMode)
+    {
+        uart_bridge_readCallback(handle, buf, count, userArg, status);
+    }
+    else
+    {
+        uart_cmd_readCallback(handle, buf, count, userArg, status);
+    }
+}
+
+static void test_uart_writeCallback1(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status)
+{
+    if (bridgeMode)
+    {
+        uart_bridge_writeCallback(handle, buf, count, userArg, status);
+    }
+    else
+    {
+        uart_log_writeCallback(handle, buf, count, userArg, status);
+    }
+}
+
+/*
+ *  ======== test_uart_rxNotify ========
+ *  Called from the uart_1 read callback when console input arrives.
+ */
+static void test_uart_rxNotify(void)
+{
+    sched_post(uartTasklet, TEST_UART_EVENT_RX);
+}
+
+/*
+ *  ======== test_uart_tasklet ========
+ */
+static void test_uart_tasklet(uint32_t events)
+{
+    if (bridgeStopRequest)
+    {
+        /* The ports are released when test_uart_bridgeStopped() runs */
+        bridgeStopRequest = false;
+        uart_bridge_stop(test_uart_bridgeStopped);
     }
 
-    bytesRead = 0;
-    status = UART2_readTimeout(uart_0, &input, 1, &bytesRead, 1000); // 1ms
-    if (status == UART2_STATUS_SUCCESS)
+    if (bridgeStopped)
     {
-        bytesWritten = 0;
-        sprintf(tempStr, "\r\noutput:%d\r\n", (int)input);
-        UART2_write(uart_1, tempStr, strlen(tempStr), &bytesWritten);
+        bridgeStopped = false;
+        test_uart_bridgeExit();
+    }
 
-        GPIO_toggle(CONFIG_GPIO_LED_1);
+    if (bridgeStartRequest)
+    {
+        test_uart_bridgeEnter();
+    }
 
+    if (events & TEST_UART_EVENT_RX)
+    {
+        uart_cmd_process(0);
     }
-    
+
+    uart_trace_flush();
+}
+
+static const UartCmd_Entry uartCmdTable[] = {
+    {0x01, test_uart_cmdPing},
+    {'b', test_uart_cmdBridge},
+    {'s', test_uart_cmdStats},
+    {'l', test_uart_cmdLog},
+    {'p', test_uart_cmdPower},
+    {'P', test_uart_cmdPower},
+};
+
+void test_uart_init(void)
+{
+    /* uart_0 is only used by the bridge; its receiver stays off until then */
+    UART2_Params_init(&uartParams_0);
+    uartParams_0.baudRate       = 9600;
+    uartParams_0.writeMode      = UART2_Mode_CALLBACK;
+    uartParams_0.writeCallback  = uart_bridge_writeCallback;
+    uartParams_0.readMode       = UART2_Mode_CALLBACK;
+    uartParams_0.readReturnMode = UART2_ReadReturnMode_PARTIAL;
+    uartParams_0.readCallback   = uart_bridge_readCallback;
+
+    uart_0 = UART2_open(CONFIG_UART2_0, &uartParams_0);
+
+    if (uart_0 == NULL)
+    {
+        /* UART2_open() failed */
+        while (1) {}
+    }
+
+    UART2_rxDisable(uart_0);
+
+    UART2_Params_init(&uartParams_1);
+    uartParams_1.baudRate       = 115200;
+    uartParams_1.writeMode      = UART2_Mode_CALLBACK;
+    uartParams_1.writeCallback  = test_uart_writeCallback1;
+    uartParams_1.readMode       = UART2_Mode_CALLBACK;
+    uartParams_1.readReturnMode = UART2_ReadReturnMode_PARTIAL;
+    uartParams_1.readCallback   = test_uart_readCallback1;
+
+    uart_1 = UART2_open(CONFIG_UART2_1, &uartParams_1);
+
+    if (uart_1 == NULL)
+    {
+        /* UART2_open() failed */
+        while (1) {}
+    }
+
+    uartTasklet = sched_register("uart", test_uart_tasklet);
+
+    uart_log_init(uart_1);
+    uart_bridge_init(uart_0, uart_1);
+    uart_trace_register(&consoleTrace);
+    uart_cmd_setNotify(test_uart_rxNotify);
+    uart_cmd_init(uart_1, uartCmdTable, sizeof(uartCmdTable) / sizeof(uartCmdTable[0]), test_uart_cmdInput);
+
+    test_uart_puts(tempStr);
+
 }
@@ -1,11 +1,14 @@
 
 #include "stdio.h"
 #include "string.h"
+#include "stdarg.h"
 
 void test_uart_init(void);
 
-void test_uart_loop(void);
-
 void test_uart_puts(char *str);
 
 void test_uart_print(char *str, size_t len);
+
+void test_uart_printf(const char *format, ...);
+
+void test_uart_bridgeStop(void);
@@ -45,21 +45,56 @@
 /* Driver configuration */
 #include "ti_drivers_config.h"
 
+#include "sched.h"
+#include "wdt_supervisor.h"
+#include "uart_log.h"
+#include "test_uart.h"
+
 #define TIMEOUT_MS 3000
-#define SLEEP_US   100000
+
+/*
+ * The wdt tasklet checks in every WDT_TASKLET_PERIOD_MS; a tasklet that
+ * keeps the scheduler busy for longer than the deadline delays it.
+ */
+#define WDT_TASKLET_PERIOD_MS 250
+#define SCHED_DEADLINE_MS     1000
+
+/* Event of the wdt tasklet, posted by its timer */
+#define TEST_WDT_EVENT_CHECKIN 0x1
 
 Watchdog_Handle watchdogHandle;
 Watchdog_Params params;
 uint32_t reloadValue;
 
+static int schedClient;
+
 /*
  *  ======== watchdogCallback ========
  */
 void watchdogCallback(uintptr_t watchdogHandle)
 {
+    /* Keep the loop statistics for the report at the next boot */
+    wdt_supervisor_freeze();
     Power_reset();
 }
 
+/*
+ *  ======== watchdogHeartbeat ========
+ *  Called from the supervisor clock each time the watchdog is cleared.
+ */
+static void watchdogHeartbeat(void)
+{
+    GPIO_toggle(CONFIG_GPIO_LED_0);
+}
+
+/*
+ *  ======== test_wdt_tasklet ========
+ */
+static void test_wdt_tasklet(uint32_t events)
+{
+    wdt_supervisor_checkin(schedClient);
+}
+
 void test_wdt_init()
 {
     Watchdog_init();
@@ -83,16 +118,34 @@ void test_wdt_init()
         Watchdog_setReload(watchdogHandle, reloadValue);
     }
 
+    schedClient = wdt_supervisor_register("sched", SCHED_DEADLINE_MS);
+    wdt_supervisor_start(watchdogHandle, watchdogHeartbeat);
+
+    sched_timer(sched_register("wdt", test_wdt_tasklet), TEST_WDT_EVENT_CHECKIN, WDT_TASKLET_PERIOD_MS);
 }
 
-void test_wdt_loop()
+/*
+ *  ======== reportLine ========
+ *  Console output for the boot report; waits for room rather than
+ *  dropping lines, since the report is larger than the log ring.
+ */
+static void reportLine(const char *line)
+{
+    size_t len = strlen(line);
+
+    while (UART_LOG_BUF_SIZE - uart_log_pending() < len)
+    {
+        usleep(1000);
+    }
+    test_uart_puts((char *)line);
+}
+
+/*
+ *  ======== test_wdt_report ========
+ *  Print the loop statistics left by a watchdog reset, then start
+ *  collecting them for this run. Call once the console is up.
+ */
+void test_wdt_report()
 {
-    GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_OFF);
-    Watchdog_clear(watchdogHandle);
-    Power_disablePolicy();
-    usleep(SLEEP_US);
-    Watchdog_clear(watchdogHandle);
-    Power_enablePolicy();
-    GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_ON);
-    // GPIO_toggle(CONFIG_GPIO_LED_0);
+    wdt_supervisor_dump(reportLine);
 }
@@ -1,4 +1,4 @@
 
-void test_wtd_init(void);
+void test_wdt_init(void);
 
-void test_wtd_loop(void);
+void test_wdt_report(void);
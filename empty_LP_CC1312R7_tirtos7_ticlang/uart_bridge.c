@@ -0,0 +1,226 @@
+/*
+ *  ======== uart_bridge.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Driver Header files */
+#include <ti/drivers/UART2.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "uart_bridge.h"
+
+/*
+ * rxSeq counts buffers filled and txSeq buffers sent, so buffer
+ * (seq % UART_BRIDGE_NUM_BUFS) is the next one to read into or send, and
+ * rxSeq - txSeq is the number of filled buffers not yet sent. The read and
+ * write callbacks of one direction come from different UARTs, so state
+ * changes are made with interrupts disabled.
+ */
+typedef struct
+{
+    UART2_Handle rx;
+    UART2_Handle tx;
+    volatile uint32_t rxSeq;
+    volatile uint32_t txSeq;
+    volatile bool rxActive;
+    volatile bool txActive;
+    size_t len[UART_BRIDGE_NUM_BUFS];
+    UartBridge_Stats stats;
+    uint8_t buf[UART_BRIDGE_NUM_BUFS][UART_BRIDGE_BUF_SIZE];
+} UartBridge_Dir;
+
+static UartBridge_Dir bridgeDir[2] __attribute__((aligned(4)));
+static volatile bool bridgeRunning;
+
+/* Set by uart_bridge_stop() until the ports have gone idle */
+static volatile bool bridgeStopping;
+static UartBridge_StoppedFxn bridgeStoppedFxn;
+
+/*
+ *  ======== uart_bridge_armRx ========
+ */
+static void uart_bridge_armRx(UartBridge_Dir *dir)
+{
+    if (!bridgeRunning || dir->rxActive)
+    {
+        return;
+    }
+
+    if (dir->rxSeq - dir->txSeq >= UART_BRIDGE_NUM_BUFS)
+    {
+        dir->stats.stalls++;
+        return;
+    }
+
+    dir->rxActive = true;
+    UART2_read(dir->rx, dir->buf[dir->rxSeq % UART_BRIDGE_NUM_BUFS], UART_BRIDGE_BUF_SIZE, NULL);
+}
+
+/*
+ *  ======== uart_bridge_startTx ========
+ */
+static void uart_bridge_startTx(UartBridge_Dir *dir)
+{
+    uint32_t idx;
+
+    if (dir->txActive || dir->txSeq == dir->rxSeq)
+    {
+        return;
+    }
+
+    idx           = dir->txSeq % UART_BRIDGE_NUM_BUFS;
+    dir->txActive = true;
+    UART2_write(dir->tx, dir->buf[idx], dir->len[idx], NULL);
+}
+
+/*
+ *  ======== uart_bridge_takeStopped ========
+ *  Once stopping and nothing is left in flight, return the stopped
+ *  function to call, only once. Called with interrupts disabled.
+ */
+static UartBridge_StoppedFxn uart_bridge_takeStopped(void)
+{
+    int i;
+
+    if (!bridgeStopping)
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        if (bridgeDir[i].rxActive || bridgeDir[i].txActive || bridgeDir[i].txSeq != bridgeDir[i].rxSeq)
+        {
+            return NULL;
+        }
+    }
+
+    bridgeStopping = false;
+
+    return bridgeStoppedFxn;
+}
+
+void uart_bridge_init(UART2_Handle port0, UART2_Handle port1)
+{
+    bridgeDir[UART_BRIDGE_DIR_0_TO_1].rx = port0;
+    bridgeDir[UART_BRIDGE_DIR_0_TO_1].tx = port1;
+    bridgeDir[UART_BRIDGE_DIR_1_TO_0].rx = port1;
+    bridgeDir[UART_BRIDGE_DIR_1_TO_0].tx = port0;
+}
+
+void uart_bridge_start(void)
+{
+    uintptr_t key;
+
+    key           = HwiP_disable();
+    bridgeRunning = true;
+    uart_bridge_armRx(&bridgeDir[UART_BRIDGE_DIR_0_TO_1]);
+    uart_bridge_armRx(&bridgeDir[UART_BRIDGE_DIR_1_TO_0]);
+    HwiP_restore(key);
+}
+
+void uart_bridge_stop(UartBridge_StoppedFxn stoppedFxn)
+{
+    UartBridge_StoppedFxn stopped;
+    uintptr_t key;
+    int i;
+
+    key              = HwiP_disable();
+    bridgeRunning    = false;
+    bridgeStoppedFxn = stoppedFxn;
+    bridgeStopping   = true;
+    HwiP_restore(key);
+
+    for (i = 0; i < 2; i++)
+    {
+        UART2_readCancel(bridgeDir[i].rx);
+    }
+
+    /* Nothing in flight means no callback is left to report it */
+    key     = HwiP_disable();
+    stopped = uart_bridge_takeStopped();
+    HwiP_restore(key);
+
+    if (stopped != NULL)
+    {
+        stopped();
+    }
+}
+
+bool uart_bridge_isRunning(void)
+{
+    return bridgeRunning;
+}
+
+void uart_bridge_getStats(int dir, UartBridge_Stats *stats)
+{
+    *stats = bridgeDir[dir].stats;
+}
+
+/*
+ *  ======== uart_bridge_readCallback ========
+ */
+void uart_bridge_readCallback(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status)
+{
+    UartBridge_Dir *dir = (handle == bridgeDir[UART_BRIDGE_DIR_0_TO_1].rx) ? &bridgeDir[UART_BRIDGE_DIR_0_TO_1]
+                                                                           : &bridgeDir[UART_BRIDGE_DIR_1_TO_0];
+    UartBridge_StoppedFxn stopped;
+    uintptr_t key;
+
+    key           = HwiP_disable();
+    dir->rxActive = false;
+
+    if (status == UART2_STATUS_EOVERRUN)
+    {
+        dir->stats.overruns++;
+    }
+
+    if (count != 0)
+    {
+        dir->len[dir->rxSeq % UART_BRIDGE_NUM_BUFS] = count;
+        dir->rxSeq++;
+        dir->stats.rxBytes += count;
+        uart_bridge_startTx(dir);
+    }
+
+    if (status != UART2_STATUS_ECANCELLED)
+    {
+        uart_bridge_armRx(dir);
+    }
+    stopped = uart_bridge_takeStopped();
+    HwiP_restore(key);
+
+    if (stopped != NULL)
+    {
+        stopped();
+    }
+}
+
+/*
+ *  ======== uart_bridge_writeCallback ========
+ */
+void uart_bridge_writeCallback(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status)
+{
+    UartBridge_Dir *dir = (handle == bridgeDir[UART_BRIDGE_DIR_0_TO_1].tx) ? &bridgeDir[UART_BRIDGE_DIR_0_TO_1]
+                                                                           : &bridgeDir[UART_BRIDGE_DIR_1_TO_0];
+    UartBridge_StoppedFxn stopped;
+    uintptr_t key;
+
+    key = HwiP_disable();
+    dir->stats.txBytes += count;
+    dir->txActive = false;
+    dir->txSeq++;
+
+    /* Send the next filled buffer and resume a read held back for room */
+    uart_bridge_startTx(dir);
+    uart_bridge_armRx(dir);
+    stopped = uart_bridge_takeStopped();
+    HwiP_restore(key);
+
+    if (stopped != NULL)
+    {
+        stopped();
+    }
+}
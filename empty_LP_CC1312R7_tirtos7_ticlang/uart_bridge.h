@@ -0,0 +1,70 @@
+/*
+ *  ======== uart_bridge.h ========
+ *  Full-duplex bridge between two UART2 ports.
+ *
+ *  Each direction owns UART_BRIDGE_NUM_BUFS buffers used in turn. A buffer
+ *  filled by a read on one port is handed, without copying, to a write on
+ *  the other port from the read callback, while the next read goes into
+ *  the following buffer. When every buffer of a direction is waiting to be
+ *  sent the read is not re-armed, so the slower side backs up into the
+ *  UART2 receive ring instead of overwriting data in flight.
+ *
+ *  Both ports must be opened with read and write callback mode, partial
+ *  read return, and uart_bridge_readCallback/uart_bridge_writeCallback.
+ */
+#ifndef UART_BRIDGE_H_
+#define UART_BRIDGE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ti/drivers/UART2.h>
+
+/* Buffers per direction */
+#ifndef UART_BRIDGE_NUM_BUFS
+    #define UART_BRIDGE_NUM_BUFS 2
+#endif
+
+/* Bytes per buffer */
+#ifndef UART_BRIDGE_BUF_SIZE
+    #define UART_BRIDGE_BUF_SIZE 128
+#endif
+
+typedef struct
+{
+    uint32_t rxBytes;
+    uint32_t txBytes;
+    uint32_t overruns;  /* UART2 reported a receive overrun */
+    uint32_t stalls;    /* Reads held back because no buffer was free */
+} UartBridge_Stats;
+
+/* Direction indices for uart_bridge_getStats() */
+#define UART_BRIDGE_DIR_0_TO_1 0
+#define UART_BRIDGE_DIR_1_TO_0 1
+
+void uart_bridge_init(UART2_Handle port0, UART2_Handle port1);
+
+/* Start bridging; both ports must be free of other readers and writers */
+void uart_bridge_start(void);
+
+/* Called once the bridge has stopped and the ports may be handed back */
+typedef void (*UartBridge_StoppedFxn)(void);
+
+/*
+ * Stop reading on both ports and return. Data already received is still
+ * sent; stoppedFxn is called, from the UART callback that finishes the
+ * last transfer or from here if nothing is in flight, once both ports
+ * are idle. The ports must not be reused before then.
+ */
+void uart_bridge_stop(UartBridge_StoppedFxn stoppedFxn);
+
+bool uart_bridge_isRunning(void);
+
+void uart_bridge_getStats(int dir, UartBridge_Stats *stats);
+
+void uart_bridge_readCallback(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status);
+
+void uart_bridge_writeCallback(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status);
+
+#endif /* UART_BRIDGE_H_ */
@@ -0,0 +1,287 @@
+/*
+ *  ======== uart_log.c ========
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/UART2.h>
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/HwiP.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+
+#include "uart_log.h"
+
+#define UART_LOG_MASK (UART_LOG_BUF_SIZE - 1)
+
+#if (UART_LOG_BUF_SIZE & UART_LOG_MASK) != 0
+    #error "UART_LOG_BUF_SIZE must be a power of two"
+#endif
+
+/* How often uart_log_waitExternal() retries a write the driver refused */
+#define UART_LOG_RETRY_MS 10
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t len;
+    uint32_t at; /* Ring head when queued; ring bytes before it go first */
+} UartLog_Ext;
+
+/*
+ * head is only written by the producer, tail and busy only by the drain.
+ * Both indices run freely and are masked on access, so head - tail is
+ * always the fill level. extIn and extOut do the same for the queue of
+ * caller-owned buffers, extIn written by the producer and extOut by the
+ * drain.
+ */
+static struct
+{
+    UART2_Handle handle;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile bool busy;
+    volatile bool suspended;
+    volatile bool extActive;
+    size_t txLen;
+    volatile uint32_t extIn;
+    volatile uint32_t extOut;
+    UartLog_Ext ext[UART_LOG_EXT_DEPTH];
+    SemaphoreP_Struct extSemStruct;
+    SemaphoreP_Handle extSem;
+    UartLog_Stats stats;
+    uint8_t buf[UART_LOG_BUF_SIZE];
+} uartLog __attribute__((aligned(4)));
+
+/*
+ *  ======== uart_log_startTx ========
+ *  Start the next contiguous chunk. Must be called from the write callback
+ *  or with hardware interrupts disabled. If UART2_write() refuses the
+ *  chunk, e.g. with UART2_STATUS_EINUSE, no callback will come, so the
+ *  drain goes idle and the next write, resume or wait starts it again.
+ */
+static void uart_log_startTx(void)
+{
+    uint32_t tail = uartLog.tail;
+    uint32_t idx  = tail & UART_LOG_MASK;
+    size_t len    = uartLog.head - tail;
+    UartLog_Ext *ext;
+
+    if (uartLog.handle == NULL || uartLog.suspended)
+    {
+        uartLog.busy = false;
+        return;
+    }
+
+    /* A queued external buffer goes out once the ring has caught up to it */
+    if (uartLog.extOut != uartLog.extIn)
+    {
+        ext = &uartLog.ext[uartLog.extOut % UART_LOG_EXT_DEPTH];
+        if (tail == ext->at)
+        {
+            uartLog.busy      = true;
+            uartLog.extActive = true;
+            if (UART2_write(uartLog.handle, ext->data, ext->len, NULL) != UART2_STATUS_SUCCESS)
+            {
+                uartLog.stats.writeErrors++;
+                uartLog.extActive = false;
+                uartLog.busy      = false;
+            }
+            return;
+        }
+        len = ext->at - tail;
+    }
+
+    if (len == 0)
+    {
+        uartLog.busy = false;
+        return;
+    }
+
+    /* Stop at the end of the buffer, the wrapped part goes next time */
+    if (len > UART_LOG_BUF_SIZE - idx)
+    {
+        len = UART_LOG_BUF_SIZE - idx;
+    }
+
+    uartLog.busy  = true;
+    uartLog.txLen = len;
+    if (UART2_write(uartLog.handle, &uartLog.buf[idx], len, NULL) != UART2_STATUS_SUCCESS)
+    {
+        uartLog.stats.writeErrors++;
+        uartLog.txLen = 0;
+        uartLog.busy  = false;
+    }
+}
+
+/*
+ *  ======== uart_log_kick ========
+ *  Start the drain if it is idle. It may be going idle at the same
+ *  moment; checking busy with interrupts off closes the window where a
+ *  kick could be lost.
+ */
+static void uart_log_kick(void)
+{
+    uintptr_t key;
+
+    if (!uartLog.busy)
+    {
+        key = HwiP_disable();
+        if (!uartLog.busy)
+        {
+            uart_log_startTx();
+        }
+        HwiP_restore(key);
+    }
+}
+
+void uart_log_init(UART2_Handle handle)
+{
+    uartLog.handle = handle;
+    uartLog.extSem = SemaphoreP_constructBinary(&uartLog.extSemStruct, 0);
+}
+
+/*
+ *  ======== uart_log_writeCallback ========
+ */
+void uart_log_writeCallback(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status)
+{
+    if (uartLog.extActive)
+    {
+        uartLog.stats.bytesSent += uartLog.ext[uartLog.extOut % UART_LOG_EXT_DEPTH].len;
+        uartLog.extActive = false;
+        uartLog.extOut++;
+        SemaphoreP_post(uartLog.extSem);
+
+        uart_log_startTx();
+        return;
+    }
+
+    /*
+     * Release the whole chunk even on error or a short count so a broken
+     * link cannot wedge the ring; the bytes are lost either way.
+     */
+    uartLog.tail += uartLog.txLen;
+    uartLog.stats.bytesSent += uartLog.txLen;
+    uartLog.txLen = 0;
+
+    uart_log_startTx();
+}
+
+bool uart_log_write(const void *data, size_t len)
+{
+    uint32_t head = uartLog.head;
+    uint32_t used = head - uartLog.tail;
+    uint32_t idx;
+    size_t first;
+
+    if (len == 0)
+    {
+        return true;
+    }
+
+    if (len > UART_LOG_BUF_SIZE - used)
+    {
+        uartLog.stats.dropped++;
+        return false;
+    }
+
+    idx   = head & UART_LOG_MASK;
+    first = UART_LOG_BUF_SIZE - idx;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(&uartLog.buf[idx], data, first);
+    memcpy(&uartLog.buf[0], (const uint8_t *)data + first, len - first);
+
+    /* Publish only after the copy is complete */
+    __asm volatile("" ::: "memory");
+    uartLog.head = head + len;
+
+    uartLog.stats.bytesQueued += len;
+    if (used + len > uartLog.stats.highWater)
+    {
+        uartLog.stats.highWater = used + len;
+    }
+
+    uart_log_kick();
+
+    return true;
+}
+
+bool uart_log_writeExternal(const void *data, size_t len)
+{
+    uint32_t in = uartLog.extIn;
+    UartLog_Ext *ext;
+
+    if (len == 0)
+    {
+        return true;
+    }
+
+    if (in - uartLog.extOut >= UART_LOG_EXT_DEPTH)
+    {
+        return false;
+    }
+
+    ext       = &uartLog.ext[in % UART_LOG_EXT_DEPTH];
+    ext->data = data;
+    ext->len  = len;
+    ext->at   = uartLog.head;
+
+    __asm volatile("" ::: "memory");
+    uartLog.extIn = in + 1;
+
+    uartLog.stats.bytesQueued += len;
+
+    uart_log_kick();
+
+    return true;
+}
+
+void uart_log_waitExternal(size_t maxPending)
+{
+    uint32_t retry = (UART_LOG_RETRY_MS * 1000) / ClockP_getSystemTickPeriod();
+
+    while (uartLog.extIn - uartLog.extOut > maxPending)
+    {
+        /* Nothing else restarts a write the driver refused */
+        uart_log_kick();
+        SemaphoreP_pend(uartLog.extSem, retry);
+    }
+}
+
+void uart_log_suspend(void)
+{
+    uartLog.suspended = true;
+}
+
+void uart_log_resume(void)
+{
+    uintptr_t key;
+
+    key               = HwiP_disable();
+    uartLog.suspended = false;
+    if (!uartLog.busy)
+    {
+        uart_log_startTx();
+    }
+    HwiP_restore(key);
+}
+
+bool uart_log_isBusy(void)
+{
+    return uartLog.busy;
+}
+
+size_t uart_log_pending(void)
+{
+    return uartLog.head - uartLog.tail;
+}
+
+void uart_log_getStats(UartLog_Stats *stats)
+{
+    *stats = uartLog.stats;
+}
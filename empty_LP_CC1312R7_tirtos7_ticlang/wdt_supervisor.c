@@ -0,0 +1,358 @@
+/*
+ *  ======== wdt_supervisor.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/Watchdog.h>
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "wdt_supervisor.h"
+
+#define WDT_SUPERVISOR_MAGIC 0x57445331 /* "WDS1" */
+
+typedef struct
+{
+    const char *name;
+    uint32_t deadline;          /* In clock ticks */
+    volatile uint32_t lastTick; /* Tick of the last check-in */
+    uint32_t beginTick;
+    bool begun;
+} WdtSupervisor_Client;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t bins[WDT_SUPERVISOR_HIST_BINS];
+} WdtSupervisor_Hist;
+
+typedef struct
+{
+    char name[WDT_SUPERVISOR_NAME_LEN];
+    uint32_t sinceLast; /* Ticks since the last check-in when frozen */
+    WdtSupervisor_Hist iteration;
+    WdtSupervisor_Hist gap;
+} WdtSupervisor_ClientRecord;
+
+/*
+ * Statistics of the current run, left alone by the C startup code. Once
+ * sealed, checksum covers everything before it and nothing more is
+ * recorded until the next boot.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sealed;
+    uint32_t tickPeriod;
+    int32_t expired;
+    uint32_t count;
+    WdtSupervisor_ClientRecord clients[WDT_SUPERVISOR_MAX_CLIENTS];
+    uint32_t checksum;
+} WdtSupervisor_Record;
+
+static WdtSupervisor_Record wdtRecord __attribute__((section(".noinit")));
+
+static struct
+{
+    Watchdog_Handle handle;
+    void (*heartbeat)(void);
+    ClockP_Struct clockStruct;
+    ClockP_Handle clock;
+    volatile int count;
+    volatile int expired;
+    volatile bool recording;
+    WdtSupervisor_Client clients[WDT_SUPERVISOR_MAX_CLIENTS];
+} wdtSupervisor = {.expired = WDT_SUPERVISOR_NONE};
+
+/*
+ *  ======== wdt_supervisor_checksum ========
+ */
+static uint32_t wdt_supervisor_checksum(void)
+{
+    const uint32_t *word = (const uint32_t *)&wdtRecord;
+    size_t count         = offsetof(WdtSupervisor_Record, checksum) / sizeof(uint32_t);
+    uint32_t sum         = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        sum = ((sum << 1) | (sum >> 31)) + word[i];
+    }
+
+    return sum;
+}
+
+/*
+ *  ======== wdt_supervisor_add ========
+ */
+static void wdt_supervisor_add(WdtSupervisor_Hist *hist, uint32_t ticks)
+{
+    uint32_t bin = (ticks > 1) ? 31 - __builtin_clz(ticks) : 0;
+
+    if (bin >= WDT_SUPERVISOR_HIST_BINS)
+    {
+        bin = WDT_SUPERVISOR_HIST_BINS - 1;
+    }
+
+    if (hist->count == 0 || ticks < hist->min)
+    {
+        hist->min = ticks;
+    }
+    if (ticks > hist->max)
+    {
+        hist->max = ticks;
+    }
+    hist->count++;
+    hist->sum += ticks;
+    hist->bins[bin]++;
+}
+
+/*
+ *  ======== wdt_supervisor_seal ========
+ *  Freeze the record for the next boot. Called from the clock callback
+ *  or with hardware interrupts disabled.
+ */
+static void wdt_supervisor_seal(uint32_t now)
+{
+    int i;
+
+    if (!wdtSupervisor.recording)
+    {
+        return;
+    }
+    wdtSupervisor.recording = false;
+
+    for (i = 0; i < (int)wdtRecord.count; i++)
+    {
+        wdtRecord.clients[i].sinceLast = now - wdtSupervisor.clients[i].lastTick;
+    }
+
+    wdtRecord.expired  = wdtSupervisor.expired;
+    wdtRecord.sealed   = 1;
+    wdtRecord.checksum = wdt_supervisor_checksum();
+}
+
+/*
+ *  ======== wdt_supervisor_clockFxn ========
+ */
+static void wdt_supervisor_clockFxn(uintptr_t arg)
+{
+    uint32_t now = ClockP_getSystemTicks();
+    int i;
+
+    for (i = 0; i < wdtSupervisor.count; i++)
+    {
+        if (wdtSupervisor.clients[i].deadline != 0 &&
+            now - wdtSupervisor.clients[i].lastTick > wdtSupervisor.clients[i].deadline)
+        {
+            if (wdtSupervisor.expired == WDT_SUPERVISOR_NONE)
+            {
+                wdtSupervisor.expired = i;
+                wdt_supervisor_seal(now);
+            }
+            return;
+        }
+    }
+
+    Watchdog_clear(wdtSupervisor.handle);
+
+    if (wdtSupervisor.heartbeat != NULL)
+    {
+        wdtSupervisor.heartbeat();
+    }
+}
+
+/*
+ *  ======== wdt_supervisor_toUs ========
+ */
+static uint32_t wdt_supervisor_toUs(uint64_t ticks)
+{
+    return (uint32_t)(ticks * wdtRecord.tickPeriod);
+}
+
+/*
+ *  ======== wdt_supervisor_printHist ========
+ */
+static void wdt_supervisor_printHist(void (*print)(const char *line), const char *label, const WdtSupervisor_Hist *hist)
+{
+    char line[192];
+    int len;
+    int i;
+
+    if (hist->count == 0)
+    {
+        return;
+    }
+
+    snprintf(line,
+             sizeof(line),
+             "  %s n=%lu min %lu avg %lu max %lu us\r\n",
+             label,
+             (unsigned long)hist->count,
+             (unsigned long)wdt_supervisor_toUs(hist->min),
+             (unsigned long)wdt_supervisor_toUs(hist->sum / hist->count),
+             (unsigned long)wdt_supervisor_toUs(hist->max));
+    print(line);
+
+    len = snprintf(line, sizeof(line), "  %s log2:", label);
+    for (i = 0; i < WDT_SUPERVISOR_HIST_BINS && len < (int)sizeof(line) - 12; i++)
+    {
+        len += snprintf(&line[len], sizeof(line) - len, " %lu", (unsigned long)hist->bins[i]);
+    }
+    snprintf(&line[len], sizeof(line) - len, "\r\n");
+    print(line);
+}
+
+void wdt_supervisor_start(Watchdog_Handle handle, void (*heartbeat)(void))
+{
+    ClockP_Params clockParams;
+    uint32_t period = (WDT_SUPERVISOR_PERIOD_MS * 1000) / ClockP_getSystemTickPeriod();
+
+    wdtSupervisor.handle    = handle;
+    wdtSupervisor.heartbeat = heartbeat;
+
+    ClockP_Params_init(&clockParams);
+    clockParams.period    = period;
+    clockParams.startFlag = true;
+    wdtSupervisor.clock   = ClockP_construct(&wdtSupervisor.clockStruct, wdt_supervisor_clockFxn, period, &clockParams);
+}
+
+int wdt_supervisor_register(const char *name, uint32_t deadlineMs)
+{
+    WdtSupervisor_Client *client;
+    uintptr_t key;
+    int id = WDT_SUPERVISOR_NONE;
+
+    key = HwiP_disable();
+    if (wdtSupervisor.count < WDT_SUPERVISOR_MAX_CLIENTS)
+    {
+        id               = wdtSupervisor.count;
+        client           = &wdtSupervisor.clients[id];
+        client->name     = name;
+        client->deadline = (deadlineMs * 1000) / ClockP_getSystemTickPeriod();
+        client->lastTick = ClockP_getSystemTicks();
+        client->begun    = false;
+
+        if (wdtSupervisor.recording)
+        {
+            memset(&wdtRecord.clients[id], 0, sizeof(wdtRecord.clients[id]));
+            strncpy(wdtRecord.clients[id].name, name, WDT_SUPERVISOR_NAME_LEN - 1);
+            wdtRecord.count = id + 1;
+        }
+
+        /* Only count the client once it is filled in */
+        wdtSupervisor.count = id + 1;
+    }
+    HwiP_restore(key);
+
+    return id;
+}
+
+void wdt_supervisor_begin(int id)
+{
+    wdtSupervisor.clients[id].beginTick = ClockP_getSystemTicks();
+    wdtSupervisor.clients[id].begun     = true;
+}
+
+void wdt_supervisor_checkin(int id)
+{
+    WdtSupervisor_Client *client = &wdtSupervisor.clients[id];
+    uint32_t now                 = ClockP_getSystemTicks();
+    uintptr_t key;
+
+    /* Keep the clock callback from sealing the record halfway through */
+    key = HwiP_disable();
+    if (wdtSupervisor.recording)
+    {
+        wdt_supervisor_add(&wdtRecord.clients[id].gap, now - client->lastTick);
+        if (client->begun)
+        {
+            wdt_supervisor_add(&wdtRecord.clients[id].iteration, now - client->beginTick);
+        }
+    }
+    HwiP_restore(key);
+
+    client->begun    = false;
+    client->lastTick = now;
+}
+
+void wdt_supervisor_dump(void (*print)(const char *line))
+{
+    char line[96];
+    uintptr_t key;
+    int i;
+
+    if (wdtRecord.magic == WDT_SUPERVISOR_MAGIC && wdtRecord.sealed && wdtRecord.count <= WDT_SUPERVISOR_MAX_CLIENTS &&
+        wdtRecord.checksum == wdt_supervisor_checksum())
+    {
+        if (wdtRecord.expired >= 0 && wdtRecord.expired < (int32_t)wdtRecord.count)
+        {
+            snprintf(line,
+                     sizeof(line),
+                     "Watchdog: \"%s\" missed its deadline, loop statistics of the last run:\r\n",
+                     wdtRecord.clients[wdtRecord.expired].name);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "Watchdog: loop statistics of the last run:\r\n");
+        }
+        print(line);
+
+        snprintf(line, sizeof(line), "  (log2 bins of %lu us ticks)\r\n", (unsigned long)wdtRecord.tickPeriod);
+        print(line);
+
+        for (i = 0; i < (int)wdtRecord.count; i++)
+        {
+            wdtRecord.clients[i].name[WDT_SUPERVISOR_NAME_LEN - 1] = '\0';
+            snprintf(line,
+                     sizeof(line),
+                     "%s: last check-in %lu us before\r\n",
+                     wdtRecord.clients[i].name,
+                     (unsigned long)wdt_supervisor_toUs(wdtRecord.clients[i].sinceLast));
+            print(line);
+            wdt_supervisor_printHist(print, "iter", &wdtRecord.clients[i].iteration);
+            wdt_supervisor_printHist(print, "gap", &wdtRecord.clients[i].gap);
+        }
+    }
+
+    /* Start this run's record with the clients registered so far */
+    key = HwiP_disable();
+    memset(&wdtRecord, 0, sizeof(wdtRecord));
+    wdtRecord.magic      = WDT_SUPERVISOR_MAGIC;
+    wdtRecord.tickPeriod = ClockP_getSystemTickPeriod();
+    wdtRecord.expired    = WDT_SUPERVISOR_NONE;
+    for (i = 0; i < wdtSupervisor.count; i++)
+    {
+        strncpy(wdtRecord.clients[i].name, wdtSupervisor.clients[i].name, WDT_SUPERVISOR_NAME_LEN - 1);
+    }
+    wdtRecord.count         = wdtSupervisor.count;
+    wdtSupervisor.recording = (wdtSupervisor.expired == WDT_SUPERVISOR_NONE);
+    HwiP_restore(key);
+}
+
+void wdt_supervisor_freeze(void)
+{
+    uintptr_t key;
+
+    key = HwiP_disable();
+    wdt_supervisor_seal(ClockP_getSystemTicks());
+    HwiP_restore(key);
+}
+
+int wdt_supervisor_expired(void)
+{
+    return wdtSupervisor.expired;
+}
+
+const char *wdt_supervisor_name(int id)
+{
+    return (id >= 0 && id < wdtSupervisor.count) ? wdtSupervisor.clients[id].name : "";
+}
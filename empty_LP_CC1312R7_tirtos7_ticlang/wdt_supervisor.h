@@ -0,0 +1,90 @@
+/*
+ *  ======== wdt_supervisor.h ========
+ *  Watchdog service driven by a periodic clock instead of a loop.
+ *
+ *  Every task or loop that must keep running registers as a client with
+ *  a deadline and calls wdt_supervisor_checkin() each time it makes
+ *  progress. A ClockP callback runs every WDT_SUPERVISOR_PERIOD_MS and
+ *  clears the watchdog only if every client has checked in within its
+ *  deadline; otherwise it leaves the watchdog to expire and remembers
+ *  the first client found late.
+ *
+ *  Each client also gets statistics kept in a .noinit record that
+ *  survives a reset: min/avg/max and a log2 histogram of the time between
+ *  check-ins and, for clients that mark the start of their work with
+ *  wdt_supervisor_begin(), of the time from begin to check-in. When a
+ *  client is found late the record is frozen and checksummed, so after
+ *  the watchdog reset wdt_supervisor_dump() can show which loop was using
+ *  up the budget. Statistics for the new run start once that is done.
+ */
+#ifndef WDT_SUPERVISOR_H_
+#define WDT_SUPERVISOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ti/drivers/Watchdog.h>
+
+#ifndef WDT_SUPERVISOR_MAX_CLIENTS
+    #define WDT_SUPERVISOR_MAX_CLIENTS 8
+#endif
+
+/* Check period; must be well below the watchdog timeout */
+#ifndef WDT_SUPERVISOR_PERIOD_MS
+    #define WDT_SUPERVISOR_PERIOD_MS 500
+#endif
+
+/* Histogram bins; bin k counts times of [2^k, 2^(k+1)) clock ticks */
+#ifndef WDT_SUPERVISOR_HIST_BINS
+    #define WDT_SUPERVISOR_HIST_BINS 20
+#endif
+
+/* Client name length kept in the record, including the terminator */
+#ifndef WDT_SUPERVISOR_NAME_LEN
+    #define WDT_SUPERVISOR_NAME_LEN 12
+#endif
+
+#define WDT_SUPERVISOR_NONE (-1)
+
+/*
+ * Start checking clients and servicing handle. heartbeat, if not NULL,
+ * is called from the clock callback each time the watchdog is cleared.
+ */
+void wdt_supervisor_start(Watchdog_Handle handle, void (*heartbeat)(void));
+
+/*
+ * Add a client that must check in at least every deadlineMs. Returns the
+ * client id, or WDT_SUPERVISOR_NONE if the table is full. The deadline
+ * starts counting at registration. A deadlineMs of 0 registers a client
+ * that only has its statistics kept and is never found late.
+ */
+int wdt_supervisor_register(const char *name, uint32_t deadlineMs);
+
+/*
+ * Mark the start of an iteration of client id. Only the client's own
+ * task may call this and wdt_supervisor_checkin() for it.
+ */
+void wdt_supervisor_begin(int id);
+
+/* Record progress for client id, ending an iteration started by begin */
+void wdt_supervisor_checkin(int id);
+
+/*
+ * If the previous run left a frozen record, print it line by line with
+ * print, which may block. Then start recording for this run. Call once
+ * at boot when the console is up.
+ */
+void wdt_supervisor_dump(void (*print)(const char *line));
+
+/*
+ * Freeze the record now, e.g. from the watchdog callback when it fires
+ * without a client having been found late.
+ */
+void wdt_supervisor_freeze(void);
+
+/* First client found past its deadline, or WDT_SUPERVISOR_NONE */
+int wdt_supervisor_expired(void);
+
+const char *wdt_supervisor_name(int id);
+
+#endif /* WDT_SUPERVISOR_H_ */
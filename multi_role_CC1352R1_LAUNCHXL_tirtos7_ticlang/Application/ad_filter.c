@@ -0,0 +1,284 @@
+/*
+ *  ======== ad_filter.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ad_filter.h"
+
+/* AD types, from the Core Specification Supplement */
+#define AD_TYPE_UUID16_MORE      0x02
+#define AD_TYPE_UUID16_COMPLETE  0x03
+#define AD_TYPE_UUID128_MORE     0x06
+#define AD_TYPE_UUID128_COMPLETE 0x07
+#define AD_TYPE_NAME_SHORT       0x08
+#define AD_TYPE_NAME_COMPLETE    0x09
+#define AD_TYPE_MANUF            0xFF
+
+#define AD_UUID128_LEN 16
+
+static void ad_filter_want(AdFilter *filter, uint8_t adType)
+{
+    filter->adTypes[adType / 32] |= 1u << (adType % 32);
+}
+
+int ad_filter_compile(AdFilter *filter, const AdFilter_Rule *rules, uint8_t count, int8_t rssiFloor)
+{
+    const AdFilter_Rule *r;
+    uint16_t uuid;
+    uint8_t i;
+    uint8_t j;
+
+    memset(filter, 0, sizeof(*filter));
+    filter->rssiFloor = rssiFloor;
+
+    for (r = rules; r < rules + count; r++)
+    {
+        switch (r->kind)
+        {
+            case AD_FILTER_RULE_UUID16:
+                if (filter->numUuid16 == AD_FILTER_MAX_UUID16)
+                {
+                    return AD_FILTER_STATUS_INVALID;
+                }
+                /* Insertion sort, for the binary search in ad_filter_match() */
+                for (j = filter->numUuid16; j > 0 && filter->uuid16[j - 1] > r->id; j--)
+                {
+                    filter->uuid16[j] = filter->uuid16[j - 1];
+                }
+                filter->uuid16[j] = r->id;
+                filter->numUuid16++;
+                ad_filter_want(filter, AD_TYPE_UUID16_MORE);
+                ad_filter_want(filter, AD_TYPE_UUID16_COMPLETE);
+                break;
+
+            case AD_FILTER_RULE_UUID128:
+                if (filter->numUuid128 == AD_FILTER_MAX_RULES)
+                {
+                    return AD_FILTER_STATUS_INVALID;
+                }
+                filter->uuid128[filter->numUuid128++] = r;
+                ad_filter_want(filter, AD_TYPE_UUID128_MORE);
+                ad_filter_want(filter, AD_TYPE_UUID128_COMPLETE);
+                break;
+
+            case AD_FILTER_RULE_MANUF:
+                if (filter->numManuf == AD_FILTER_MAX_RULES)
+                {
+                    return AD_FILTER_STATUS_INVALID;
+                }
+                filter->manuf[filter->numManuf++] = r;
+                ad_filter_want(filter, AD_TYPE_MANUF);
+                break;
+
+            case AD_FILTER_RULE_NAME_PREFIX:
+                if (filter->numName == AD_FILTER_MAX_RULES)
+                {
+                    return AD_FILTER_STATUS_INVALID;
+                }
+                filter->name[filter->numName++] = r;
+                ad_filter_want(filter, AD_TYPE_NAME_SHORT);
+                ad_filter_want(filter, AD_TYPE_NAME_COMPLETE);
+                break;
+
+            default:
+                return AD_FILTER_STATUS_INVALID;
+        }
+    }
+
+    /* Duplicate UUIDs would only cost time */
+    for (i = 1, j = 1; i < filter->numUuid16; i++)
+    {
+        uuid = filter->uuid16[i];
+        if (uuid != filter->uuid16[j - 1])
+        {
+            filter->uuid16[j++] = uuid;
+        }
+    }
+    if (filter->numUuid16 > 0)
+    {
+        filter->numUuid16 = j;
+    }
+
+    return AD_FILTER_STATUS_SUCCESS;
+}
+
+static bool ad_filter_uuid16(const AdFilter *filter, const uint8_t *p, uint8_t len)
+{
+    uint16_t uuid;
+    uint8_t lo;
+    uint8_t hi;
+    uint8_t mid;
+
+    for (; len >= 2; p += 2, len -= 2)
+    {
+        uuid = (uint16_t)(p[0] | (p[1] << 8));
+        lo   = 0;
+        hi   = filter->numUuid16;
+        while (lo < hi)
+        {
+            mid = (lo + hi) / 2;
+            if (filter->uuid16[mid] == uuid)
+            {
+                return true;
+            }
+            if (filter->uuid16[mid] < uuid)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool ad_filter_uuid128(const AdFilter *filter, const uint8_t *p, uint8_t len)
+{
+    uint8_t i;
+
+    for (; len >= AD_UUID128_LEN; p += AD_UUID128_LEN, len -= AD_UUID128_LEN)
+    {
+        for (i = 0; i < filter->numUuid128; i++)
+        {
+            if (memcmp(p, filter->uuid128[i]->value, AD_UUID128_LEN) == 0)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool ad_filter_manuf(const AdFilter *filter, const uint8_t *p, uint8_t len)
+{
+    const AdFilter_Rule *r;
+    uint16_t company;
+    uint8_t i;
+    uint8_t k;
+
+    if (len < 2)
+    {
+        return false;
+    }
+    company = (uint16_t)(p[0] | (p[1] << 8));
+    p += 2;
+    len -= 2;
+
+    for (i = 0; i < filter->numManuf; i++)
+    {
+        r = filter->manuf[i];
+        if (r->id != company || r->len > len)
+        {
+            continue;
+        }
+        for (k = 0; k < r->len; k++)
+        {
+            uint8_t m = (r->mask != NULL) ? r->mask[k] : 0xFF;
+
+            if ((p[k] & m) != (r->value[k] & m))
+            {
+                break;
+            }
+        }
+        if (k == r->len)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool ad_filter_name(const AdFilter *filter, const uint8_t *p, uint8_t len)
+{
+    const AdFilter_Rule *r;
+    uint8_t i;
+
+    for (i = 0; i < filter->numName; i++)
+    {
+        r = filter->name[i];
+        if (r->len <= len && memcmp(p, r->value, r->len) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int ad_filter_match(const AdFilter *filter, const uint8_t *data, uint16_t len, int8_t rssi)
+{
+    const uint8_t *end = data + len;
+    uint8_t adLen;
+    uint8_t adType;
+    bool match;
+
+    if (rssi != AD_FILTER_RSSI_UNKNOWN && rssi < filter->rssiFloor)
+    {
+        return AD_FILTER_TOO_WEAK;
+    }
+    if (filter->numUuid16 + filter->numUuid128 + filter->numManuf + filter->numName == 0)
+    {
+        /* No rules: only the floor applies */
+        return AD_FILTER_MATCH;
+    }
+    if (data == NULL)
+    {
+        return AD_FILTER_NOMATCH;
+    }
+
+    /* Each structure is a length byte, then a type byte and length - 1 bytes of data */
+    while (end - data >= 2)
+    {
+        adLen = data[0];
+        if (adLen == 0)
+        {
+            /* Zero padding ends the significant part */
+            break;
+        }
+        if (adLen > end - data - 1)
+        {
+            /* Malformed; trust nothing from here on */
+            break;
+        }
+
+        adType = data[1];
+        if (filter->adTypes[adType / 32] & (1u << (adType % 32)))
+        {
+            switch (adType)
+            {
+                case AD_TYPE_UUID16_MORE:
+                case AD_TYPE_UUID16_COMPLETE:
+                    match = ad_filter_uuid16(filter, data + 2, adLen - 1);
+                    break;
+
+                case AD_TYPE_UUID128_MORE:
+                case AD_TYPE_UUID128_COMPLETE:
+                    match = ad_filter_uuid128(filter, data + 2, adLen - 1);
+                    break;
+
+                case AD_TYPE_MANUF:
+                    match = ad_filter_manuf(filter, data + 2, adLen - 1);
+                    break;
+
+                default:
+                    match = ad_filter_name(filter, data + 2, adLen - 1);
+                    break;
+            }
+            if (match)
+            {
+                return AD_FILTER_MATCH;
+            }
+        }
+
+        data += adLen + 1;
+    }
+
+    return AD_FILTER_NOMATCH;
+}
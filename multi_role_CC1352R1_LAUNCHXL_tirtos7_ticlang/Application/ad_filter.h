@@ -0,0 +1,85 @@
+/*
+ *  ======== ad_filter.h ========
+ *  Filter for advertising and scan response data.
+ *
+ *  A list of rules is compiled once into an AdFilter. The filter holds
+ *  the set of AD types the rules look at and the rules grouped by kind,
+ *  with the 16-bit UUIDs sorted. A report is then checked in a single
+ *  pass over its AD structures, in place and without copying. AD types
+ *  no rule asks about are skipped with one bit test. The check stops at
+ *  the first rule that matches, and at the first structure that overruns
+ *  the buffer.
+ *
+ *  A report matches if its RSSI reaches the floor and any one rule
+ *  matches it; a filter compiled from no rules matches every report that
+ *  reaches the floor. Reports with no RSSI (AD_FILTER_RSSI_UNKNOWN) are not held
+ *  to the floor. The filter only reads its state, so it can be used from
+ *  the scan callback.
+ */
+#ifndef AD_FILTER_H_
+#define AD_FILTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef AD_FILTER_MAX_UUID16
+    #define AD_FILTER_MAX_UUID16 8
+#endif
+
+/* Rules of each other kind */
+#ifndef AD_FILTER_MAX_RULES
+    #define AD_FILTER_MAX_RULES 4
+#endif
+
+/* Rule kinds */
+#define AD_FILTER_RULE_UUID16      0   /* id: 16-bit service UUID */
+#define AD_FILTER_RULE_UUID128     1   /* value: 16 bytes, little endian */
+#define AD_FILTER_RULE_MANUF       2   /* id: company; value/mask: len bytes of the data after it */
+#define AD_FILTER_RULE_NAME_PREFIX 3   /* value: len bytes the local name starts with */
+
+/* Results of ad_filter_match() */
+#define AD_FILTER_NOMATCH  0
+#define AD_FILTER_MATCH    1
+#define AD_FILTER_TOO_WEAK 2    /* Below the RSSI floor; content not checked */
+
+#define AD_FILTER_STATUS_SUCCESS (0)
+#define AD_FILTER_STATUS_INVALID (-1)
+
+/* RSSI reported when the controller has none */
+#define AD_FILTER_RSSI_UNKNOWN 127
+
+typedef struct
+{
+    uint8_t kind;           /* AD_FILTER_RULE_* */
+    uint8_t len;            /* Of value and mask for MANUF and NAME_PREFIX */
+    uint16_t id;            /* UUID16 or company identifier */
+    const uint8_t *value;
+    const uint8_t *mask;    /* MANUF only; NULL compares every bit */
+} AdFilter_Rule;
+
+typedef struct
+{
+    uint32_t adTypes[8];    /* Bit per AD type some rule looks at */
+    int8_t rssiFloor;
+    uint8_t numUuid16;
+    uint8_t numUuid128;
+    uint8_t numManuf;
+    uint8_t numName;
+    uint16_t uuid16[AD_FILTER_MAX_UUID16];  /* Sorted */
+    const AdFilter_Rule *uuid128[AD_FILTER_MAX_RULES];
+    const AdFilter_Rule *manuf[AD_FILTER_MAX_RULES];
+    const AdFilter_Rule *name[AD_FILTER_MAX_RULES];
+} AdFilter;
+
+/*
+ * Build filter from count rules, which must stay in memory while the
+ * filter is used. Returns AD_FILTER_STATUS_INVALID for unknown kinds or
+ * too many rules of a kind, leaving filter partly built; compile it again
+ * before use.
+ */
+int ad_filter_compile(AdFilter *filter, const AdFilter_Rule *rules, uint8_t count, int8_t rssiFloor);
+
+/* Check len bytes of AD structures received with rssi */
+int ad_filter_match(const AdFilter *filter, const uint8_t *data, uint16_t len, int8_t rssi);
+
+#endif /* AD_FILTER_H_ */
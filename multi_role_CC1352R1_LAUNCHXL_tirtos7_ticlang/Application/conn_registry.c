@@ -0,0 +1,175 @@
+/*
+ *  ======== conn_registry.c ========
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "conn_registry.h"
+
+#if CONN_REGISTRY_MAX_CONNS > 32
+    #error "conn_registry keeps its free slots in a 32-bit mask"
+#endif
+
+#if (CONN_REGISTRY_MAP_SIZE & (CONN_REGISTRY_MAP_SIZE - 1)) != 0 || \
+    CONN_REGISTRY_MAP_SIZE < CONN_REGISTRY_MAX_CONNS
+    #error "CONN_REGISTRY_MAP_SIZE must be a power of two of at least CONN_REGISTRY_MAX_CONNS"
+#endif
+
+#define CONN_REGISTRY_NO_HANDLE 0xFFFF
+#define CONN_REGISTRY_EMPTY     0
+
+#define CONN_REGISTRY_BUCKET(h) ((h) & (CONN_REGISTRY_MAP_SIZE - 1))
+
+static struct
+{
+    uint16_t handles[CONN_REGISTRY_MAX_CONNS];
+    uint8_t gens[CONN_REGISTRY_MAX_CONNS];
+    uint8_t map[CONN_REGISTRY_MAP_SIZE];   /* Bucket to slot + 1, or EMPTY */
+    uint32_t freeSlots;                    /* Bit per free slot */
+    uint8_t spilled;                       /* Live handles missing from map */
+} reg;
+
+/*
+ *  ======== conn_registry_scan ========
+ *  Slot of connHandle found the slow way, for handles that collided.
+ */
+static uint8_t conn_registry_scan(uint16_t connHandle)
+{
+    uint8_t i;
+
+    for (i = 0; i < CONN_REGISTRY_MAX_CONNS; i++)
+    {
+        if (reg.handles[i] == connHandle)
+        {
+            return i;
+        }
+    }
+
+    return CONN_REGISTRY_NONE;
+}
+
+void conn_registry_reset(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < CONN_REGISTRY_MAX_CONNS; i++)
+    {
+        /* Releasing a live slot makes it a new generation */
+        if (reg.handles[i] != CONN_REGISTRY_NO_HANDLE)
+        {
+            reg.gens[i]++;
+        }
+        reg.handles[i] = CONN_REGISTRY_NO_HANDLE;
+    }
+    memset(reg.map, CONN_REGISTRY_EMPTY, sizeof(reg.map));
+    reg.freeSlots = (CONN_REGISTRY_MAX_CONNS == 32) ? 0xFFFFFFFFu : ((1u << CONN_REGISTRY_MAX_CONNS) - 1);
+    reg.spilled   = 0;
+}
+
+uint8_t conn_registry_add(uint16_t connHandle)
+{
+    uint8_t slot = conn_registry_find(connHandle);
+    uint8_t *bucket;
+
+    if (slot != CONN_REGISTRY_NONE)
+    {
+        return slot;
+    }
+    if (reg.freeSlots == 0 || connHandle == CONN_REGISTRY_NO_HANDLE)
+    {
+        return CONN_REGISTRY_NONE;
+    }
+
+    slot = (uint8_t)__builtin_ctz(reg.freeSlots);
+    reg.freeSlots &= ~(1u << slot);
+    reg.handles[slot] = connHandle;
+
+    bucket = &reg.map[CONN_REGISTRY_BUCKET(connHandle)];
+    if (*bucket == CONN_REGISTRY_EMPTY)
+    {
+        *bucket = slot + 1;
+    }
+    else
+    {
+        reg.spilled++;
+    }
+
+    return slot;
+}
+
+uint8_t conn_registry_remove(uint16_t connHandle)
+{
+    uint8_t slot = conn_registry_find(connHandle);
+    uint16_t b   = CONN_REGISTRY_BUCKET(connHandle);
+    uint8_t i;
+
+    if (slot == CONN_REGISTRY_NONE)
+    {
+        return CONN_REGISTRY_NONE;
+    }
+
+    reg.handles[slot] = CONN_REGISTRY_NO_HANDLE;
+    reg.gens[slot]++;
+    reg.freeSlots |= 1u << slot;
+
+    if (reg.map[b] != slot + 1)
+    {
+        reg.spilled--;
+        return slot;
+    }
+
+    /* Let a handle that collided on this bucket take it over */
+    reg.map[b] = CONN_REGISTRY_EMPTY;
+    for (i = 0; i < CONN_REGISTRY_MAX_CONNS && reg.spilled > 0; i++)
+    {
+        if (reg.handles[i] != CONN_REGISTRY_NO_HANDLE && CONN_REGISTRY_BUCKET(reg.handles[i]) == b)
+        {
+            reg.map[b] = i + 1;
+            reg.spilled--;
+            break;
+        }
+    }
+
+    return slot;
+}
+
+uint8_t conn_registry_find(uint16_t connHandle)
+{
+    uint8_t entry = reg.map[CONN_REGISTRY_BUCKET(connHandle)];
+
+    if (entry != CONN_REGISTRY_EMPTY && reg.handles[entry - 1] == connHandle)
+    {
+        return entry - 1;
+    }
+    if (reg.spilled == 0 || connHandle == CONN_REGISTRY_NO_HANDLE)
+    {
+        return CONN_REGISTRY_NONE;
+    }
+
+    return conn_registry_scan(connHandle);
+}
+
+uint32_t conn_registry_ref(uint16_t connHandle)
+{
+    uint8_t slot = conn_registry_find(connHandle);
+
+    if (slot == CONN_REGISTRY_NONE)
+    {
+        return CONN_REGISTRY_REF_NONE;
+    }
+
+    return ((uint32_t)reg.gens[slot] << 24) | ((uint32_t)slot << 16) | connHandle;
+}
+
+uint8_t conn_registry_resolve(uint32_t ref)
+{
+    uint8_t slot = (uint8_t)(ref >> 16);
+
+    if (ref == CONN_REGISTRY_REF_NONE || slot >= CONN_REGISTRY_MAX_CONNS ||
+        reg.handles[slot] != (uint16_t)ref || reg.gens[slot] != (uint8_t)(ref >> 24))
+    {
+        return CONN_REGISTRY_NONE;
+    }
+
+    return slot;
+}
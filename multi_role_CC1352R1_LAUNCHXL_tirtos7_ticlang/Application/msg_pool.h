@@ -0,0 +1,52 @@
+/*
+ *  ======== msg_pool.h ========
+ *  Fixed-size block pool for application messages.
+ *
+ *  The blocks are carved out of caller-provided static memory and kept
+ *  on a singly linked free list, so taking and returning one is a couple
+ *  of pointer moves inside a short HwiP critical section: safe from
+ *  tasks, SWIs and HWIs, without blocking and without touching the heap.
+ *  When the pool is empty the caller is expected to fall back to the
+ *  heap; msg_pool_owns() tells the two apart when freeing.
+ */
+#ifndef MSG_POOL_H_
+#define MSG_POOL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint16_t blocks;
+    uint16_t inUse;
+    uint16_t peak;          /* Highest inUse seen */
+    uint32_t allocs;
+    uint32_t exhausted;     /* Allocations that found the pool empty */
+} MsgPool_Stats;
+
+typedef struct
+{
+    void *freeList;
+    uint8_t *base;
+    size_t blockSize;
+    MsgPool_Stats stats;
+} MsgPool;
+
+/*
+ * Split mem into count blocks of blockSize bytes, which must be a
+ * multiple of the pointer size and at least one pointer.
+ */
+void msg_pool_init(MsgPool *pool, void *mem, size_t blockSize, uint16_t count);
+
+/* A block, or NULL if the pool is empty */
+void *msg_pool_alloc(MsgPool *pool);
+
+void msg_pool_free(MsgPool *pool, void *block);
+
+/* True if block came from pool rather than from the heap */
+bool msg_pool_owns(const MsgPool *pool, const void *block);
+
+void msg_pool_getStats(MsgPool *pool, MsgPool_Stats *stats);
+
+#endif /* MSG_POOL_H_ */
@@ -91,6 +91,9 @@ Target Device: cc13xx_cc26xx
 #include "ti_ble_config.h"
 #include "multi_role_menu.h"
 #include "multi_role.h"
+#include "conn_registry.h"
+#include "scan_table.h"
+#include "ad_filter.h"
 
 /*********************************************************************
  * MACROS
@@ -115,6 +118,28 @@ Target Device: cc13xx_cc26xx
 #define MR_EVT_READ_RPA            12
 #define MR_EVT_INSUFFICIENT_MEM    13
 
+// App messages preallocated for the queue, and the largest event data
+// carried inside the message itself
+#ifndef MR_MSG_POOL_SIZE
+#define MR_MSG_POOL_SIZE           16
+#endif
+#define MR_MSG_INLINE_SIZE         4
+
+// Drop advertising reports from devices already turned down by the
+// service UUID filter in the scan callback, before they are parsed again
+#ifndef MR_SCAN_PREFILTER
+#define MR_SCAN_PREFILTER          TRUE
+#endif
+
+// Weakest RSSI, in dBm, of advertising reports passed to the app
+#ifndef MR_SCAN_RSSI_FLOOR
+#define MR_SCAN_RSSI_FLOOR         (-127)
+#endif
+
+#if (SCAN_TABLE_SIZE > DEFAULT_MAX_SCAN_RES)
+#error "SCAN_TABLE_SIZE is larger than the connect menu"
+#endif
+
 // Internal Events for RTOS application
 #define MR_ICALL_EVT                         ICALL_MSG_EVENT_ID // Event_Id_31
 #define MR_QUEUE_EVT                         UTIL_QUEUE_EVENT_ID // Event_Id_30
@@ -174,8 +199,12 @@ typedef enum {
 // App event passed from profiles.
 typedef struct
 {
+#ifndef FREERTOS
+  Queue_Elem _elem; // queue link, so no wrapper record is needed
+#endif
   uint8_t event;    // event type
   void *pData;   // event data pointer
+  uint8_t inlineData[MR_MSG_INLINE_SIZE]; // small event data, see multi_role_enqueueMsgCopy
 } mrEvt_t;
 
 // Container to store paring state info when passing from gapbondmgr callback
@@ -200,13 +229,6 @@ typedef struct
   uint32_t numComparison;
 } mrPasscodeData_t;
 
-// Scanned device information record
-typedef struct
-{
-  uint8_t addrType;         // Peer Device's Address Type
-  uint8_t addr[B_ADDR_LEN]; // Peer Device Address
-} scanRec_t;
-
 // Container to store information from clock expiration using a flexible array
 // since data is not always needed
 typedef struct
@@ -310,6 +332,10 @@ mrClockEventData_t argRpaRead =
 // Queue object used for app messages
 static Queue_Struct appMsg;
 static Queue_Handle appMsgQueue;
+
+// Preallocated app messages, taken before falling back to the heap
+static mrEvt_t mrMsgBlocks[MR_MSG_POOL_SIZE];
+static MsgPool mrMsgPool;
 #endif
 
 // Task configuration
@@ -334,14 +360,6 @@ uint8_t mrTaskStack[MR_TASK_STACK_SIZE];
 // Maximim PDU size (default = 27 octets)
 static uint16 mrMaxPduSize;
 
-#if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
-// Number of scan results filtered by Service UUID
-static uint8_t numScanRes = 0;
-
-// Scan results filtered by Service UUID
-static scanRec_t scanList[DEFAULT_MAX_SCAN_RES];
-#endif // DEFAULT_DEV_DISC_BY_SVC_UUID
-
 // Discovered service start and end handle
 static uint16_t svcStartHdl = 0;
 static uint16_t svcEndHdl = 0;
@@ -374,6 +392,17 @@ static uint8 rpa[B_ADDR_LEN] = {0};
 // Initiating PHY
 static uint8_t mrInitPhy = INIT_PHY_1M;
 
+#if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
+// Advertising data of the devices to discover
+static const AdFilter_Rule mrScanRules[] =
+{
+  { .kind = AD_FILTER_RULE_UUID16, .id = SIMPLEPROFILE_SERV_UUID },
+};
+
+// Compiled from mrScanRules; only read from the scan callback
+static AdFilter mrScanFilter;
+#endif // DEFAULT_DEV_DISC_BY_SVC_UUID
+
 /*********************************************************************
 * LOCAL FUNCTIONS
 */
@@ -400,6 +429,11 @@ static void multi_role_processAdvEvent(mrGapAdvEventData_t *pEventData);
 
 static void multi_role_charValueChangeCB(uint8_t paramID);
 static status_t multi_role_enqueueMsg(uint8_t event, void *pData);
+static status_t multi_role_enqueueMsgCopy(uint8_t event, const void *pData,
+                                          uint16_t len);
+static status_t multi_role_putMsg(mrEvt_t *pMsg);
+static mrEvt_t *multi_role_allocMsg(void);
+static void multi_role_freeMsg(mrEvt_t *pMsg);
 static void multi_role_handleKeys(uint8_t keys);
 static uint16_t multi_role_getConnIndex(uint16_t connHandle);
 static void multi_role_keyChangeHandler(uint8_t keys);
@@ -413,9 +447,7 @@ static void multi_role_clockHandler(UArg arg);
 #endif
 static uint8_t multi_role_clearConnListEntry(uint16_t connHandle);
 #if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
-static void multi_role_addScanInfo(uint8_t *pAddr, uint8_t addrType);
-static bool multi_role_findSvcUuid(uint16_t uuid, uint8_t *pData,
-                                      uint16_t dataLen);
+static bool multi_role_filterAdvReport(GapScan_Evt_AdvRpt_t *pAdvRpt);
 #endif // DEFAULT_DEV_DISC_BY_SVC_UUID
 static uint8_t multi_role_removeConnInfo(uint16_t connHandle);
 static void multi_role_menuSwitchCb(tbmMenuObj_t* pMenuObjCurr,
@@ -562,6 +594,7 @@ static void multi_role_init(void)
 #else
   // Create an RTOS queue for message from profile to be sent to app.
   appMsgQueue = Util_constructQueue(&appMsg);
+  msg_pool_init(&mrMsgPool, mrMsgBlocks, sizeof(mrEvt_t), MR_MSG_POOL_SIZE);
 #endif
   // Create one-shot clock for internal periodic events.
 #ifdef FREERTOS
@@ -752,14 +785,14 @@ static void multi_role_taskFxn(UArg a0, UArg a1)
 #else
           while (!Queue_empty(appMsgQueue))
                {
-                 mrEvt_t *pMsg = (mrEvt_t *)Util_dequeueMsg(appMsgQueue);
+                 mrEvt_t *pMsg = (mrEvt_t *)Queue_get(appMsgQueue);
                  if (pMsg)
                  {
                    // Process message.
                    multi_role_processAppMsg(pMsg);
 
-                   // Free the space from the message.
-                   ICall_free(pMsg);
+                   // Return the message to the pool or the heap.
+                   multi_role_freeMsg(pMsg);
                  }
                }
 #endif
@@ -1214,11 +1247,29 @@ static void multi_role_scanInit(void)
 {
   uint8_t temp8;
   uint16_t temp16;
+#if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
+  int status;
+#endif // DEFAULT_DEV_DISC_BY_SVC_UUID
 
   // Setup scanning
   // For more information, see the GAP section in the User's Guide:
   // http://software-dl.ti.com/lprf/ble5stack-latest/
 
+#if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
+  status = ad_filter_compile(&mrScanFilter, mrScanRules,
+                             sizeof(mrScanRules) / sizeof(mrScanRules[0]),
+                             MR_SCAN_RSSI_FLOOR);
+  if (status != AD_FILTER_STATUS_SUCCESS)
+  {
+    // mrScanRules has more rules of a kind than AD_FILTER_MAX_* allows, or
+    // an unknown kind. Rather than discover nothing, accept every report
+    // that reaches the RSSI floor.
+    Display_printf(dispHandle, MR_ROW_NON_CONN, 0,
+                   "Scan filter invalid (%d), not filtering", status);
+    ad_filter_compile(&mrScanFilter, mrScanRules, 0, MR_SCAN_RSSI_FLOOR);
+  }
+#endif // DEFAULT_DEV_DISC_BY_SVC_UUID
+
   // Register callback to process Scanner events
   GapScan_registerCb(multi_role_scanCB, NULL);
 
@@ -1515,10 +1566,14 @@ static void multi_role_processAppMsg(mrEvt_t *pMsg)
       GapScan_Evt_AdvRpt_t* pAdvRpt = (GapScan_Evt_AdvRpt_t*) (pMsg->pData);
 
 #if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
-      if (multi_role_findSvcUuid(SIMPLEPROFILE_SERV_UUID,
-                                 pAdvRpt->pData, pAdvRpt->dataLen))
+      bool isNew;
+
+      // The scan callback only queues reports that passed mrScanFilter.
+      // Track the device; show it only the first time it is heard
+      scan_table_update(pAdvRpt->addr, pAdvRpt->addrType, pAdvRpt->rssi,
+                        &isNew);
+      if (isNew)
       {
-        multi_role_addScanInfo(pAdvRpt->addr, pAdvRpt->addrType);
         Display_printf(dispHandle, MR_ROW_CUR_CONN, 0, "Discovered: %s",
                        Util_convertBdAddr2Str(pAdvRpt->addr));
       }
@@ -1553,7 +1608,12 @@ static void multi_role_processAppMsg(mrEvt_t *pMsg)
       uint8_t* pAddrTemp;
       uint16_t itemsToEnable = MR_ITEM_STARTDISC | MR_ITEM_ADVERTISE | MR_ITEM_PHY;
 #if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
-      numReport = numScanRes;
+      ScanTable_Stats scanStats;
+
+      numReport = scan_table_count();
+      scan_table_getStats(&scanStats);
+      BLE_LOG_INT_INT(0, BLE_LOG_MODULE_APP, "APP : Scan reports=%d, dropped early=%d\n",
+                      scanStats.reports, scanStats.dropped);
 #else // !DEFAULT_DEV_DISC_BY_SVC_UUID
       GapScan_Evt_AdvRpt_t advRpt;
 
@@ -1600,7 +1660,7 @@ static void multi_role_processAppMsg(mrEvt_t *pMsg)
   #if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
           // Get the address from the list, convert it to string, and
           // copy the string to the address buffer
-          memcpy(pAddrTemp, Util_convertBdAddr2Str(scanList[i].addr),
+          memcpy(pAddrTemp, Util_convertBdAddr2Str(scan_table_get(i)->addr),
                  MR_ADDR_STR_SIZE);
   #else // !DEFAULT_DEV_DISC_BY_SVC_UUID
           // Get the address from the report, convert it to string, and
@@ -1650,10 +1710,14 @@ static void multi_role_processAppMsg(mrEvt_t *pMsg)
 
     case MR_EVT_SEND_PARAM_UPDATE:
     {
-      // Extract connection handle from data
-      uint16_t locConnHandle = *(uint16_t *)(((mrClockEventData_t *)pMsg->pData)->data);
-      multi_role_processParamUpdate(locConnHandle);
-      safeToDealloc = FALSE;
+      uint32_t ref;
+
+      // Skip connections that ended after the clock expired
+      memcpy(&ref, pMsg->pData, sizeof(ref));
+      if (conn_registry_resolve(ref) < MAX_NUM_BLE_CONNS)
+      {
+        multi_role_processParamUpdate(conn_registry_refHandle(ref));
+      }
       break;
     }
 
@@ -1684,7 +1748,8 @@ static void multi_role_processAppMsg(mrEvt_t *pMsg)
       break;
   }
 
-  if ((safeToDealloc == TRUE) && (pMsg->pData != NULL))
+  if ((safeToDealloc == TRUE) && (pMsg->pData != NULL) &&
+      (pMsg->pData != pMsg->inlineData))
   {
     ICall_free(pMsg->pData);
   }
@@ -1755,103 +1820,52 @@ static void multi_role_processAdvEvent(mrGapAdvEventData_t *pEventData)
 
 #if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
 /*********************************************************************
- * @fn      multi_role_findSvcUuid
+ * @fn      multi_role_filterAdvReport
+ *
+ * @brief   Decide in the scan callback whether an advertising report is
+ *          passed to the app. The report is checked where the stack put
+ *          it, and devices that cannot match later in the scan are
+ *          remembered so their further reports are dropped unparsed.
  *
- * @brief   Find a given UUID in an advertiser's service UUID list.
+ * @param   pAdvRpt - advertising report
  *
- * @return  TRUE if service UUID found
+ * @return  TRUE if the report should be queued
  */
-static bool multi_role_findSvcUuid(uint16_t uuid, uint8_t *pData,
-                                      uint16_t dataLen)
+static bool multi_role_filterAdvReport(GapScan_Evt_AdvRpt_t *pAdvRpt)
 {
-  uint8_t adLen;
-  uint8_t adType;
-  uint8_t *pEnd;
+  int result;
 
-  if (dataLen > 0)
+#if (MR_SCAN_PREFILTER == TRUE)
+  if (scan_table_isRejected(pAdvRpt->addr))
   {
-    pEnd = pData + dataLen - 1;
-
-    // While end of data not reached
-    while (pData < pEnd)
-    {
-      // Get length of next AD item
-      adLen = *pData++;
-      if (adLen > 0)
-      {
-        adType = *pData;
-
-        // If AD type is for 16-bit service UUID
-        if ((adType == GAP_ADTYPE_16BIT_MORE) ||
-            (adType == GAP_ADTYPE_16BIT_COMPLETE))
-        {
-          pData++;
-          adLen--;
-
-          // For each UUID in list
-          while (adLen >= 2 && pData < pEnd)
-          {
-            // Check for match
-            if ((pData[0] == LO_UINT16(uuid)) && (pData[1] == HI_UINT16(uuid)))
-            {
-              // Match found
-              return TRUE;
-            }
-
-            // Go to next
-            pData += 2;
-            adLen -= 2;
-          }
-
-          // Handle possible erroneous extra byte in UUID list
-          if (adLen == 1)
-          {
-            pData++;
-          }
-        }
-        else
-        {
-          // Go to next item
-          pData += adLen;
-        }
-      }
-    }
+    return FALSE;
   }
+#endif // MR_SCAN_PREFILTER
 
-  // Match not found
-  return FALSE;
-}
-
-/*********************************************************************
- * @fn      multi_role_addScanInfo
- *
- * @brief   Add a device to the scanned device list
- *
- * @return  none
- */
-static void multi_role_addScanInfo(uint8_t *pAddr, uint8_t addrType)
-{
-  uint8_t i;
-
-  // If result count not at max
-  if (numScanRes < DEFAULT_MAX_SCAN_RES)
+  result = ad_filter_match(&mrScanFilter, pAdvRpt->pData, pAdvRpt->dataLen,
+                           pAdvRpt->rssi);
+  if (result == AD_FILTER_MATCH)
   {
-    // Check if device is already in scan results
-    for (i = 0; i < numScanRes; i++)
-    {
-      if (memcmp(pAddr, scanList[i].addr , B_ADDR_LEN) == 0)
-      {
-        return;
-      }
-    }
-
-    // Add addr to scan result list
-    memcpy(scanList[numScanRes].addr, pAddr, B_ADDR_LEN);
-    scanList[numScanRes].addrType = addrType;
+#if (MR_SCAN_PREFILTER == TRUE)
+    scan_table_accept(pAdvRpt->addr);
+#endif // MR_SCAN_PREFILTER
+    return TRUE;
+  }
 
-    // Increment scan result count
-    numScanRes++;
+#if (MR_SCAN_PREFILTER == TRUE)
+  // A weak report may be followed by a stronger one. Otherwise, if no scan
+  // response can follow this report and nothing from the device matched,
+  // the device is of no interest for the rest of the scan
+  if ((result == AD_FILTER_NOMATCH) &&
+      ((pAdvRpt->evtType & ADV_RPT_EVT_TYPE_SCAN_RSP) ||
+       !(pAdvRpt->evtType & ADV_RPT_EVT_TYPE_SCANNABLE)) &&
+      !scan_table_isAccepted(pAdvRpt->addr))
+  {
+    scan_table_reject(pAdvRpt->addr);
   }
+#endif // MR_SCAN_PREFILTER
+
+  return FALSE;
 }
 #endif // DEFAULT_DEV_DISC_BY_SVC_UUID
 
@@ -1891,6 +1905,22 @@ void multi_role_scanCB(uint32_t evt, void* pMsg, uintptr_t arg)
     return;
   }
 
+#if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
+  // Drop reports the app has no use for before they cost a message and a
+  // trip through the app queue
+  if ((event == MR_EVT_ADV_REPORT) &&
+      !multi_role_filterAdvReport((GapScan_Evt_AdvRpt_t *)pMsg))
+  {
+    scan_table_countDropped();
+    if (((GapScan_Evt_AdvRpt_t *)pMsg)->pData != NULL)
+    {
+      ICall_free(((GapScan_Evt_AdvRpt_t *)pMsg)->pData);
+    }
+    ICall_free(pMsg);
+    return;
+  }
+#endif
+
   if(multi_role_enqueueMsg(event, pMsg) != SUCCESS)
   {
     ICall_free(pMsg);
@@ -1910,19 +1940,8 @@ void multi_role_scanCB(uint32_t evt, void* pMsg, uintptr_t arg)
 */
 static void multi_role_charValueChangeCB(uint8_t paramID)
 {
-  uint8_t *pData;
-
-  // Allocate space for the event data.
-  if ((pData = ICall_malloc(sizeof(uint8_t))))
-  {
-    *pData = paramID;
-
-    // Queue the event.
-    if(multi_role_enqueueMsg(MR_EVT_CHAR_CHANGE, pData) != SUCCESS)
-    {
-      ICall_free(pData);
-    }
-  }
+  // Queue the event, with the parameter ID inside the message.
+  multi_role_enqueueMsgCopy(MR_EVT_CHAR_CHANGE, &paramID, sizeof(paramID));
 }
 
 /*********************************************************************
@@ -1938,25 +1957,149 @@ static void multi_role_charValueChangeCB(uint8_t paramID)
  */
 static status_t multi_role_enqueueMsg(uint8_t event, void *pData)
 {
-  uint8_t success;
-  mrEvt_t *pMsg = ICall_malloc(sizeof(mrEvt_t));
+  mrEvt_t *pMsg = multi_role_allocMsg();
 
-  // Create dynamic pointer to message.
+  // Take a message from the pool, or from the heap if it is empty.
   if (pMsg)
   {
     pMsg->event = event;
     pMsg->pData = pData;
 
-    // Enqueue the message.
+    return multi_role_putMsg(pMsg);
+  }
+
+  return(bleMemAllocError);
+}
+
+/*********************************************************************
+ * @fn      multi_role_enqueueMsgCopy
+ *
+ * @brief   Queues a message with a copy of the event data. Data of up
+ *          to MR_MSG_INLINE_SIZE bytes is kept inside the message, so
+ *          small events need no allocation of their own.
+ *
+ * @param   event - message event.
+ * @param   pData - event data to copy.
+ * @param   len - length of the event data.
+ *
+ * @return  SUCCESS, FAILURE or bleMemAllocError
+ */
+static status_t multi_role_enqueueMsgCopy(uint8_t event, const void *pData,
+                                          uint16_t len)
+{
+  mrEvt_t *pMsg = multi_role_allocMsg();
+  void *pCopy;
+  status_t status;
+
+  if (pMsg == NULL)
+  {
+    return(bleMemAllocError);
+  }
+
+  if (len <= MR_MSG_INLINE_SIZE)
+  {
+    pCopy = pMsg->inlineData;
+  }
+  else if ((pCopy = ICall_malloc(len)) == NULL)
+  {
+    multi_role_freeMsg(pMsg);
+    return(bleMemAllocError);
+  }
+  memcpy(pCopy, pData, len);
+
+  pMsg->event = event;
+  pMsg->pData = pCopy;
+
+  status = multi_role_putMsg(pMsg);
+  if ((status != SUCCESS) && (len > MR_MSG_INLINE_SIZE))
+  {
+    ICall_free(pCopy);
+  }
+
+  return status;
+}
+
+/*********************************************************************
+ * @fn      multi_role_putMsg
+ *
+ * @brief   Puts a filled-in message in the RTOS queue.
+ *
+ * @param   pMsg - message from multi_role_allocMsg().
+ *
+ * @return  SUCCESS or FAILURE
+ */
+static status_t multi_role_putMsg(mrEvt_t *pMsg)
+{
 #ifdef FREERTOS
-    success = Util_enqueueMsg(g_POSIX_appMsgQueue, syncEvent, (uint8_t *)pMsg);
+  uint8_t success;
+
+  success = Util_enqueueMsg(g_POSIX_appMsgQueue, syncEvent, (uint8_t *)pMsg);
+  return (success) ? SUCCESS : FAILURE;
 #else
-    success = Util_enqueueMsg(appMsgQueue, syncEvent, (uint8_t *)pMsg);
+  // The message carries its own queue link, so it goes on the queue as
+  // is instead of being wrapped in another allocation.
+  Queue_put(appMsgQueue, &pMsg->_elem);
+  Event_post(syncEvent, MR_QUEUE_EVT);
+  return SUCCESS;
 #endif
-    return (success) ? SUCCESS : FAILURE;
+}
+
+/*********************************************************************
+ * @fn      multi_role_allocMsg
+ *
+ * @brief   Takes a message from the pool, or from the heap when the pool
+ *          is empty.
+ *
+ * @return  The message, or NULL
+ */
+static mrEvt_t *multi_role_allocMsg(void)
+{
+#ifndef FREERTOS
+  mrEvt_t *pMsg = msg_pool_alloc(&mrMsgPool);
+
+  if (pMsg)
+  {
+    return pMsg;
   }
+#endif
 
-  return(bleMemAllocError);
+  return ICall_malloc(sizeof(mrEvt_t));
+}
+
+/*********************************************************************
+ * @fn      multi_role_freeMsg
+ *
+ * @brief   Returns a message to wherever multi_role_allocMsg() took it from.
+ *
+ * @param   pMsg - message to free.
+ */
+static void multi_role_freeMsg(mrEvt_t *pMsg)
+{
+#ifndef FREERTOS
+  if (msg_pool_owns(&mrMsgPool, pMsg))
+  {
+    msg_pool_free(&mrMsgPool, pMsg);
+    return;
+  }
+#endif
+
+  ICall_free(pMsg);
+}
+
+/*********************************************************************
+ * @fn      multi_role_getMsgPoolStats
+ *
+ * @brief   Usage of the app message pool.
+ *
+ * @param   stats - filled in with the pool counters.
+ */
+void multi_role_getMsgPoolStats(MsgPool_Stats *stats)
+{
+#ifndef FREERTOS
+  msg_pool_getStats(&mrMsgPool, stats);
+#else
+  memset(stats, 0, sizeof(*stats));
+#endif
 }
 
 /*********************************************************************
@@ -2081,8 +2224,10 @@ static void multi_role_clockHandler(UArg arg)
   }
   else if (pData->event == MR_EVT_SEND_PARAM_UPDATE)
   {
-    // Send message to app
-    multi_role_enqueueMsg(MR_EVT_SEND_PARAM_UPDATE, pData);
+    // Send a copy of the connection reference, since pData is freed
+    // if the connection ends before the app gets to the message
+    multi_role_enqueueMsgCopy(MR_EVT_SEND_PARAM_UPDATE, pData->data,
+                              sizeof(uint32_t));
   }
 }
 
@@ -2097,14 +2242,7 @@ static void multi_role_clockHandler(UArg arg)
 */
 static void multi_role_keyChangeHandler(uint8_t keys)
 {
-  uint8_t *pValue = ICall_malloc(sizeof(uint8_t));
-
-  if (pValue)
-  {
-    *pValue = keys;
-
-    multi_role_enqueueMsg(MR_EVT_KEY_CHANGE, pValue);
-  }
+  multi_role_enqueueMsgCopy(MR_EVT_KEY_CHANGE, &keys, sizeof(keys));
 }
 
 /*********************************************************************
@@ -2250,19 +2388,8 @@ static void multi_role_processGATTDiscEvent(gattMsgEvent_t *pMsg)
 */
 static uint16_t multi_role_getConnIndex(uint16_t connHandle)
 {
-  uint8_t i;
-  // Loop through connection
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
-  {
-    // If matching connection handle found
-    if (connList[i].connHandle == connHandle)
-    {
-      return i;
-    }
-  }
-
-  // Not found if we got here
-  return(MAX_NUM_BLE_CONNS);
+  // Direct lookup; connList[] slots are handed out by the registry
+  return conn_registry_find(connHandle);
 }
 
 #ifndef Display_DISABLE_ALL
@@ -2277,14 +2404,11 @@ static uint16_t multi_role_getConnIndex(uint16_t connHandle)
  */
 static char* multi_role_getConnAddrStr(uint16_t connHandle)
 {
-  uint8_t i;
+  uint8_t i = conn_registry_find(connHandle);
 
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+  if (i < MAX_NUM_BLE_CONNS)
   {
-    if (connList[i].connHandle == connHandle)
-    {
-      return Util_convertBdAddr2Str(connList[i].addr);
-    }
+    return Util_convertBdAddr2Str(connList[i].addr);
   }
 
   return NULL;
@@ -2307,13 +2431,17 @@ static uint8_t multi_role_clearConnListEntry(uint16_t connHandle)
 
   if(connHandle != LINKDB_CONNHANDLE_ALL)
   {
-    connIndex = multi_role_getConnIndex(connHandle);
-    // Get connection index from handle
+    // Release the connection index of the handle
+    connIndex = conn_registry_remove(connHandle);
     if(connIndex >= MAX_NUM_BLE_CONNS)
     {
       return bleInvalidRange;
     }
   }
+  else
+  {
+    conn_registry_reset();
+  }
 
   // Clear specific handle or all handles
   for(i = 0; i < MAX_NUM_BLE_CONNS; i++)
@@ -2546,65 +2674,63 @@ static void multi_role_startSvcDiscovery(void)
 static uint8_t multi_role_addConnInfo(uint16_t connHandle, uint8_t *pAddr,
                                       uint8_t role)
 {
-  uint8_t i;
+  // Take the lowest free entry for the new connection
+  uint8_t i = conn_registry_add(connHandle);
 
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+  if (i < MAX_NUM_BLE_CONNS)
   {
-    if (connList[i].connHandle == LINKDB_CONNHANDLE_INVALID)
-    {
-      // Found available entry to put a new connection info in
-      connList[i].connHandle = connHandle;
-      memcpy(connList[i].addr, pAddr, B_ADDR_LEN);
-      numConn++;
+    connList[i].connHandle = connHandle;
+    memcpy(connList[i].addr, pAddr, B_ADDR_LEN);
+    numConn++;
 
 #ifdef DEFAULT_SEND_PARAM_UPDATE_REQ
-      // If a peripheral, start the clock to send a connection parameter update
-      if(role == GAP_PROFILE_PERIPHERAL)
+    // If a peripheral, start the clock to send a connection parameter update
+    if(role == GAP_PROFILE_PERIPHERAL)
+    {
+      // Allocate data to send through clock handler
+      connList[i].pParamUpdateEventData = ICall_malloc(sizeof(mrClockEventData_t) +
+                                                       sizeof(uint32_t));
+      if(connList[i].pParamUpdateEventData)
       {
-        // Allocate data to send through clock handler
-        connList[i].pParamUpdateEventData = ICall_malloc(sizeof(mrClockEventData_t) +
-                                                         sizeof(uint16_t));
-        if(connList[i].pParamUpdateEventData)
+        // Set clock data
+        connList[i].pParamUpdateEventData->event = MR_EVT_SEND_PARAM_UPDATE;
+        // Refer to this connection rather than to its handle, which the
+        // stack may have reused by the time the clock expires
+        uint32_t ref = conn_registry_ref(connHandle);
+        memcpy(connList[i].pParamUpdateEventData->data, &ref, sizeof(ref));
+
+        // Create a clock object and start
+        connList[i].pUpdateClock
+          = (Clock_Struct*) ICall_malloc(sizeof(Clock_Struct));
+
+        if (connList[i].pUpdateClock)
         {
-          // Set clock data
-          connList[i].pParamUpdateEventData->event = MR_EVT_SEND_PARAM_UPDATE;
-          *((uint16_t *)connList[i].pParamUpdateEventData->data) = connHandle;
-
-          // Create a clock object and start
-          connList[i].pUpdateClock
-            = (Clock_Struct*) ICall_malloc(sizeof(Clock_Struct));
-
-          if (connList[i].pUpdateClock)
-          {
 #ifdef FREERTOS
-              Util_constructClock(connList[i].pUpdateClock,
-                                              (void*)multi_role_clockHandler,
-                                              SEND_PARAM_UPDATE_DELAY, 0, true,
-                                              (void*) connList[i].pParamUpdateEventData);
+            Util_constructClock(connList[i].pUpdateClock,
+                                            (void*)multi_role_clockHandler,
+                                            SEND_PARAM_UPDATE_DELAY, 0, true,
+                                            (void*) connList[i].pParamUpdateEventData);
 
 #else
-              Util_constructClock(connList[i].pUpdateClock,
-                                  multi_role_clockHandler,
-                                SEND_PARAM_UPDATE_DELAY, 0, true,
-                                (UArg) connList[i].pParamUpdateEventData);
+            Util_constructClock(connList[i].pUpdateClock,
+                                multi_role_clockHandler,
+                              SEND_PARAM_UPDATE_DELAY, 0, true,
+                              (UArg) connList[i].pParamUpdateEventData);
 #endif
-          }
-          else
-          {
-            // Clean up
-            ICall_free(connList[i].pParamUpdateEventData);
-          }
         }
         else
         {
-          // Memory allocation failed
-          MULTIROLE_ASSERT(false);
+          // Clean up
+          ICall_free(connList[i].pParamUpdateEventData);
         }
       }
-#endif
-
-      break;
+      else
+      {
+        // Memory allocation failed
+        MULTIROLE_ASSERT(false);
+      }
     }
+#endif
   }
 
   return i;
@@ -2692,8 +2818,8 @@ bool multi_role_doDiscoverDevices(uint8_t index)
   // The stack does not need to record advertising reports
   // since the application will filter them by Service UUID and save.
 
-  // Reset number of scan results to 0 before starting scan
-  numScanRes = 0;
+  // Forget the results and rejections of the previous scan
+  scan_table_reset();
   GapScan_enable(0, DEFAULT_SCAN_DURATION, 0);
 #else // !DEFAULT_DEV_DISC_BY_SVC_UUID
   // Scanning for DEFAULT_SCAN_DURATION x 10 ms.
@@ -2758,8 +2884,8 @@ bool multi_role_doConnect(uint8_t index)
   GapAdv_disable(advHandle);
 
 #if (DEFAULT_DEV_DISC_BY_SVC_UUID == TRUE)
-  GapInit_connect(scanList[index].addrType & MASK_ADDRTYPE_ID,
-                  scanList[index].addr, mrInitPhy, 0);
+  GapInit_connect(scan_table_get(index)->addrType & MASK_ADDRTYPE_ID,
+                  (uint8_t *)scan_table_get(index)->addr, mrInitPhy, 0);
 #else // !DEFAULT_DEV_DISC_BY_SVC_UUID
   GapScan_Evt_AdvRpt_t advRpt;
 
@@ -47,6 +47,7 @@ extern "C"
 /*********************************************************************
  * INCLUDES
  */
+#include "msg_pool.h"
 
 /*********************************************************************
 *  EXTERNAL VARIABLES
@@ -123,6 +124,9 @@ bool multi_role_doSetInitPhy(uint8_t index);
 /* Action for Menu: Set Connection PHY */
 bool multi_role_doConnPhy(uint8_t index);
 
+/* Usage of the app message pool */
+void multi_role_getMsgPoolStats(MsgPool_Stats *stats);
+
 
 /*********************************************************************
 *********************************************************************/
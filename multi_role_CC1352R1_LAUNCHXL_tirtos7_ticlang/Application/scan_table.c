@@ -0,0 +1,305 @@
+/*
+ *  ======== scan_table.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/ClockP.h>
+
+#include "scan_table.h"
+
+#if (SCAN_TABLE_BLOOM_BITS & (SCAN_TABLE_BLOOM_BITS - 1)) != 0 || SCAN_TABLE_BLOOM_BITS < 32 || \
+    SCAN_TABLE_BLOOM_BITS > 65536
+    #error "SCAN_TABLE_BLOOM_BITS must be a power of two from 32 to 65536"
+#endif
+
+#if (SCAN_TABLE_ACCEPT_BITS & (SCAN_TABLE_ACCEPT_BITS - 1)) != 0 || SCAN_TABLE_ACCEPT_BITS < 32 || \
+    SCAN_TABLE_ACCEPT_BITS > 65536
+    #error "SCAN_TABLE_ACCEPT_BITS must be a power of two from 32 to 65536"
+#endif
+
+/* Bloom bits set per address */
+#define SCAN_TABLE_BLOOM_HASHES 3
+
+/* Hash buckets; a power of two of at least twice the entries */
+#ifndef SCAN_TABLE_BUCKETS
+    #define SCAN_TABLE_BUCKETS 32
+#endif
+
+#if SCAN_TABLE_BUCKETS < 2 * SCAN_TABLE_SIZE || SCAN_TABLE_BUCKETS > 256 || \
+    (SCAN_TABLE_BUCKETS & (SCAN_TABLE_BUCKETS - 1)) != 0
+    #error "SCAN_TABLE_BUCKETS must be a power of two, at least twice SCAN_TABLE_SIZE and at most 256"
+#endif
+
+#define SCAN_TABLE_NONE 0xFF
+
+static struct
+{
+    ScanTable_Entry entries[SCAN_TABLE_SIZE];
+    uint8_t buckets[SCAN_TABLE_BUCKETS];    /* Entry index + 1, or 0 */
+    uint8_t prev[SCAN_TABLE_SIZE];          /* Towards the most recent */
+    uint8_t next[SCAN_TABLE_SIZE];          /* Towards the least recent */
+    uint8_t head;                           /* Most recently heard */
+    uint8_t tail;                           /* Least recently heard */
+    uint8_t count;
+    uint32_t bloom[SCAN_TABLE_BLOOM_BITS / 32];      /* Rejected addresses */
+    uint32_t accepted[SCAN_TABLE_ACCEPT_BITS / 32];
+    ScanTable_Stats stats;
+} table = {
+    .head = SCAN_TABLE_NONE,
+    .tail = SCAN_TABLE_NONE,
+};
+
+/*
+ *  ======== scan_table_hash ========
+ *  FNV-1a over the address.
+ */
+static uint32_t scan_table_hash(const uint8_t *addr)
+{
+    uint32_t h = 2166136261u;
+    uint8_t i;
+
+    for (i = 0; i < SCAN_TABLE_ADDR_LEN; i++)
+    {
+        h = (h ^ addr[i]) * 16777619u;
+    }
+
+    return h;
+}
+
+/*
+ *  ======== scan_table_bucket ========
+ *  Bucket holding addr, or the empty bucket where it would go.
+ */
+static uint8_t scan_table_bucket(const uint8_t *addr)
+{
+    uint8_t b = scan_table_hash(addr) & (SCAN_TABLE_BUCKETS - 1);
+
+    while (table.buckets[b] != 0 &&
+           memcmp(table.entries[table.buckets[b] - 1].addr, addr, SCAN_TABLE_ADDR_LEN) != 0)
+    {
+        b = (b + 1) & (SCAN_TABLE_BUCKETS - 1);
+    }
+
+    return b;
+}
+
+/*
+ *  ======== scan_table_unhash ========
+ *  Empty bucket b, moving back any later entry of the same probe run that
+ *  could no longer be found across the gap.
+ */
+static void scan_table_unhash(uint8_t b)
+{
+    uint8_t j = b;
+    uint8_t home;
+
+    for (;;)
+    {
+        j = (j + 1) & (SCAN_TABLE_BUCKETS - 1);
+        if (table.buckets[j] == 0)
+        {
+            break;
+        }
+
+        home = scan_table_hash(table.entries[table.buckets[j] - 1].addr) & (SCAN_TABLE_BUCKETS - 1);
+
+        /* Leave it if its home lies cyclically in (b, j] */
+        if ((b <= j) ? (b < home && home <= j) : (b < home || home <= j))
+        {
+            continue;
+        }
+
+        table.buckets[b] = table.buckets[j];
+        b                = j;
+    }
+
+    table.buckets[b] = 0;
+}
+
+static void scan_table_unlink(uint8_t i)
+{
+    if (table.prev[i] != SCAN_TABLE_NONE)
+    {
+        table.next[table.prev[i]] = table.next[i];
+    }
+    else
+    {
+        table.head = table.next[i];
+    }
+
+    if (table.next[i] != SCAN_TABLE_NONE)
+    {
+        table.prev[table.next[i]] = table.prev[i];
+    }
+    else
+    {
+        table.tail = table.prev[i];
+    }
+}
+
+static void scan_table_pushHead(uint8_t i)
+{
+    table.prev[i] = SCAN_TABLE_NONE;
+    table.next[i] = table.head;
+    if (table.head != SCAN_TABLE_NONE)
+    {
+        table.prev[table.head] = i;
+    }
+    table.head = i;
+    if (table.tail == SCAN_TABLE_NONE)
+    {
+        table.tail = i;
+    }
+}
+
+void scan_table_reset(void)
+{
+    memset(&table, 0, sizeof(table));
+    table.head = SCAN_TABLE_NONE;
+    table.tail = SCAN_TABLE_NONE;
+}
+
+const ScanTable_Entry *scan_table_update(const uint8_t *addr, uint8_t addrType, int8_t rssi, bool *isNew)
+{
+    ScanTable_Entry *e;
+    uint8_t b = scan_table_bucket(addr);
+    uint8_t i;
+
+    table.stats.reports++;
+    *isNew = (table.buckets[b] == 0);
+
+    if (!*isNew)
+    {
+        i = table.buckets[b] - 1;
+        scan_table_unlink(i);
+    }
+    else
+    {
+        if (table.count < SCAN_TABLE_SIZE)
+        {
+            i = table.count++;
+        }
+        else
+        {
+            /* Replace the device heard from least recently */
+            i = table.tail;
+            scan_table_unlink(i);
+            scan_table_unhash(scan_table_bucket(table.entries[i].addr));
+            table.stats.evicted++;
+
+            /* Unhashing may have moved the bucket addr belongs in */
+            b = scan_table_bucket(addr);
+        }
+
+        e = &table.entries[i];
+        memcpy(e->addr, addr, SCAN_TABLE_ADDR_LEN);
+        e->rssiMax       = rssi;
+        e->reports       = 0;
+        table.buckets[b] = i + 1;
+        table.stats.added++;
+    }
+
+    e           = &table.entries[i];
+    e->addrType = addrType;
+    e->rssi     = rssi;
+    e->lastSeen = ClockP_getSystemTicks();
+    if (rssi > e->rssiMax)
+    {
+        e->rssiMax = rssi;
+    }
+    if (e->reports < UINT16_MAX)
+    {
+        e->reports++;
+    }
+    scan_table_pushHead(i);
+
+    return e;
+}
+
+const ScanTable_Entry *scan_table_find(const uint8_t *addr)
+{
+    uint8_t b = scan_table_bucket(addr);
+
+    return (table.buckets[b] != 0) ? &table.entries[table.buckets[b] - 1] : NULL;
+}
+
+uint8_t scan_table_count(void)
+{
+    return table.count;
+}
+
+const ScanTable_Entry *scan_table_get(uint8_t index)
+{
+    return (index < table.count) ? &table.entries[index] : NULL;
+}
+
+/*
+ * SCAN_TABLE_BLOOM_HASHES bits per address, at h1 + k * h2 from the two
+ * halves of its hash. The words are only ever ORed into, so a reader in
+ * another context sees either the old or the new value of each word and
+ * at worst misses an address that is still being recorded.
+ */
+static void scan_table_bloomAdd(uint32_t *bloom, uint16_t bits, const uint8_t *addr)
+{
+    uint32_t h    = scan_table_hash(addr);
+    uint16_t bit  = (uint16_t)h;
+    uint16_t step = (uint16_t)(h >> 16) | 1;
+    uint8_t k;
+
+    for (k = 0; k < SCAN_TABLE_BLOOM_HASHES; k++, bit += step)
+    {
+        bloom[(bit & (bits - 1)) / 32] |= 1u << (bit % 32);
+    }
+}
+
+static bool scan_table_bloomHas(const uint32_t *bloom, uint16_t bits, const uint8_t *addr)
+{
+    uint32_t h    = scan_table_hash(addr);
+    uint16_t bit  = (uint16_t)h;
+    uint16_t step = (uint16_t)(h >> 16) | 1;
+    uint8_t k;
+
+    for (k = 0; k < SCAN_TABLE_BLOOM_HASHES; k++, bit += step)
+    {
+        if ((bloom[(bit & (bits - 1)) / 32] & (1u << (bit % 32))) == 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void scan_table_reject(const uint8_t *addr)
+{
+    scan_table_bloomAdd(table.bloom, SCAN_TABLE_BLOOM_BITS, addr);
+    table.stats.rejected++;
+}
+
+bool scan_table_isRejected(const uint8_t *addr)
+{
+    return scan_table_bloomHas(table.bloom, SCAN_TABLE_BLOOM_BITS, addr);
+}
+
+void scan_table_accept(const uint8_t *addr)
+{
+    scan_table_bloomAdd(table.accepted, SCAN_TABLE_ACCEPT_BITS, addr);
+}
+
+bool scan_table_isAccepted(const uint8_t *addr)
+{
+    return scan_table_bloomHas(table.accepted, SCAN_TABLE_ACCEPT_BITS, addr);
+}
+
+void scan_table_countDropped(void)
+{
+    table.stats.dropped++;
+}
+
+void scan_table_getStats(ScanTable_Stats *stats)
+{
+    *stats = table.stats;
+}
@@ -0,0 +1,107 @@
+/*
+ *  ======== scan_table.h ========
+ *  Devices found while scanning, keyed by their 6-byte address.
+ *
+ *  Entries live in a fixed array and are located through an open-addressed
+ *  hash of the address, so a report from a device already in the table
+ *  costs one hash and usually one compare. Each entry keeps the last and
+ *  strongest RSSI, a report count and the system tick of the last report.
+ *  When the table is full, the device heard from least recently is
+ *  replaced. Entries are always indices 0 .. count-1, and an index stays
+ *  the same until its device is replaced or the table is reset.
+ *
+ *  The scan callback records addresses whose reports did not pass the
+ *  application's filter in a bloom filter with scan_table_reject(), and
+ *  drops later reports from them after a cheap scan_table_isRejected().
+ *  Its false positives also drop, for the rest of the scan, a few devices
+ *  that were never looked at; the filter is emptied by scan_table_reset(),
+ *  so keep it large relative to the number of advertisers expected in one
+ *  scan. A second, smaller bloom filter records the addresses that did
+ *  pass (scan_table_accept()), so that a device is not rejected for a
+ *  scan response that lacks what its advertisement matched on.
+ *
+ *  The bloom filters are written only from the scan callback, and
+ *  scan_table_reset() must be called while scanning is off. The reject,
+ *  accept and countDropped functions are for the scan callback;
+ *  everything else is for the application task.
+ */
+#ifndef SCAN_TABLE_H_
+#define SCAN_TABLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCAN_TABLE_ADDR_LEN 6
+
+/* Devices tracked; no more than the connect menu can list */
+#ifndef SCAN_TABLE_SIZE
+    #define SCAN_TABLE_SIZE 15
+#endif
+
+/*
+ * Bits in the bloom filter of rejected addresses; a power of two. 4096
+ * bits keep false positives under 1% for 300 rejected advertisers.
+ */
+#ifndef SCAN_TABLE_BLOOM_BITS
+    #define SCAN_TABLE_BLOOM_BITS 4096
+#endif
+
+/* Bits in the bloom filter of accepted addresses; a power of two */
+#ifndef SCAN_TABLE_ACCEPT_BITS
+    #define SCAN_TABLE_ACCEPT_BITS 1024
+#endif
+
+typedef struct
+{
+    uint8_t addr[SCAN_TABLE_ADDR_LEN];
+    uint8_t addrType;
+    int8_t rssi;            /* Of the last report */
+    int8_t rssiMax;
+    uint16_t reports;
+    uint32_t lastSeen;      /* ClockP system tick of the last report */
+} ScanTable_Entry;
+
+typedef struct
+{
+    uint32_t reports;       /* Reports given to scan_table_update() */
+    uint32_t added;
+    uint32_t evicted;
+    uint32_t rejected;      /* Addresses put in the bloom filter */
+    uint32_t dropped;       /* Reports counted by scan_table_countDropped() */
+} ScanTable_Stats;
+
+/* Empty the table and the bloom filters and zero the statistics */
+void scan_table_reset(void);
+
+/*
+ * Record a report from addr. Returns its entry, and sets *isNew when the
+ * device was not in the table before.
+ */
+const ScanTable_Entry *scan_table_update(const uint8_t *addr, uint8_t addrType, int8_t rssi, bool *isNew);
+
+/* Entry of addr, or NULL */
+const ScanTable_Entry *scan_table_find(const uint8_t *addr);
+
+uint8_t scan_table_count(void);
+
+/* Entry at index, 0 .. scan_table_count() - 1 */
+const ScanTable_Entry *scan_table_get(uint8_t index);
+
+/* Remember that reports from addr are of no interest */
+void scan_table_reject(const uint8_t *addr);
+
+/* True if addr was, probably, passed to scan_table_reject() */
+bool scan_table_isRejected(const uint8_t *addr);
+
+/* Remember that a report from addr passed the filter */
+void scan_table_accept(const uint8_t *addr);
+
+/* True if addr was, probably, passed to scan_table_accept() */
+bool scan_table_isAccepted(const uint8_t *addr);
+
+/* Count a report the scan callback dropped */
+void scan_table_countDropped(void);
+
+void scan_table_getStats(ScanTable_Stats *stats);
+
+#endif /* SCAN_TABLE_H_ */
@@ -88,6 +88,7 @@ typedef uintptr_t       UArg;
 
 #include "oad.h"
 #include "flash_interface.h"
+#include "conn_registry.h"
 
 #ifdef MCUBOOT_ENABLE
 #include "bootutil/bootutil.h"
@@ -1425,37 +1426,32 @@ static status_t OadPersistApp_enqueueMsg(uint8_t event, void *pData)
  */
 static uint8_t OadPersistApp_addConn(uint16_t connHandle)
 {
-  uint8_t i;
   uint8_t status = bleNoResources;
   spClockEventData_t *paramUpdateEventData;
 
-  // Try to find an available entry
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
-  {
-    if (connList[i].connHandle == LINKDB_CONNHANDLE_INVALID)
-    {
-      // Found available entry to put a new connection info in
-      connList[i].connHandle = connHandle;
+  // Take the lowest free entry
+  uint8_t i = conn_registry_add(connHandle);
 
-      // Allocate data to send through clock handler
-      paramUpdateEventData = ICall_malloc(sizeof(spClockEventData_t) +
-                                          sizeof (uint16_t));
-      if(paramUpdateEventData)
-      {
-        paramUpdateEventData->event = SP_SEND_PARAM_UPDATE_EVT;
-        *((uint16_t *)paramUpdateEventData->data) = connHandle;
-
-      }
-      else
-      {
-        status = bleMemAllocError;
-      }
+  if (i < MAX_NUM_BLE_CONNS)
+  {
+    connList[i].connHandle = connHandle;
 
-      // Set default PHY to 1M
-      connList[i].currPhy = HCI_PHY_1_MBPS;
+    // Allocate data to send through clock handler
+    paramUpdateEventData = ICall_malloc(sizeof(spClockEventData_t) +
+                                        sizeof (uint16_t));
+    if(paramUpdateEventData)
+    {
+      paramUpdateEventData->event = SP_SEND_PARAM_UPDATE_EVT;
+      *((uint16_t *)paramUpdateEventData->data) = connHandle;
 
-      break;
     }
+    else
+    {
+      status = bleMemAllocError;
+    }
+
+    // Set default PHY to 1M
+    connList[i].currPhy = HCI_PHY_1_MBPS;
   }
 
   return status;
@@ -1471,17 +1467,7 @@ static uint8_t OadPersistApp_addConn(uint16_t connHandle)
  */
 static uint8_t OadPersistApp_getConnIndex(uint16_t connHandle)
 {
-  uint8_t i;
-
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
-  {
-    if (connList[i].connHandle == connHandle)
-    {
-      return i;
-    }
-  }
-
-  return(MAX_NUM_BLE_CONNS);
+  return conn_registry_find(connHandle);
 }
 
 /*********************************************************************
@@ -1500,13 +1486,17 @@ static uint8_t OadPersistApp_clearConnListEntry(uint16_t connHandle)
 
   if(connHandle != LINKDB_CONNHANDLE_ALL)
   {
-    // Get connection index from handle
-    connIndex = OadPersistApp_getConnIndex(connHandle);
+    // Release the connection index of the handle
+    connIndex = conn_registry_remove(connHandle);
     if(connIndex >= MAX_NUM_BLE_CONNS)
     {
       return(bleInvalidRange);
     }
   }
+  else
+  {
+    conn_registry_reset();
+  }
 
   // Clear specific handle or all handles
   for(i = 0; i < MAX_NUM_BLE_CONNS; i++)
@@ -0,0 +1,125 @@
+/*
+ *  ======== app_tasks.c ========
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* RTOS header files */
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/runtime/Error.h>
+
+#include "app_tasks.h"
+
+static struct
+{
+    const AppTask_Config *table;
+    int count;
+    Task_Struct tasks[APP_TASKS_MAX];
+} appTasks;
+
+/*
+ *  ======== app_tasks_run ========
+ *  Task function; runs the table entry given in arg0.
+ */
+static void app_tasks_run(uintptr_t arg0, uintptr_t arg1)
+{
+    const AppTask_Config *cfg = &appTasks.table[arg0];
+
+    cfg->entry(cfg->arg);
+}
+
+/*
+ *  ======== app_tasks_paint ========
+ */
+static void app_tasks_paint(const AppTask_Config *cfg)
+{
+    uint32_t *word = (uint32_t *)cfg->stack;
+    size_t n       = cfg->stackSize / sizeof(uint32_t);
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        word[i] = APP_TASKS_PAINT;
+    }
+}
+
+int app_tasks_start(const AppTask_Config *table, int count)
+{
+    Task_Params params;
+    Error_Block eb;
+    int i;
+
+    if (count > APP_TASKS_MAX)
+    {
+        return -1;
+    }
+
+    appTasks.table = table;
+
+    for (i = 0; i < count; i++)
+    {
+        app_tasks_paint(&table[i]);
+
+        Task_Params_init(&params);
+        params.arg0      = (uintptr_t)i;
+        params.priority  = table[i].priority;
+        params.stack     = table[i].stack;
+        params.stackSize = table[i].stackSize;
+
+        /* Counted first so the task can be reported as soon as it runs */
+        appTasks.count = i + 1;
+
+        Error_init(&eb);
+        Task_construct(&appTasks.tasks[i], app_tasks_run, &params, &eb);
+        if (Error_check(&eb))
+        {
+            appTasks.count = i;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int app_tasks_count(void)
+{
+    return appTasks.count;
+}
+
+void app_tasks_getStats(int id, AppTask_Stats *stats)
+{
+    const AppTask_Config *cfg = &appTasks.table[id];
+    const uint32_t *word      = (const uint32_t *)cfg->stack;
+    size_t n                  = cfg->stackSize / sizeof(uint32_t);
+    size_t untouched          = 0;
+
+    /* The stack grows down, so the paint survives at the low end */
+    while (untouched < n && word[untouched] == APP_TASKS_PAINT)
+    {
+        untouched++;
+    }
+
+    stats->name      = cfg->name;
+    stats->stackSize = cfg->stackSize;
+    stats->stackUsed = cfg->stackSize - untouched * sizeof(uint32_t);
+}
+
+void app_tasks_report(void (*print)(const char *line))
+{
+    AppTask_Stats stats;
+    char line[64];
+    int i;
+
+    for (i = 0; i < appTasks.count; i++)
+    {
+        app_tasks_getStats(i, &stats);
+        snprintf(line,
+                 sizeof(line),
+                 "%s: stack %u/%u bytes\r\n",
+                 stats.name,
+                 (unsigned)stats.stackUsed,
+                 (unsigned)stats.stackSize);
+        print(line);
+    }
+}
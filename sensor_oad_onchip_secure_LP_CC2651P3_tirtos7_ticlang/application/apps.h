@@ -11,51 +11,27 @@
 
 #include <stdint.h>
 
-/* POSIX Header files */
-#include <pthread.h>
-
 /* RTOS header files */
 #include <ti/sysbios/BIOS.h>
 
 #include <ti/drivers/Board.h>
 
+#include "app_tasks.h"
+
 extern void *mainThread(void *arg0);
 
-/* Stack size in bytes */
-#define THREADSTACKSIZE 1024
+APP_TASK_STACK(mainThreadStack, 1024);
+
+static const AppTask_Config appTaskTable[] = {
+    APP_TASK("main", mainThread, 1, mainThreadStack),
+};
 
 /*
- *  ======== main ========
+ *  ======== apps ========
  */
 int apps(void)
 {
-    pthread_t thread;
-    pthread_attr_t attrs;
-    struct sched_param priParam;
-    int retc;
-
-    /* Initialize the attributes structure with default values */
-    pthread_attr_init(&attrs);
-
-    /* Set priority, detach state, and stack size attributes */
-    priParam.sched_priority = 1;
-    retc                    = pthread_attr_setschedparam(&attrs, &priParam);
-    retc |= pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
-    retc |= pthread_attr_setstacksize(&attrs, THREADSTACKSIZE);
-    if (retc != 0)
-    {
-        /* failed to set attributes */
-        while (1) {}
-    }
-
-    retc = pthread_create(&thread, &attrs, mainThread, NULL);
-    if (retc != 0)
-    {
-        /* pthread_create() failed */
-        while (1) {}
-    }
-
-    return (0);
+    return app_tasks_start(appTaskTable, sizeof(appTaskTable) / sizeof(appTaskTable[0]));
 }
 
 #include "test_uart.h"
@@ -9,6 +9,11 @@
 /* Driver configuration */
 #include "ti_drivers_config.h"
 
+#include "app_tasks.h"
+#include "test_uart.h"
+#include "uart_cmd.h"
+#include "uart_log.h"
+
 /*
  * The following function is from good old K & R.
  */
@@ -58,22 +63,18 @@ UART2_Params uartParams_1;
 size_t bytesRead;
 size_t bytesWritten = 0;
 
+/*
+ * Console output on uart_1 is queued on the log ring and drained by the
+ * UART2 write callback, so these return without waiting for the wire.
+ */
 void test_uart_puts(char *str)
 {
-    bytesWritten = 0;
-    while (bytesWritten == 0)
-    {
-        UART2_write(uart_1, str, strlen(str), &bytesWritten);
-    }
+    uart_log_write(str, strlen(str));
 }
 
 void test_uart_print(char *str, size_t len)
 {
-    bytesWritten = 0;
-    while (bytesWritten == 0)
-    {
-        UART2_write(uart_1, str, len, &bytesWritten);
-    }
+    uart_log_write(str, len);
 }
 
 //void test_uart_printf(const char *format, ...)
@@ -87,11 +88,65 @@ void test_uart_print(char *str, size_t len)
 //    test_uart_print(buf, strlen(buf));
 //}
 
+#include "sensor.h"
+#include "smsgs.h"
+
+/*
+ *  ======== test_uart_cmdEcho ========
+ *  Every key is reported and echoed; keys with no entry stop here.
+ */
+static void test_uart_cmdEcho(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    input = (char)cmd;
+
+    sprintf(tempStr, "\r\ninput:%d\r\n", (int)input);
+    test_uart_puts(tempStr);
+
+    test_uart_print(&input, 1);
+    GPIO_toggle(CONFIG_GPIO_GLED);
+}
+
+/*
+ *  ======== test_uart_cmdIdentify ========
+ *  '1': ask the collector to blink its identify LED.
+ */
+static void test_uart_cmdIdentify(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_cmdEcho(cmd, payload, len);
+
+    Sensor_sendIdentifyLedRequest();
+}
+
+static void test_uart_putLine(const char *line)
+{
+    test_uart_puts((char *)line);
+}
+
+/*
+ *  ======== test_uart_cmdStacks ========
+ *  'k': stack high-water mark of every application task.
+ */
+static void test_uart_cmdStacks(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_puts("\r\n");
+    app_tasks_report(test_uart_putLine);
+}
+
+static const UartCmd_Entry uartCmdTable[] = {
+    {'1', test_uart_cmdIdentify},
+    {'k', test_uart_cmdStacks},
+};
+
 void test_uart_init(void)
 {
 
     UART2_Params_init(&uartParams_1);
-    uartParams_1.baudRate = 115200;
+    uartParams_1.baudRate       = 115200;
+    uartParams_1.writeMode      = UART2_Mode_CALLBACK;
+    uartParams_1.writeCallback  = uart_log_writeCallback;
+    uartParams_1.readMode       = UART2_Mode_CALLBACK;
+    uartParams_1.readReturnMode = UART2_ReadReturnMode_PARTIAL;
+    uartParams_1.readCallback   = uart_cmd_readCallback;
 
     uart_1 = UART2_open(CONFIG_DISPLAY_UART, &uartParams_1);
 
@@ -101,36 +156,15 @@ void test_uart_init(void)
         while (1) {}
     }
 
-    UART2_write(uart_1, tempStr, strlen(tempStr), &bytesWritten);
+    uart_log_init(uart_1);
+    uart_cmd_init(uart_1, uartCmdTable, sizeof(uartCmdTable) / sizeof(uartCmdTable[0]), test_uart_cmdEcho);
 
-}
+    test_uart_puts(tempStr);
 
-#include "sensor.h"
-#include "smsgs.h"
+}
 
 void test_uart_loop(void)
 {
-    int status           = UART2_STATUS_SUCCESS;
-
-    bytesRead = 0;
-    status = UART2_readTimeout(uart_1, &input, 1, &bytesRead, 1000); // 1ms
-    if (status == UART2_STATUS_SUCCESS)
-    {
-        bytesWritten = 0;
-        sprintf(tempStr, "\r\ninput:%d\r\n", (int)input);
-        UART2_write(uart_1, tempStr, strlen(tempStr), &bytesWritten);
-
-        bytesWritten = 0;
-        while (bytesWritten == 0)
-        {
-            status = UART2_write(uart_1, &input, 1, &bytesWritten);
-            GPIO_toggle(CONFIG_GPIO_GLED);
-        }
-        
-        if (input == '1')
-        {
-            Sensor_sendIdentifyLedRequest();
-        }
-    }
-
+    /* Sleeps until input arrives */
+    uart_cmd_process(UART_CMD_WAIT_FOREVER);
 }
@@ -0,0 +1,103 @@
+/*
+ *  ======== uart_cmd.h ========
+ *  Table-driven UART command engine.
+ *
+ *  Received bytes are read straight into a ring buffer by UART2 in read
+ *  callback mode (partial return), so input is limited by the baud rate
+ *  rather than by a poll period, and the reading task sleeps until data
+ *  arrives.
+ *
+ *  Two kinds of input are recognised:
+ *   - framed commands:  0xA5 | len | cmd | payload[len] | crc8
+ *     crc8 is CRC-8 (poly 0x07, init 0x00) over len, cmd and payload.
+ *   - any other byte is a single-key command with that character as
+ *     cmd and an empty payload, which keeps terminal use working.
+ *
+ *  Both are looked up by cmd in the table passed to uart_cmd_init().
+ *
+ *  A frame whose bytes stop for longer than UART_CMD_FRAME_TIMEOUT_MS is
+ *  dropped and the parser goes back to looking for a start byte, so a
+ *  truncated frame cannot swallow the input that follows it.
+ */
+#ifndef UART_CMD_H_
+#define UART_CMD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ti/drivers/UART2.h>
+
+/* Receive ring size in bytes, must be a power of two */
+#ifndef UART_CMD_RX_SIZE
+    #define UART_CMD_RX_SIZE 256
+#endif
+
+/* Largest payload accepted in a framed command */
+#ifndef UART_CMD_MAX_PAYLOAD
+    #define UART_CMD_MAX_PAYLOAD 64
+#endif
+
+/* Longest gap between two bytes of a framed command */
+#ifndef UART_CMD_FRAME_TIMEOUT_MS
+    #define UART_CMD_FRAME_TIMEOUT_MS 50
+#endif
+
+#define UART_CMD_SOF 0xA5
+
+/* Wait forever in uart_cmd_process() */
+#define UART_CMD_WAIT_FOREVER (~(uint32_t)0)
+
+typedef void (*UartCmd_Handler)(uint8_t cmd, const uint8_t *payload, size_t len);
+
+typedef struct
+{
+    uint8_t cmd;
+    UartCmd_Handler fxn;
+} UartCmd_Entry;
+
+typedef struct
+{
+    uint32_t bytesRead;
+    uint32_t frames;      /* Framed commands dispatched */
+    uint32_t keys;        /* Single-key commands dispatched */
+    uint32_t crcErrors;   /* Frames dropped on a bad CRC or length */
+    uint32_t unknown;     /* Commands with no handler */
+    uint32_t overruns;    /* UART2 reported an RX overrun */
+    uint32_t stalls;      /* Times the ring was full and reading paused */
+    uint32_t timeouts;    /* Partial frames dropped after a gap */
+} UartCmd_Stats;
+
+/*
+ * Attach the engine to a UART2 handle opened with
+ * readMode = UART2_Mode_CALLBACK, readReturnMode = UART2_ReadReturnMode_PARTIAL
+ * and readCallback = uart_cmd_readCallback, and start reading.
+ * defaultFxn, if not NULL, gets commands missing from the table.
+ */
+void uart_cmd_init(UART2_Handle handle, const UartCmd_Entry *table, size_t count, UartCmd_Handler defaultFxn);
+
+void uart_cmd_readCallback(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status);
+
+/*
+ * Have notify called from the read callback whenever input arrives, for
+ * callers that wait for events rather than in uart_cmd_process().
+ */
+void uart_cmd_setNotify(void (*notify)(void));
+
+/*
+ * Cancel the armed read and stop receiving so another user can borrow the
+ * UART; bytes already received are still processed.
+ */
+void uart_cmd_stop(void);
+
+/* Resume receiving after uart_cmd_stop() */
+void uart_cmd_start(void);
+
+/*
+ * Wait up to timeoutMs for input, then parse and dispatch everything
+ * received. Handlers run in the caller's context.
+ */
+void uart_cmd_process(uint32_t timeoutMs);
+
+void uart_cmd_getStats(UartCmd_Stats *stats);
+
+#endif /* UART_CMD_H_ */
@@ -0,0 +1,62 @@
+/*
+ *  ======== app_tasks.h ========
+ *  Table-driven creation of the application tasks.
+ *
+ *  Each task is described by an AppTask_Config entry: name, entry
+ *  function, priority and a stack declared with APP_TASK_STACK(), so
+ *  neither the stack nor the task object comes from the heap. Stacks are
+ *  filled with APP_TASKS_PAINT before the task is constructed; the
+ *  high-water mark is found later by scanning up from the bottom of the
+ *  stack for the first overwritten word.
+ */
+#ifndef APP_TASKS_H_
+#define APP_TASKS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tasks that app_tasks_start() can construct */
+#ifndef APP_TASKS_MAX
+    #define APP_TASKS_MAX 4
+#endif
+
+#define APP_TASKS_PAINT 0xBEBEBEBEu
+
+/* Static, 8-byte aligned stack of the given size in bytes */
+#define APP_TASK_STACK(sym, bytes) static uint64_t sym[((bytes) + 7) / 8]
+
+/* Table entry for a task running entry(NULL) on the stack sym */
+#define APP_TASK(name, entry, priority, sym) {(name), (entry), NULL, (priority), (sym), sizeof(sym)}
+
+typedef struct
+{
+    const char *name;
+    void *(*entry)(void *arg);
+    void *arg;
+    int priority;
+    void *stack;
+    size_t stackSize;
+} AppTask_Config;
+
+typedef struct
+{
+    const char *name;
+    size_t stackSize;
+    size_t stackUsed;   /* High-water mark in bytes */
+} AppTask_Stats;
+
+/*
+ * Paint the stacks and construct the tasks of table, which must stay
+ * valid. Returns 0, or -1 if the table is too long or a task could not
+ * be constructed; the tasks before it are running.
+ */
+int app_tasks_start(const AppTask_Config *table, int count);
+
+int app_tasks_count(void);
+
+void app_tasks_getStats(int id, AppTask_Stats *stats);
+
+/* Print one line per task with print, which may block */
+void app_tasks_report(void (*print)(const char *line));
+
+#endif /* APP_TASKS_H_ */
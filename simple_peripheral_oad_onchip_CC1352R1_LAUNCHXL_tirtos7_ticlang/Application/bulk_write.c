@@ -0,0 +1,211 @@
+/*
+ *  ======== bulk_write.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/ClockP.h>
+
+#include <icall.h>
+#include <bcomdef.h>
+/* This Header file contains all BLE API and icall structure definition */
+#include <icall_ble_api.h>
+
+#include "bulk_write.h"
+
+/* Opcode and attribute handle in front of each Write Command */
+#define BULK_WRITE_ATT_HDR_SIZE 3
+
+static struct
+{
+    BulkWrite_DoneFxn doneFxn;
+    uint16_t pduSize;
+    uint8_t numBuffers;
+    uint8_t credits;
+    bool active;
+    bool creditReports;     /* bulk_write_setCredits() seen this transfer */
+    uint16_t connHandle;
+    uint16_t attHandle;
+    const uint8_t *data;
+    uint32_t len;
+    uint32_t offset;
+    uint32_t startTick;
+    BulkWrite_Stats stats;
+} bulk;
+
+static void bulk_write_finish(int status)
+{
+    uint64_t us = (uint64_t)(ClockP_getSystemTicks() - bulk.startTick) * ClockP_getSystemTickPeriod();
+
+    bulk.active            = false;
+    bulk.stats.elapsedUs   = (uint32_t)us;
+    bulk.stats.bytesPerSec = (us != 0) ? (uint32_t)((uint64_t)bulk.stats.bytes * 1000000u / us) : 0;
+
+    if (bulk.doneFxn != NULL)
+    {
+        bulk.doneFxn(bulk.connHandle, status, &bulk.stats);
+    }
+}
+
+/*
+ *  ======== bulk_write_pump ========
+ *  Send segments while there are credits, then check for completion.
+ */
+static void bulk_write_pump(void)
+{
+    attWriteReq_t req;
+    uint16_t seg;
+    bStatus_t status;
+
+    while (bulk.offset < bulk.len)
+    {
+        if (bulk.credits == 0)
+        {
+            bulk.stats.stalls++;
+            return;
+        }
+
+        seg = (bulk.len - bulk.offset < bulk.stats.segment) ? (uint16_t)(bulk.len - bulk.offset)
+                                                            : bulk.stats.segment;
+
+        req.pValue = GATT_bm_alloc(bulk.connHandle, ATT_WRITE_CMD, seg, NULL);
+        if (req.pValue == NULL)
+        {
+            bulk.stats.stalls++;
+            return;
+        }
+        memcpy(req.pValue, bulk.data + bulk.offset, seg);
+        req.handle = bulk.attHandle;
+        req.len    = seg;
+        req.sig    = FALSE;
+        req.cmd    = TRUE;
+
+        status = GATT_WriteNoRsp(bulk.connHandle, &req);
+        if (status != SUCCESS)
+        {
+            GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_CMD);
+            if (status == bleNotConnected || status == INVALIDPARAMETER)
+            {
+                bulk_write_finish(BULK_WRITE_STATUS_LINK);
+            }
+            else
+            {
+                /* Out of buffers after all; try again next connection event */
+                bulk.stats.stalls++;
+            }
+            return;
+        }
+
+        bulk.offset += seg;
+        bulk.credits--;
+        bulk.stats.bytes += seg;
+        bulk.stats.writes++;
+    }
+
+    if (bulk.credits >= bulk.numBuffers)
+    {
+        bulk_write_finish(BULK_WRITE_STATUS_SUCCESS);
+    }
+}
+
+void bulk_write_init(uint16_t pduSize, uint8_t numBuffers, BulkWrite_DoneFxn doneFxn)
+{
+    memset(&bulk, 0, sizeof(bulk));
+    bulk.pduSize    = pduSize;
+    bulk.numBuffers = numBuffers;
+    bulk.doneFxn    = doneFxn;
+}
+
+int bulk_write_start(uint16_t connHandle, uint16_t attHandle, const uint8_t *data, uint32_t len)
+{
+    uint16_t mtu;
+    uint16_t seg;
+
+    if (bulk.active)
+    {
+        return BULK_WRITE_STATUS_BUSY;
+    }
+
+    mtu = ATT_GetMTU(connHandle);
+    if (data == NULL || len == 0 || attHandle == 0 || mtu <= BULK_WRITE_ATT_HDR_SIZE ||
+        bulk.pduSize <= L2CAP_HDR_SIZE + BULK_WRITE_ATT_HDR_SIZE)
+    {
+        return BULK_WRITE_STATUS_INVALID;
+    }
+
+    seg = mtu - BULK_WRITE_ATT_HDR_SIZE;
+    if (seg > bulk.pduSize - L2CAP_HDR_SIZE - BULK_WRITE_ATT_HDR_SIZE)
+    {
+        seg = bulk.pduSize - L2CAP_HDR_SIZE - BULK_WRITE_ATT_HDR_SIZE;
+    }
+
+    memset(&bulk.stats, 0, sizeof(bulk.stats));
+    bulk.stats.segment = seg;
+    bulk.connHandle    = connHandle;
+    bulk.attHandle     = attHandle;
+    bulk.data          = data;
+    bulk.len           = len;
+    bulk.offset        = 0;
+    bulk.credits       = bulk.numBuffers;
+    bulk.creditReports = false;
+    bulk.startTick     = ClockP_getSystemTicks();
+    bulk.active        = true;
+
+    bulk_write_pump();
+
+    return BULK_WRITE_STATUS_SUCCESS;
+}
+
+void bulk_write_setCredits(uint8_t freeBuffers)
+{
+    if (bulk.active)
+    {
+        bulk.credits       = freeBuffers;
+        bulk.creditReports = true;
+        bulk_write_pump();
+    }
+}
+
+void bulk_write_connEvent(uint16_t connHandle)
+{
+    if (bulk.active && connHandle == bulk.connHandle)
+    {
+        bulk.stats.connEvents++;
+        if (bulk.offset == bulk.len && !bulk.creditReports)
+        {
+            /* Nothing will say when the controller is empty */
+            bulk_write_finish(BULK_WRITE_STATUS_SUCCESS);
+            return;
+        }
+        if (bulk.credits == 0)
+        {
+            bulk.credits = 1;
+        }
+        bulk_write_pump();
+    }
+}
+
+void bulk_write_abort(uint16_t connHandle)
+{
+    if (bulk.active && connHandle == bulk.connHandle)
+    {
+        bulk_write_finish(BULK_WRITE_STATUS_ABORTED);
+    }
+}
+
+bool bulk_write_isActive(void)
+{
+    return bulk.active;
+}
+
+bool bulk_write_isActiveOn(uint16_t connHandle)
+{
+    return bulk.active && connHandle == bulk.connHandle;
+}
+
+void bulk_write_getStats(BulkWrite_Stats *stats)
+{
+    *stats = bulk.stats;
+}
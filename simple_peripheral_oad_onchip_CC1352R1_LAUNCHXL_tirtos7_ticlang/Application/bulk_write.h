@@ -0,0 +1,81 @@
+/*
+ *  ======== bulk_write.h ========
+ *  Bulk transfer of a buffer to a peer characteristic with ATT Write
+ *  Commands.
+ *
+ *  The buffer is cut into segments that each fill one controller data
+ *  buffer: the ATT MTU less the 3-byte Write Command header, capped so
+ *  that header, segment and L2CAP header fit in pduSize. Write Commands
+ *  need no response, so segments go out back to back instead of one per
+ *  round trip.
+ *
+ *  Flow control is by credits, one per controller data buffer. Each
+ *  segment handed to the stack takes a credit. bulk_write_setCredits()
+ *  refills them from the free buffer count in L2CAP_NUM_CTRL_DATA_PKT_EVT,
+ *  and every call sends as many segments as there are credits. A segment
+ *  the stack refuses (no buffer or no memory) is retried on the next
+ *  connection event. So that a missed L2CAP event cannot stall the
+ *  transfer, each connection event gives at least one credit.
+ *
+ *  The transfer is complete once every segment is with the stack and the
+ *  controller has all its buffers free again, i.e. the peer's link layer
+ *  has acknowledged all the data. Without any L2CAP event in the
+ *  transfer, the first connection event after the last segment counts as
+ *  the end instead. The done function then gets the throughput from start
+ *  to that point.
+ *
+ *  One transfer at a time. The buffer must stay valid until the done
+ *  function is called. Call everything from the application task.
+ */
+#ifndef BULK_WRITE_H_
+#define BULK_WRITE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BULK_WRITE_STATUS_SUCCESS (0)
+#define BULK_WRITE_STATUS_BUSY    (-1)  /* Another transfer is running */
+#define BULK_WRITE_STATUS_INVALID (-2)
+#define BULK_WRITE_STATUS_LINK    (-3)  /* The stack refused the link */
+#define BULK_WRITE_STATUS_ABORTED (-4)
+
+typedef struct
+{
+    uint32_t bytes;         /* Handed to the stack */
+    uint32_t writes;
+    uint32_t stalls;        /* Bursts cut short by credits or the stack */
+    uint32_t connEvents;
+    uint16_t segment;       /* Bytes per Write Command */
+    uint32_t elapsedUs;
+    uint32_t bytesPerSec;
+} BulkWrite_Stats;
+
+typedef void (*BulkWrite_DoneFxn)(uint16_t connHandle, int status, const BulkWrite_Stats *stats);
+
+/*
+ * pduSize is the controller's data buffer size and numBuffers its number
+ * of data buffers.
+ */
+void bulk_write_init(uint16_t pduSize, uint8_t numBuffers, BulkWrite_DoneFxn doneFxn);
+
+/* Start writing len bytes of data to attHandle of connHandle */
+int bulk_write_start(uint16_t connHandle, uint16_t attHandle, const uint8_t *data, uint32_t len);
+
+/* Free controller data buffers, from L2CAP_NUM_CTRL_DATA_PKT_EVT */
+void bulk_write_setCredits(uint8_t freeBuffers);
+
+/* A connection event of connHandle has ended */
+void bulk_write_connEvent(uint16_t connHandle);
+
+/* Stop the transfer on connHandle, if any; e.g. when the link drops */
+void bulk_write_abort(uint16_t connHandle);
+
+bool bulk_write_isActive(void);
+
+/* True while a transfer runs on connHandle */
+bool bulk_write_isActiveOn(uint16_t connHandle);
+
+/* Statistics of the current or last transfer */
+void bulk_write_getStats(BulkWrite_Stats *stats);
+
+#endif /* BULK_WRITE_H_ */
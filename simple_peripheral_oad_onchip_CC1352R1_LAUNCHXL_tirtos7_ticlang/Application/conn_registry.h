@@ -0,0 +1,74 @@
+/*
+ *  ======== conn_registry.h ========
+ *  Map from BLE connection handles to connection table slots.
+ *
+ *  A slot is an index into the application's own connection table
+ *  (connList[]). Lookups go through a direct-mapped table indexed by the
+ *  low bits of the handle. The stack hands out small handles, so a lookup
+ *  is one table read and one compare, whatever the number of links. A
+ *  handle that lands on an entry already taken by another live handle is
+ *  still registered, and is found by scanning the slots.
+ *
+ *  Every slot has a generation counter that is bumped when it is
+ *  released. conn_registry_ref() packs handle, slot and generation into a
+ *  reference for code that keeps a connection past the current event,
+ *  such as clocks and queued messages. conn_registry_resolve() no longer
+ *  accepts that reference once the connection is gone, even if the stack
+ *  has reused the handle for a new link in the meantime.
+ *
+ *  Call from the application task only.
+ */
+#ifndef CONN_REGISTRY_H_
+#define CONN_REGISTRY_H_
+
+#include <stdint.h>
+
+/* Projects without -DMAX_NUM_BLE_CONNS get it from SysConfig */
+#ifndef MAX_NUM_BLE_CONNS
+    #include "ti_ble_config.h"
+#endif
+
+#ifndef CONN_REGISTRY_MAX_CONNS
+    #define CONN_REGISTRY_MAX_CONNS MAX_NUM_BLE_CONNS
+#endif
+
+/* Entries of the direct-mapped table; a power of two */
+#ifndef CONN_REGISTRY_MAP_SIZE
+    #define CONN_REGISTRY_MAP_SIZE 32
+#endif
+
+/* Slot returned for handles that are not registered */
+#define CONN_REGISTRY_NONE CONN_REGISTRY_MAX_CONNS
+
+/* Reference returned for handles that are not registered */
+#define CONN_REGISTRY_REF_NONE 0xFFFFFFFFu
+
+/* Forget every connection */
+void conn_registry_reset(void);
+
+/*
+ * Register connHandle in the lowest free slot and return the slot. A
+ * handle already registered keeps its slot. Returns CONN_REGISTRY_NONE
+ * if all slots are taken.
+ */
+uint8_t conn_registry_add(uint16_t connHandle);
+
+/* Release the slot of connHandle and return it, or CONN_REGISTRY_NONE */
+uint8_t conn_registry_remove(uint16_t connHandle);
+
+/* Slot of connHandle, or CONN_REGISTRY_NONE */
+uint8_t conn_registry_find(uint16_t connHandle);
+
+/* Reference to the current connection on connHandle */
+uint32_t conn_registry_ref(uint16_t connHandle);
+
+/* Slot of a reference, or CONN_REGISTRY_NONE if that connection is gone */
+uint8_t conn_registry_resolve(uint32_t ref);
+
+/* Handle of a reference */
+static inline uint16_t conn_registry_refHandle(uint32_t ref)
+{
+    return (uint16_t)ref;
+}
+
+#endif /* CONN_REGISTRY_H_ */
@@ -0,0 +1,482 @@
+/*
+ *  ======== kv_store.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/NVS.h>
+
+#include "kv_store.h"
+
+#define KV_STORE_MAGIC 0x3153564Bu /* "KVS1" */
+
+#define KV_STORE_SECTOR_HDR 8
+#define KV_STORE_REC_HDR    8
+#define KV_STORE_COMMIT     4
+
+#define KV_STORE_ERASED 0xFFFF
+
+#if (KV_STORE_MAX_VALUE & 3) != 0
+    #error "KV_STORE_MAX_VALUE must be a multiple of 4"
+#endif
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+} KvStore_SectorHdr;
+
+typedef struct
+{
+    uint16_t key;
+    uint16_t len;   /* Value length, or KV_STORE_TOMBSTONE */
+    uint16_t crc;   /* CRC-16 over key, len and value */
+    uint16_t pad;
+} KvStore_RecHdr;
+
+static struct
+{
+    NVS_Handle handle;
+    size_t sectorSize;
+    int active;
+    uint32_t seq;
+    size_t writeOff;
+    size_t liveBytes;   /* Records compaction would keep */
+    bool dirty;         /* Log ends in a torn record; compact before writing */
+    uint16_t index[KV_STORE_MAX_KEYS];
+    KvStore_Stats stats;
+    uint32_t buf[(KV_STORE_REC_HDR + KV_STORE_MAX_VALUE + KV_STORE_COMMIT) / 4];
+} kv;
+
+static size_t kv_store_valueLen(uint16_t len)
+{
+    return (len & KV_STORE_TOMBSTONE) ? 0 : len;
+}
+
+static size_t kv_store_recSize(size_t valueLen)
+{
+    return KV_STORE_REC_HDR + ((valueLen + 3) & ~(size_t)3) + KV_STORE_COMMIT;
+}
+
+static size_t kv_store_base(int sector)
+{
+    return (size_t)sector * kv.sectorSize;
+}
+
+/*
+ *  ======== kv_store_crc ========
+ *  CRC-16/CCITT (poly 0x1021), continued from crc.
+ */
+static uint16_t kv_store_crc(uint16_t crc, const uint8_t *data, size_t len)
+{
+    int bit;
+
+    while (len--)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static uint16_t kv_store_recCrc(const KvStore_RecHdr *hdr, const void *value)
+{
+    uint16_t crc = kv_store_crc(0xFFFF, (const uint8_t *)hdr, 4);
+
+    return kv_store_crc(crc, (const uint8_t *)value, kv_store_valueLen(hdr->len));
+}
+
+/*
+ *  ======== kv_store_program ========
+ *  Post-verified, so programming over bytes a torn record left behind
+ *  is caught instead of silently corrupting the new record.
+ */
+static int kv_store_program(size_t offset, const void *data, size_t len)
+{
+    if (NVS_write(kv.handle, offset, (void *)data, len, NVS_WRITE_POST_VERIFY) != NVS_STATUS_SUCCESS)
+    {
+        return KV_STORE_STATUS_ERROR;
+    }
+    kv.stats.flashBytes += len;
+
+    return KV_STORE_STATUS_SUCCESS;
+}
+
+static int kv_store_erase(int sector)
+{
+    kv.stats.erases[sector]++;
+
+    if (NVS_erase(kv.handle, kv_store_base(sector), kv.sectorSize) != NVS_STATUS_SUCCESS)
+    {
+        return KV_STORE_STATUS_ERROR;
+    }
+
+    return KV_STORE_STATUS_SUCCESS;
+}
+
+/*
+ *  ======== kv_store_readHdr ========
+ *  Header of the record at offset in the active sector.
+ */
+static void kv_store_readHdr(size_t offset, KvStore_RecHdr *hdr)
+{
+    NVS_read(kv.handle, kv_store_base(kv.active) + offset, hdr, sizeof(*hdr));
+}
+
+static bool kv_store_sectorValid(int sector, uint32_t *seq)
+{
+    KvStore_SectorHdr hdr;
+
+    NVS_read(kv.handle, kv_store_base(sector), &hdr, sizeof(hdr));
+    *seq = hdr.seq;
+
+    return hdr.magic == KV_STORE_MAGIC;
+}
+
+static int kv_store_format(int sector, uint32_t seq)
+{
+    KvStore_SectorHdr hdr = {KV_STORE_MAGIC, seq};
+    int status;
+
+    status = kv_store_erase(sector);
+    if (status == KV_STORE_STATUS_SUCCESS)
+    {
+        status = kv_store_program(kv_store_base(sector), &hdr, sizeof(hdr));
+    }
+
+    return status;
+}
+
+/*
+ *  ======== kv_store_scan ========
+ *  Rebuild the index from the log of the active sector.
+ */
+static void kv_store_scan(void)
+{
+    KvStore_RecHdr *hdr = (KvStore_RecHdr *)kv.buf;
+    uint8_t *value      = (uint8_t *)kv.buf + KV_STORE_REC_HDR;
+    size_t base         = kv_store_base(kv.active);
+    size_t offset       = KV_STORE_SECTOR_HDR;
+    size_t valueLen;
+    size_t size;
+    uint32_t commit;
+    uint16_t key;
+
+    memset(kv.index, 0, sizeof(kv.index));
+
+    while (offset + KV_STORE_REC_HDR + KV_STORE_COMMIT <= kv.sectorSize)
+    {
+        NVS_read(kv.handle, base + offset, hdr, KV_STORE_REC_HDR);
+        if (hdr->key == KV_STORE_ERASED && hdr->len == KV_STORE_ERASED)
+        {
+            break;
+        }
+
+        valueLen = kv_store_valueLen(hdr->len);
+        size     = kv_store_recSize(valueLen);
+        if (hdr->key >= KV_STORE_MAX_KEYS || valueLen > KV_STORE_MAX_VALUE || offset + size > kv.sectorSize)
+        {
+            /* Torn header; nothing after it can be trusted */
+            kv.stats.torn++;
+            kv.dirty = true;
+            break;
+        }
+
+        NVS_read(kv.handle, base + offset + KV_STORE_REC_HDR, value, valueLen);
+        NVS_read(kv.handle, base + offset + size - KV_STORE_COMMIT, &commit, sizeof(commit));
+        if (commit != 0 || kv_store_recCrc(hdr, value) != hdr->crc)
+        {
+            kv.stats.torn++;
+        }
+        else
+        {
+            kv.index[hdr->key] = (hdr->len & KV_STORE_TOMBSTONE) ? 0 : (uint16_t)offset;
+        }
+
+        offset += size;
+    }
+
+    kv.writeOff  = offset;
+    kv.liveBytes = 0;
+    for (key = 0; key < KV_STORE_MAX_KEYS; key++)
+    {
+        if (kv.index[key] != 0)
+        {
+            kv_store_readHdr(kv.index[key], hdr);
+            kv.liveBytes += kv_store_recSize(kv_store_valueLen(hdr->len));
+        }
+    }
+}
+
+int kv_store_open(uint_least8_t index)
+{
+    NVS_Attrs attrs;
+    uint32_t seq[2];
+    bool valid[2];
+
+    NVS_init();
+
+    kv.handle = NVS_open(index, NULL);
+    if (kv.handle == NULL)
+    {
+        return KV_STORE_STATUS_ERROR;
+    }
+
+    NVS_getAttrs(kv.handle, &attrs);
+    kv.sectorSize = attrs.sectorSize;
+    if (attrs.regionSize < 2 * attrs.sectorSize || attrs.sectorSize > 0x10000)
+    {
+        NVS_close(kv.handle);
+        kv.handle = NULL;
+        return KV_STORE_STATUS_INVALID;
+    }
+
+    valid[0] = kv_store_sectorValid(0, &seq[0]);
+    valid[1] = kv_store_sectorValid(1, &seq[1]);
+
+    if (!valid[0] && !valid[1])
+    {
+        kv.active = 0;
+        kv.seq    = 1;
+        if (kv_store_format(0, kv.seq) != KV_STORE_STATUS_SUCCESS)
+        {
+            return KV_STORE_STATUS_ERROR;
+        }
+    }
+    else
+    {
+        /* The newer sector wins; the other is what compaction left behind */
+        kv.active = (!valid[0] || (valid[1] && (int32_t)(seq[1] - seq[0]) > 0)) ? 1 : 0;
+        kv.seq    = seq[kv.active];
+    }
+
+    kv_store_scan();
+
+    return KV_STORE_STATUS_SUCCESS;
+}
+
+int kv_store_read(uint16_t key, void *buf, size_t size)
+{
+    KvStore_RecHdr hdr;
+    size_t valueLen;
+
+    if (kv.handle == NULL || key >= KV_STORE_MAX_KEYS)
+    {
+        return KV_STORE_STATUS_INVALID;
+    }
+    if (kv.index[key] == 0)
+    {
+        return KV_STORE_STATUS_NOTFOUND;
+    }
+
+    kv_store_readHdr(kv.index[key], &hdr);
+    valueLen = kv_store_valueLen(hdr.len);
+    NVS_read(kv.handle,
+             kv_store_base(kv.active) + kv.index[key] + KV_STORE_REC_HDR,
+             buf,
+             (valueLen < size) ? valueLen : size);
+
+    return (int)valueLen;
+}
+
+int kv_store_compact(void)
+{
+    uint16_t index[KV_STORE_MAX_KEYS];
+    KvStore_RecHdr *hdr = (KvStore_RecHdr *)kv.buf;
+    int dst             = 1 - kv.active;
+    size_t offset       = KV_STORE_SECTOR_HDR;
+    size_t size;
+    uint16_t key;
+    KvStore_SectorHdr sectorHdr;
+
+    if (kv.handle == NULL)
+    {
+        return KV_STORE_STATUS_INVALID;
+    }
+
+    if (kv_store_erase(dst) != KV_STORE_STATUS_SUCCESS)
+    {
+        return KV_STORE_STATUS_ERROR;
+    }
+
+    memset(index, 0, sizeof(index));
+    for (key = 0; key < KV_STORE_MAX_KEYS; key++)
+    {
+        if (kv.index[key] == 0)
+        {
+            continue;
+        }
+
+        kv_store_readHdr(kv.index[key], hdr);
+        size = kv_store_recSize(kv_store_valueLen(hdr->len));
+        NVS_read(kv.handle, kv_store_base(kv.active) + kv.index[key], kv.buf, size);
+
+        if (kv_store_program(kv_store_base(dst) + offset, kv.buf, size) != KV_STORE_STATUS_SUCCESS)
+        {
+            return KV_STORE_STATUS_ERROR;
+        }
+        index[key] = (uint16_t)offset;
+        offset += size;
+    }
+
+    /* Only now does the copy become the newer sector */
+    sectorHdr.magic = KV_STORE_MAGIC;
+    sectorHdr.seq   = kv.seq + 1;
+    if (kv_store_program(kv_store_base(dst), &sectorHdr, sizeof(sectorHdr)) != KV_STORE_STATUS_SUCCESS)
+    {
+        return KV_STORE_STATUS_ERROR;
+    }
+
+    memcpy(kv.index, index, sizeof(index));
+    kv.active   = dst;
+    kv.seq      = sectorHdr.seq;
+    kv.writeOff = offset;
+    kv.dirty    = false;
+    kv.stats.compactions++;
+
+    return KV_STORE_STATUS_SUCCESS;
+}
+
+/*
+ *  ======== kv_store_append ========
+ */
+static int kv_store_append(uint16_t key, uint16_t len, const void *value)
+{
+    KvStore_RecHdr *hdr = (KvStore_RecHdr *)kv.buf;
+    size_t valueLen     = kv_store_valueLen(len);
+    size_t size         = kv_store_recSize(valueLen);
+    size_t offset;
+    uint32_t commit = 0;
+    KvStore_RecHdr old;
+    int status;
+
+    if (kv.dirty || kv.writeOff + size > kv.sectorSize)
+    {
+        status = kv_store_compact();
+        if (status != KV_STORE_STATUS_SUCCESS)
+        {
+            return status;
+        }
+        if (kv.writeOff + size > kv.sectorSize)
+        {
+            return KV_STORE_STATUS_NOSPACE;
+        }
+    }
+
+    hdr->key = key;
+    hdr->len = len;
+    hdr->pad = KV_STORE_ERASED;
+    memset((uint8_t *)kv.buf + KV_STORE_REC_HDR, 0xFF, size - KV_STORE_REC_HDR - KV_STORE_COMMIT);
+    if (valueLen != 0)
+    {
+        memcpy((uint8_t *)kv.buf + KV_STORE_REC_HDR, value, valueLen);
+    }
+    hdr->crc = kv_store_recCrc(hdr, (uint8_t *)kv.buf + KV_STORE_REC_HDR);
+
+    offset = kv_store_base(kv.active) + kv.writeOff;
+    status = kv_store_program(offset, kv.buf, size - KV_STORE_COMMIT);
+    if (status == KV_STORE_STATUS_SUCCESS)
+    {
+        status = kv_store_program(offset + size - KV_STORE_COMMIT, &commit, sizeof(commit));
+    }
+    if (status != KV_STORE_STATUS_SUCCESS)
+    {
+        /* Whatever made it to flash is a torn record */
+        kv.dirty = true;
+        return status;
+    }
+
+    if (kv.index[key] != 0)
+    {
+        kv_store_readHdr(kv.index[key], &old);
+        kv.liveBytes -= kv_store_recSize(kv_store_valueLen(old.len));
+    }
+    if (len & KV_STORE_TOMBSTONE)
+    {
+        kv.index[key] = 0;
+    }
+    else
+    {
+        kv.index[key] = (uint16_t)kv.writeOff;
+        kv.liveBytes += size;
+    }
+    kv.writeOff += size;
+
+    return KV_STORE_STATUS_SUCCESS;
+}
+
+int kv_store_write(uint16_t key, const void *data, size_t len)
+{
+    uint8_t *stored = (uint8_t *)kv.buf;
+    int status;
+
+    if (kv.handle == NULL || key >= KV_STORE_MAX_KEYS || len > KV_STORE_MAX_VALUE)
+    {
+        return KV_STORE_STATUS_INVALID;
+    }
+
+    /* Rewriting the same value would only cost flash */
+    if (kv_store_read(key, stored, KV_STORE_MAX_VALUE) == (int)len && memcmp(stored, data, len) == 0)
+    {
+        kv.stats.skipped++;
+        return KV_STORE_STATUS_SUCCESS;
+    }
+
+    status = kv_store_append(key, (uint16_t)len, data);
+    if (status == KV_STORE_STATUS_SUCCESS)
+    {
+        kv.stats.userBytes += len;
+    }
+
+    return status;
+}
+
+int kv_store_delete(uint16_t key)
+{
+    if (kv.handle == NULL || key >= KV_STORE_MAX_KEYS)
+    {
+        return KV_STORE_STATUS_INVALID;
+    }
+    if (kv.index[key] == 0)
+    {
+        return KV_STORE_STATUS_NOTFOUND;
+    }
+
+    return kv_store_append(key, KV_STORE_TOMBSTONE, NULL);
+}
+
+/*
+ *  ======== kv_store_maintain ========
+ *  Compacts only when that would leave at least the threshold free, so
+ *  a store whose live data nearly fills a sector is not erased over and
+ *  over.
+ */
+void kv_store_maintain(void)
+{
+    size_t usable;
+
+    if (kv.handle == NULL)
+    {
+        return;
+    }
+
+    usable = kv.sectorSize - KV_STORE_SECTOR_HDR;
+    if (kv.dirty ||
+        (kv.sectorSize - kv.writeOff < KV_STORE_COMPACT_THRESHOLD && usable - kv.liveBytes >= KV_STORE_COMPACT_THRESHOLD))
+    {
+        kv_store_compact();
+    }
+}
+
+void kv_store_getStats(KvStore_Stats *stats)
+{
+    *stats           = kv.stats;
+    stats->freeBytes = (kv.handle != NULL) ? kv.sectorSize - kv.writeOff : 0;
+}
@@ -0,0 +1,89 @@
+/*
+ *  ======== kv_store.h ========
+ *  Log-structured key/value store on an NVS region of two flash sectors.
+ *
+ *  Only one sector is active at a time. A write appends a record at the
+ *  end of its log instead of erasing and rewriting in place:
+ *
+ *      key (u16) | len (u16) | crc16 (u16) | 0xFFFF | value, padded to 4 | commit (u32)
+ *
+ *  The commit word is programmed from erased to zero only after the
+ *  header and value are in flash, so a record torn by a power failure
+ *  is never taken as valid; the CRC catches anything else. Deleting a
+ *  key appends a tombstone, a record with KV_STORE_TOMBSTONE set in len.
+ *
+ *  A RAM index maps each key, 0 to KV_STORE_MAX_KEYS - 1, to the offset of
+ *  its latest record, so reads cost one lookup and one NVS_read(). When
+ *  the active sector is full, the latest record of every live key is
+ *  copied to the other sector, which is erased first. Its header, which
+ *  carries a sequence number, is written last; until then the old sector
+ *  stays the valid one. The two sectors take turns, so they wear evenly.
+ *
+ *  The store is not reentrant; only one task may use it.
+ */
+#ifndef KV_STORE_H_
+#define KV_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Keys are 0 .. KV_STORE_MAX_KEYS - 1 */
+#ifndef KV_STORE_MAX_KEYS
+    #define KV_STORE_MAX_KEYS 32
+#endif
+
+/* Largest value in bytes */
+#ifndef KV_STORE_MAX_VALUE
+    #define KV_STORE_MAX_VALUE 64
+#endif
+
+/* kv_store_maintain() compacts once less than this many bytes are free */
+#ifndef KV_STORE_COMPACT_THRESHOLD
+    #define KV_STORE_COMPACT_THRESHOLD 512
+#endif
+
+#define KV_STORE_TOMBSTONE 0x8000
+
+#define KV_STORE_STATUS_SUCCESS  (0)
+#define KV_STORE_STATUS_ERROR    (-1)
+#define KV_STORE_STATUS_NOTFOUND (-2)
+#define KV_STORE_STATUS_NOSPACE  (-3)
+#define KV_STORE_STATUS_INVALID  (-4)
+
+typedef struct
+{
+    uint32_t userBytes;     /* Value bytes of records kv_store_write() appended */
+    uint32_t flashBytes;    /* Bytes programmed, including compaction */
+    uint32_t skipped;       /* Writes of an unchanged value */
+    uint32_t erases[2];     /* Per sector */
+    uint32_t compactions;
+    uint32_t torn;          /* Uncommitted or corrupt records found at open */
+    uint32_t freeBytes;     /* Left in the active sector */
+} KvStore_Stats;
+
+/*
+ * Open the NVS region index, which must hold at least two sectors, and
+ * rebuild the index from the newest valid sector. A region with no
+ * valid sector is formatted.
+ */
+int kv_store_open(uint_least8_t index);
+
+/*
+ * Copy the value of key into buf. Returns its length, which may be more
+ * than size, or KV_STORE_STATUS_NOTFOUND.
+ */
+int kv_store_read(uint16_t key, void *buf, size_t size);
+
+int kv_store_write(uint16_t key, const void *data, size_t len);
+
+int kv_store_delete(uint16_t key);
+
+/* Move the live records to the other sector now */
+int kv_store_compact(void);
+
+/* Compact if the active sector is nearly full; call from an idle loop */
+void kv_store_maintain(void);
+
+void kv_store_getStats(KvStore_Stats *stats);
+
+#endif /* KV_STORE_H_ */
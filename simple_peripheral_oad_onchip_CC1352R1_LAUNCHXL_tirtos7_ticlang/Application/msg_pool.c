@@ -0,0 +1,85 @@
+/*
+ *  ======== msg_pool.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "msg_pool.h"
+
+void msg_pool_init(MsgPool *pool, void *mem, size_t blockSize, uint16_t count)
+{
+    uint16_t i;
+
+    pool->base      = (uint8_t *)mem;
+    pool->blockSize = blockSize;
+    pool->freeList  = NULL;
+
+    /* Link the blocks so the first one is handed out first */
+    for (i = count; i > 0; i--)
+    {
+        *(void **)(pool->base + (size_t)(i - 1) * blockSize) = pool->freeList;
+        pool->freeList = pool->base + (size_t)(i - 1) * blockSize;
+    }
+
+    pool->stats.blocks    = count;
+    pool->stats.inUse     = 0;
+    pool->stats.peak      = 0;
+    pool->stats.allocs    = 0;
+    pool->stats.exhausted = 0;
+}
+
+void *msg_pool_alloc(MsgPool *pool)
+{
+    void *block;
+    uintptr_t key;
+
+    key   = HwiP_disable();
+    block = pool->freeList;
+    if (block != NULL)
+    {
+        pool->freeList = *(void **)block;
+        pool->stats.allocs++;
+        if (++pool->stats.inUse > pool->stats.peak)
+        {
+            pool->stats.peak = pool->stats.inUse;
+        }
+    }
+    else
+    {
+        pool->stats.exhausted++;
+    }
+    HwiP_restore(key);
+
+    return block;
+}
+
+void msg_pool_free(MsgPool *pool, void *block)
+{
+    uintptr_t key;
+
+    key             = HwiP_disable();
+    *(void **)block = pool->freeList;
+    pool->freeList  = block;
+    pool->stats.inUse--;
+    HwiP_restore(key);
+}
+
+bool msg_pool_owns(const MsgPool *pool, const void *block)
+{
+    const uint8_t *p = (const uint8_t *)block;
+
+    return p >= pool->base && p < pool->base + (size_t)pool->stats.blocks * pool->blockSize;
+}
+
+void msg_pool_getStats(MsgPool *pool, MsgPool_Stats *stats)
+{
+    uintptr_t key;
+
+    key    = HwiP_disable();
+    *stats = pool->stats;
+    HwiP_restore(key);
+}
@@ -0,0 +1,307 @@
+/*
+ *  ======== nv_cache.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "nv_cache.h"
+
+typedef struct
+{
+    bool used;
+    bool dirty;
+    uint8_t backend;
+    uint8_t len;
+    uint16_t id;
+    uint16_t gen;       /* Bumped on every write, to spot writes during a flush */
+    uint8_t data[NV_CACHE_MAX_VALUE];
+} NvCache_Slot;
+
+typedef struct
+{
+    NvCache_WriteFxn write;
+    void (*flushDue)(void);
+    volatile bool due;
+    ClockP_Struct clockStruct;
+    ClockP_Handle clock;
+} NvCache_Backend;
+
+static struct
+{
+    NvCache_Slot slots[NV_CACHE_SLOTS];
+    NvCache_Backend backends[NV_CACHE_MAX_BACKENDS];
+    NvCache_Stats stats;
+} cache;
+
+/*
+ *  ======== nv_cache_clockFxn ========
+ */
+static void nv_cache_clockFxn(uintptr_t arg)
+{
+    NvCache_Backend *b = &cache.backends[arg];
+
+    b->due = true;
+    if (b->flushDue != NULL)
+    {
+        b->flushDue();
+    }
+}
+
+/*
+ *  ======== nv_cache_find ========
+ *  Slot holding id of backend, or NULL. Call with interrupts disabled.
+ */
+static NvCache_Slot *nv_cache_find(int backend, uint16_t id)
+{
+    NvCache_Slot *s;
+
+    for (s = cache.slots; s < &cache.slots[NV_CACHE_SLOTS]; s++)
+    {
+        if (s->used && s->backend == backend && s->id == id)
+        {
+            return s;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ *  ======== nv_cache_claim ========
+ *  An unused slot, else a clean one. Call with interrupts disabled.
+ */
+static NvCache_Slot *nv_cache_claim(void)
+{
+    NvCache_Slot *clean = NULL;
+    NvCache_Slot *s;
+
+    for (s = cache.slots; s < &cache.slots[NV_CACHE_SLOTS]; s++)
+    {
+        if (!s->used)
+        {
+            return s;
+        }
+        if (!s->dirty && clean == NULL)
+        {
+            clean = s;
+        }
+    }
+
+    return clean;
+}
+
+static void nv_cache_arm(NvCache_Backend *b)
+{
+    ClockP_setTimeout(b->clock, (NV_CACHE_DELAY_MS * 1000) / ClockP_getSystemTickPeriod());
+    ClockP_start(b->clock);
+}
+
+void nv_cache_setBackend(int backend, NvCache_WriteFxn write, void (*flushDue)(void))
+{
+    NvCache_Backend *b = &cache.backends[backend];
+    ClockP_Params clockParams;
+
+    b->write    = write;
+    b->flushDue = flushDue;
+
+    if (b->clock == NULL)
+    {
+        ClockP_Params_init(&clockParams);
+        clockParams.arg = (uintptr_t)backend;
+        b->clock        = ClockP_construct(&b->clockStruct, nv_cache_clockFxn, 0, &clockParams);
+    }
+}
+
+int nv_cache_write(int backend, uint16_t id, const void *data, size_t len)
+{
+    NvCache_Backend *b;
+    NvCache_Slot *s;
+    bool start = false;
+    uintptr_t key;
+    int i;
+
+    if (backend < 0 || backend >= NV_CACHE_MAX_BACKENDS || len > NV_CACHE_MAX_VALUE ||
+        cache.backends[backend].clock == NULL)
+    {
+        return NV_CACHE_STATUS_INVALID;
+    }
+    b = &cache.backends[backend];
+
+    key = HwiP_disable();
+    cache.stats.writes++;
+
+    s = nv_cache_find(backend, id);
+    if (s != NULL && s->dirty)
+    {
+        cache.stats.coalesced++;
+    }
+    else if (s == NULL)
+    {
+        s = nv_cache_claim();
+    }
+
+    if (s == NULL)
+    {
+        cache.stats.full++;
+        HwiP_restore(key);
+
+        /* Everything is dirty; have every backend flushed right away */
+        for (i = 0; i < NV_CACHE_MAX_BACKENDS; i++)
+        {
+            nv_cache_clockFxn((uintptr_t)i);
+        }
+        return NV_CACHE_STATUS_FULL;
+    }
+
+    if (!s->dirty && !b->due)
+    {
+        start = !ClockP_isActive(b->clock);
+    }
+
+    s->used    = true;
+    s->dirty   = true;
+    s->backend = (uint8_t)backend;
+    s->id      = id;
+    s->len     = (uint8_t)len;
+    s->gen++;
+    memcpy(s->data, data, len);
+    HwiP_restore(key);
+
+    if (start)
+    {
+        nv_cache_arm(b);
+    }
+
+    return NV_CACHE_STATUS_SUCCESS;
+}
+
+int nv_cache_read(int backend, uint16_t id, void *buf, size_t size)
+{
+    NvCache_Slot *s;
+    uintptr_t key;
+    int len = NV_CACHE_STATUS_NOTFOUND;
+
+    key = HwiP_disable();
+    s   = nv_cache_find(backend, id);
+    if (s != NULL)
+    {
+        memcpy(buf, s->data, (s->len < size) ? s->len : size);
+        len = s->len;
+        cache.stats.readHits++;
+    }
+    HwiP_restore(key);
+
+    return len;
+}
+
+void nv_cache_drop(int backend, uint16_t id)
+{
+    NvCache_Slot *s;
+    uintptr_t key;
+
+    key = HwiP_disable();
+    s   = nv_cache_find(backend, id);
+    if (s != NULL)
+    {
+        s->used  = false;
+        s->dirty = false;
+    }
+    HwiP_restore(key);
+}
+
+/*
+ *  ======== nv_cache_flush ========
+ *  A slot stays dirty while its value is written, so it cannot be
+ *  reclaimed meanwhile; if it was written again in the meantime, the
+ *  generation no longer matches and it stays dirty for the next flush.
+ */
+int nv_cache_flush(int backend)
+{
+    NvCache_Backend *b = &cache.backends[backend];
+    uint8_t data[NV_CACHE_MAX_VALUE];
+    NvCache_Slot *s;
+    uint16_t id;
+    uint16_t gen;
+    uint8_t len;
+    uintptr_t key;
+    int status = NV_CACHE_STATUS_SUCCESS;
+    bool wrote = false;
+
+    if (b->write == NULL)
+    {
+        return NV_CACHE_STATUS_INVALID;
+    }
+
+    ClockP_stop(b->clock);
+    b->due = false;
+
+    for (s = cache.slots; s < &cache.slots[NV_CACHE_SLOTS]; s++)
+    {
+        key = HwiP_disable();
+        if (!s->dirty || s->backend != backend)
+        {
+            HwiP_restore(key);
+            continue;
+        }
+        id  = s->id;
+        gen = s->gen;
+        len = s->len;
+        memcpy(data, s->data, len);
+        HwiP_restore(key);
+
+        cache.stats.flashWrites++;
+        wrote = true;
+        if (b->write(id, data, len) != 0)
+        {
+            cache.stats.errors++;
+            if (status == NV_CACHE_STATUS_SUCCESS)
+            {
+                status = NV_CACHE_STATUS_ERROR;
+            }
+            continue;
+        }
+
+        key = HwiP_disable();
+        if (s->gen == gen)
+        {
+            s->dirty = false;
+        }
+        HwiP_restore(key);
+    }
+
+    if (wrote)
+    {
+        cache.stats.batches++;
+    }
+
+    /* Try the failed slots again after another delay */
+    if (status != NV_CACHE_STATUS_SUCCESS)
+    {
+        nv_cache_arm(b);
+    }
+
+    return status;
+}
+
+void nv_cache_service(int backend)
+{
+    if (cache.backends[backend].due)
+    {
+        nv_cache_flush(backend);
+    }
+}
+
+void nv_cache_getStats(NvCache_Stats *stats)
+{
+    uintptr_t key;
+
+    key    = HwiP_disable();
+    *stats = cache.stats;
+    HwiP_restore(key);
+}
@@ -0,0 +1,91 @@
+/*
+ *  ======== nv_cache.h ========
+ *  RAM write-back cache in front of non-volatile storage backends.
+ *
+ *  nv_cache_write() copies the value into a RAM slot and returns; a
+ *  second write to the same id before the slot is flushed replaces the
+ *  value, so only the last one reaches flash. The first write that
+ *  leaves a backend dirty starts a NV_CACHE_DELAY_MS one-shot clock;
+ *  when it expires the backend's flushDue callback is called (from the
+ *  clock's SWI) to have the owning task call nv_cache_flush(), which
+ *  writes every dirty slot of that backend in one batch.
+ *
+ *  Each backend must be flushed from a single task, the one allowed to
+ *  call its write function. Writes may come from any task. Before a
+ *  reset, call nv_cache_flush() from that task to get everything out.
+ */
+#ifndef NV_CACHE_H_
+#define NV_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef NV_CACHE_SLOTS
+    #define NV_CACHE_SLOTS 6
+#endif
+
+#ifndef NV_CACHE_MAX_VALUE
+    #define NV_CACHE_MAX_VALUE 64
+#endif
+
+#ifndef NV_CACHE_MAX_BACKENDS
+    #define NV_CACHE_MAX_BACKENDS 2
+#endif
+
+/* How long writes are collected before a backend is due for a flush */
+#ifndef NV_CACHE_DELAY_MS
+    #define NV_CACHE_DELAY_MS 1000
+#endif
+
+#define NV_CACHE_STATUS_SUCCESS  (0)
+#define NV_CACHE_STATUS_ERROR    (-1)
+#define NV_CACHE_STATUS_NOTFOUND (-2)
+#define NV_CACHE_STATUS_FULL     (-3)
+#define NV_CACHE_STATUS_INVALID  (-4)
+
+/* Write len bytes of id to the backend; returns 0 on success */
+typedef int (*NvCache_WriteFxn)(uint16_t id, const void *data, size_t len);
+
+typedef struct
+{
+    uint32_t writes;
+    uint32_t coalesced;     /* Writes that replaced a value not yet flushed */
+    uint32_t readHits;
+    uint32_t flashWrites;   /* Calls to backend write functions */
+    uint32_t batches;       /* Flushes that wrote at least one slot */
+    uint32_t full;          /* Writes refused for lack of a slot */
+    uint32_t errors;        /* Backend writes that failed; retried later */
+} NvCache_Stats;
+
+/*
+ * Set the write function of backend and the callback, which may be NULL,
+ * that asks its task to flush. With no callback the task is expected to
+ * call nv_cache_service() regularly.
+ */
+void nv_cache_setBackend(int backend, NvCache_WriteFxn write, void (*flushDue)(void));
+
+/*
+ * Cache len bytes for id of backend. Returns NV_CACHE_STATUS_FULL if all
+ * slots hold unflushed values; flushDue has been called for them.
+ */
+int nv_cache_write(int backend, uint16_t id, const void *data, size_t len);
+
+/*
+ * Copy a cached value of id into buf. Returns its length, or
+ * NV_CACHE_STATUS_NOTFOUND, in which case read the backend itself.
+ */
+int nv_cache_read(int backend, uint16_t id, void *buf, size_t size);
+
+/* Forget id of backend, flushed or not, e.g. before deleting it */
+void nv_cache_drop(int backend, uint16_t id);
+
+/* Write every dirty slot of backend now; returns the first error */
+int nv_cache_flush(int backend);
+
+/* Flush backend if its delay has expired or the cache is full */
+void nv_cache_service(int backend);
+
+void nv_cache_getStats(NvCache_Stats *stats);
+
+#endif /* NV_CACHE_H_ */
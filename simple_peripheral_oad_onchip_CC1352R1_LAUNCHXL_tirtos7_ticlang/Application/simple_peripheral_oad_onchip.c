@@ -95,6 +95,9 @@ Target Device: cc13xx_cc26xx
 #include "ti_ble_config.h"
 #include "simple_peripheral_oad_onchip_menu.h"
 #include "simple_peripheral_oad_onchip.h"
+#include "conn_registry.h"
+#include "bulk_write.h"
+#include "stream_service.h"
 
 // Used for imgHdr_t structure
 #include <common/cc26xx/oad/oad_image_header.h>
@@ -102,6 +105,7 @@ Target Device: cc13xx_cc26xx
 #include <common/cc26xx/flash_interface/flash_interface.h>
 
 #include "apps.h"
+#include "uart_trace.h"
 
 /*********************************************************************
 * CONSTANTS
@@ -139,6 +143,9 @@ Target Device: cc13xx_cc26xx
 #define MR_EVT_INSUFFICIENT_MEM    13
 #define MR_CONN_EVT                14
 #define MR_OAD_RESET_EVT           15
+#define MR_EVT_NV_FLUSH            16
+#define MR_EVT_BULK_WRITE          17
+#define MR_EVT_STREAM_CCCD         18
 
 
 #define MR_OAD_QUEUE_EVT                     OAD_QUEUE_EVT       // Event_Id_01
@@ -234,6 +241,10 @@ mrClockEventData_t argRpaRead =
 // Queue object used for app messages
 static Queue_Struct appMsg;
 static Queue_Handle appMsgQueue;
+
+// Preallocated app messages, taken before falling back to the heap
+static mrEvt_t mrMsgBlocks[MR_MSG_POOL_SIZE];
+static MsgPool mrMsgPool;
 #endif
 
 // Task configuration
@@ -292,6 +303,12 @@ mrConnRec_t connList[MAX_NUM_BLE_CONNS];
 // The application cannot reboot until all pending messages are sent
 static uint8_t numPendingMsgs = 0;
 static bool oadWaitReboot = false;
+// L2CAP flow control events were asked for by the OAD reset, not (only)
+// by a bulk write
+static bool oadFlowCtrl = false;
+
+// Source data of the bulk write test
+static uint8_t mrBulkBuf[MR_BULK_TEST_SIZE];
 
 // Flag to be stored in NV that tracks whether service changed
 // indications needs to be sent out
@@ -333,9 +350,16 @@ static void multi_role_processPairState(mrPairStateData_t* pairingEvent);
 static void multi_role_processGapMsg(gapEventHdr_t *pMsg);
 static void multi_role_processParamUpdate(uint16_t connHandle);
 static void multi_role_processAdvEvent(mrGapAdvEventData_t *pEventData);
+static int multi_role_snvWrite(uint16_t id, const void *pData, size_t len);
+static void multi_role_nvFlushDue(void);
 
 static void multi_role_charValueChangeCB(uint8_t paramID);
 status_t multi_role_enqueueMsg(uint8_t event, void *pData);
+static status_t multi_role_enqueueMsgCopy(uint8_t event, const void *pData,
+                                          uint16_t len);
+static status_t multi_role_putMsg(mrEvt_t *pMsg);
+static mrEvt_t *multi_role_allocMsg(void);
+static void multi_role_freeMsg(mrEvt_t *pMsg);
 static void multi_role_handleKeys(uint8_t keys);
 uint16_t multi_role_getConnIndex(uint16_t connHandle);
 static void multi_role_keyChangeHandler(uint8_t keys);
@@ -369,6 +393,13 @@ static void multi_role_pairStateCB(uint16_t connHandle, uint8_t state,
 static void multi_role_updateRPA(void);
 static void multi_role_connEvtCB(Gap_ConnEventRpt_t *pReport);
 static void multi_role_processConnEvt(Gap_ConnEventRpt_t *pReport);
+static void multi_role_processBulkWrite(uint32_t len);
+static void multi_role_bulkWriteDone(uint16_t connHandle, int status,
+                                     const BulkWrite_Stats *stats);
+static void multi_role_streamCccdCB(uint16_t connHandle, bool enabled);
+static void multi_role_processStreamCccd(uint16_t connHandle, bool enabled);
+static void multi_role_restoreStreamCccd(uint16_t connHandle);
+static void multi_role_updateConnEvtCb(uint16_t connHandle);
 void multi_role_processOadResetWriteCB(uint16_t connHandle, uint16_t bim_var);
 static uint8_t multi_role_processL2CAPMsg(l2capSignalEvent_t *pMsg);
 static void multi_role_processOadResetEvt(oadResetWrite_t *resetEvt);
@@ -406,6 +437,9 @@ static oadResetWriteCB_t multi_role_oadResetCBs =
   multi_role_processOadResetWriteCB // Write Callback.
 };
 
+// Console log records from this task, formatted later by mainThread
+static UartTrace_Buffer mrTrace;
+
 /*********************************************************************
 * PUBLIC FUNCTIONS
 */
@@ -496,6 +530,9 @@ static void multi_role_init(void)
   // so that the application can send and receive messages.
   ICall_registerApp(&selfEntity, &syncEvent);
 
+  // Console logging from this task is deferred, formatted by mainThread
+  uart_trace_register(&mrTrace);
+
 #ifdef LED_DEBUG
   /* Configure the LED pin */
   GPIO_setConfig(CONFIG_GPIO_GLED, GPIO_CFG_OUT_STD | GPIO_CFG_OUT_LOW);
@@ -531,6 +568,7 @@ static void multi_role_init(void)
 #else
   // Create an RTOS queue for message from profile to be sent to app.
   appMsgQueue = Util_constructQueue(&appMsg);
+  msg_pool_init(&mrMsgPool, mrMsgBlocks, sizeof(mrEvt_t), MR_MSG_POOL_SIZE);
 #endif
   // Create one-shot clock for internal periodic events.
 #ifdef FREERTOS
@@ -569,6 +607,7 @@ static void multi_role_init(void)
   GATTServApp_AddService(GATT_ALL_SERVICES);   // GATT attributes
   DevInfo_AddService();                        // Device Information Service
   SimpleProfile_AddService(GATT_ALL_SERVICES); // Simple GATT Profile
+  stream_service_addService(multi_role_streamCccdCB); // Notification stream
 
   Reset_addService((oadUsrAppCBs_t *)&multi_role_oadResetCBs);
 
@@ -661,7 +700,12 @@ static void multi_role_init(void)
   Display_print1(dispHandle, MR_ROW_SEPARATOR, 0, "== DLS On-chip OAD v%s ==",
                  versionStr);
 
-  apps();
+  // Start the other application tasks; the app is incomplete without them
+  if (apps() != 0)
+  {
+    Display_printf(dispHandle, MR_ROW_NON_CONN, 0, "App tasks failed to start");
+    MULTIROLE_ASSERT(false);
+  }
 
   /*
    * When switching from persistent app back to the user application for the
@@ -672,6 +716,8 @@ static void multi_role_init(void)
    * in NV to determine whether or not the service changed IND needs to be
    * sent
    */
+  nv_cache_setBackend(APPS_NV_SNV, multi_role_snvWrite, multi_role_nvFlushDue);
+
   uint8_t status = osal_snv_read(BLE_NVID_CUST_START,
                                   sizeof(sendSvcChngdOnNextBoot),
                                   (uint8 *)&sendSvcChngdOnNextBoot);
@@ -679,10 +725,11 @@ static void multi_role_init(void)
   {
     /*
      * On first boot the NV item will not have yet been initialzed, and the read
-     * will fail. Do a write to set the initial value of the flash in NV
+     * will fail. Set the initial value of the flash in NV; the write is
+     * cached and goes out with the next flush instead of stalling init.
      */
-     osal_snv_write(BLE_NVID_CUST_START, sizeof(sendSvcChngdOnNextBoot),
-                    (uint8 *)&sendSvcChngdOnNextBoot);
+     nv_cache_write(APPS_NV_SNV, BLE_NVID_CUST_START,
+                    &sendSvcChngdOnNextBoot, sizeof(sendSvcChngdOnNextBoot));
   }
 
 }
@@ -724,7 +771,8 @@ static void multi_role_taskFxn(UArg a0, UArg a1)
       req.handle = connList[connIndex].charHandle;
       GATT_ReadCharValue(mrConnHandle, &req, selfEntity);
       
-      test_uart_puts("read char value\n");
+      uart_trace_printf(&mrTrace, "read char value: conn %d handle 0x%04x\r\n",
+                        mrConnHandle, req.handle);
       
       test_ble_flag = 0;
     }
@@ -760,7 +808,8 @@ static void multi_role_taskFxn(UArg a0, UArg a1)
               GATT_bm_free((gattMsg_t *)&req, ATT_WRITE_REQ);
           }
 
-          test_uart_puts("write char value\n");
+          uart_trace_printf(&mrTrace, "write char value: 0x%02x status %d\r\n",
+                            charVal, status);
       }
 
       test_ble_flag = 0;
@@ -833,14 +882,14 @@ static void multi_role_taskFxn(UArg a0, UArg a1)
 #else
           while (!Queue_empty(appMsgQueue))
                {
-                 mrEvt_t *pMsg = (mrEvt_t *)Util_dequeueMsg(appMsgQueue);
+                 mrEvt_t *pMsg = (mrEvt_t *)Queue_get(appMsgQueue);
                  if (pMsg)
                  {
                    // Process message.
                    multi_role_processAppMsg(pMsg);
 
-                   // Free the space from the message.
-                   ICall_free(pMsg);
+                   // Return the message to the pool or the heap.
+                   multi_role_freeMsg(pMsg);
                  }
                }
 #endif
@@ -889,6 +938,7 @@ static void multi_role_taskFxn(UArg a0, UArg a1)
       {
         // Register for L2CAP Flow Control Events
         L2CAP_RegisterFlowCtrlTask(selfEntity);
+        oadFlowCtrl = true;
       }
 
     }
@@ -1042,6 +1092,9 @@ static uint8_t multi_role_processL2CAPMsg(l2capSignalEvent_t *pMsg)
   {
     case L2CAP_NUM_CTRL_DATA_PKT_EVT:
     {
+      // Free controller buffers are the credits of a running bulk write
+      bulk_write_setCredits(pMsg->cmd.numCtrlDataPktEvt.numDataPkt);
+
       /*
       * We cannot reboot the device immediately after receiving
       * the enable command, we must allow the stack enough time
@@ -1050,7 +1103,7 @@ static uint8_t multi_role_processL2CAPMsg(l2capSignalEvent_t *pMsg)
       * packets currently queued up by the LE controller.
       * BIM var is already set via OadPersistApp_processOadWriteCB
       */
-      if(firstRun)
+      if(firstRun && oadFlowCtrl)
       {
         firstRun = false;
 
@@ -1133,6 +1186,7 @@ static void multi_role_processGapMsg(gapEventHdr_t *pMsg)
       multi_role_scanInit();
 
       mrMaxPduSize = pPkt->dataPktLen;
+      bulk_write_init(mrMaxPduSize, MAX_NUM_PDU, multi_role_bulkWriteDone);
 
       // Enable "Discover Devices", "Set Scanning PHY", and "Set Address Type"
       // in the main menu
@@ -1186,6 +1240,9 @@ static void multi_role_processGapMsg(gapEventHdr_t *pMsg)
 
       connList[connIndex].charHandle = 0;
 
+      // A bonded client may come back already subscribed
+      multi_role_restoreStreamCccd(connHandle);
+
       Util_startClock(&clkPeriodic);
 
       pStrAddr = (uint8_t*) Util_convertBdAddr2Str(connList[connIndex].addr);
@@ -1245,6 +1302,9 @@ static void multi_role_processGapMsg(gapEventHdr_t *pMsg)
       uint8_t numConnectable = 0;
 
       BLE_LOG_INT_STR(0, BLE_LOG_MODULE_APP, "APP : GAP msg: status=%d, opcode=%s\n", 0, "GAP_LINK_TERMINATED_EVENT");
+      bulk_write_abort(connHandle);
+      stream_service_subscribe(connHandle, FALSE);
+
       // Mark this connection deleted in the connected device list.
       connIndex = multi_role_removeConnInfo(connHandle);
 
@@ -1722,9 +1782,11 @@ static void multi_role_processAppMsg(mrEvt_t *pMsg)
                     Util_convertBdAddr2Str(pAdvRpt->addr), pAdvRpt->addrType);
 #endif // DEFAULT_DEV_DISC_BY_SVC_UUID
       
-      test_uart_puts("Discovered: ");
-      test_uart_puts(Util_convertBdAddr2Str(pAdvRpt->addr));
-      test_uart_puts("\r\n");
+      // The address string from Util_convertBdAddr2Str() is a reused
+      // static buffer, so log the raw bytes instead
+      uart_trace_printf(&mrTrace, "Discovered: 0x%02X%02X%02X%02X%02X%02X\r\n",
+                        pAdvRpt->addr[5], pAdvRpt->addr[4], pAdvRpt->addr[3],
+                        pAdvRpt->addr[2], pAdvRpt->addr[1], pAdvRpt->addr[0]);
 
       // Free scan payload data
       if (pAdvRpt->pData != NULL)
@@ -1849,10 +1911,14 @@ static void multi_role_processAppMsg(mrEvt_t *pMsg)
 
     case MR_EVT_SEND_PARAM_UPDATE:
     {
-      // Extract connection handle from data
-      uint16_t locConnHandle = *(uint16_t *)(((mrClockEventData_t *)pMsg->pData)->data);
-      multi_role_processParamUpdate(locConnHandle);
-      safeToDealloc = FALSE;
+      uint32_t ref;
+
+      // Skip connections that ended after the clock expired
+      memcpy(&ref, pMsg->pData, sizeof(ref));
+      if (conn_registry_resolve(ref) < MAX_NUM_BLE_CONNS)
+      {
+        multi_role_processParamUpdate(conn_registry_refHandle(ref));
+      }
       break;
     }
 
@@ -1886,12 +1952,35 @@ static void multi_role_processAppMsg(mrEvt_t *pMsg)
       multi_role_processOadResetEvt((oadResetWrite_t *)(pMsg->pData));
       break;
 
+    case MR_EVT_NV_FLUSH:
+      nv_cache_flush(APPS_NV_SNV);
+      break;
+
+    case MR_EVT_BULK_WRITE:
+    {
+      uint32_t len;
+
+      memcpy(&len, pMsg->pData, sizeof(len));
+      multi_role_processBulkWrite(len);
+      break;
+    }
+
+    case MR_EVT_STREAM_CCCD:
+    {
+      uint32_t arg;
+
+      memcpy(&arg, pMsg->pData, sizeof(arg));
+      multi_role_processStreamCccd((uint16_t)arg, (arg >> 16) != 0);
+      break;
+    }
+
     default:
       // Do nothing.
       break;
   }
 
-  if ((safeToDealloc == TRUE) && (pMsg->pData != NULL))
+  if ((safeToDealloc == TRUE) && (pMsg->pData != NULL) &&
+      (pMsg->pData != pMsg->inlineData))
   {
     ICall_free(pMsg->pData);
   }
@@ -2117,19 +2206,8 @@ void multi_role_scanCB(uint32_t evt, void* pMsg, uintptr_t arg)
 */
 static void multi_role_charValueChangeCB(uint8_t paramID)
 {
-  uint8_t *pData;
-
-  // Allocate space for the event data.
-  if ((pData = ICall_malloc(sizeof(uint8_t))))
-  {
-    *pData = paramID;
-
-    // Queue the event.
-    if(multi_role_enqueueMsg(MR_EVT_CHAR_CHANGE, pData) != SUCCESS)
-    {
-      ICall_free(pData);
-    }
-  }
+  // Queue the event, with the parameter ID inside the message.
+  multi_role_enqueueMsgCopy(MR_EVT_CHAR_CHANGE, &paramID, sizeof(paramID));
 }
 
 /*********************************************************************
@@ -2145,25 +2223,177 @@ static void multi_role_charValueChangeCB(uint8_t paramID)
  */
 status_t multi_role_enqueueMsg(uint8_t event, void *pData)
 {
-  uint8_t success;
-  mrEvt_t *pMsg = ICall_malloc(sizeof(mrEvt_t));
+  mrEvt_t *pMsg = multi_role_allocMsg();
 
-  // Create dynamic pointer to message.
+  // Take a message from the pool, or from the heap if it is empty.
   if (pMsg)
   {
     pMsg->event = event;
     pMsg->pData = pData;
 
-    // Enqueue the message.
+    return multi_role_putMsg(pMsg);
+  }
+
+  return(bleMemAllocError);
+}
+
+/*********************************************************************
+ * @fn      multi_role_enqueueMsgCopy
+ *
+ * @brief   Queues a message with a copy of the event data. Data of up
+ *          to MR_MSG_INLINE_SIZE bytes is kept inside the message, so
+ *          small events need no allocation of their own.
+ *
+ * @param   event - message event.
+ * @param   pData - event data to copy.
+ * @param   len - length of the event data.
+ *
+ * @return  SUCCESS, FAILURE or bleMemAllocError
+ */
+static status_t multi_role_enqueueMsgCopy(uint8_t event, const void *pData,
+                                          uint16_t len)
+{
+  mrEvt_t *pMsg = multi_role_allocMsg();
+  void *pCopy;
+  status_t status;
+
+  if (pMsg == NULL)
+  {
+    return(bleMemAllocError);
+  }
+
+  if (len <= MR_MSG_INLINE_SIZE)
+  {
+    pCopy = pMsg->inlineData;
+  }
+  else if ((pCopy = ICall_malloc(len)) == NULL)
+  {
+    multi_role_freeMsg(pMsg);
+    return(bleMemAllocError);
+  }
+  memcpy(pCopy, pData, len);
+
+  pMsg->event = event;
+  pMsg->pData = pCopy;
+
+  status = multi_role_putMsg(pMsg);
+  if ((status != SUCCESS) && (len > MR_MSG_INLINE_SIZE))
+  {
+    ICall_free(pCopy);
+  }
+
+  return status;
+}
+
+/*********************************************************************
+ * @fn      multi_role_putMsg
+ *
+ * @brief   Puts a filled-in message in the RTOS queue.
+ *
+ * @param   pMsg - message from multi_role_allocMsg().
+ *
+ * @return  SUCCESS or FAILURE
+ */
+static status_t multi_role_putMsg(mrEvt_t *pMsg)
+{
 #ifdef FREERTOS
-    success = Util_enqueueMsg(g_POSIX_appMsgQueue, syncEvent, (uint8_t *)pMsg);
+  uint8_t success;
+
+  success = Util_enqueueMsg(g_POSIX_appMsgQueue, syncEvent, (uint8_t *)pMsg);
+  return (success) ? SUCCESS : FAILURE;
 #else
-    success = Util_enqueueMsg(appMsgQueue, syncEvent, (uint8_t *)pMsg);
+  // The message carries its own queue link, so it goes on the queue as
+  // is instead of being wrapped in another allocation.
+  Queue_put(appMsgQueue, &pMsg->_elem);
+  Event_post(syncEvent, MR_QUEUE_EVT);
+  return SUCCESS;
 #endif
-    return (success) ? SUCCESS : FAILURE;
+}
+
+/*********************************************************************
+ * @fn      multi_role_allocMsg
+ *
+ * @brief   Takes a message from the pool, or from the heap when the pool
+ *          is empty.
+ *
+ * @return  The message, or NULL
+ */
+static mrEvt_t *multi_role_allocMsg(void)
+{
+#ifndef FREERTOS
+  mrEvt_t *pMsg = msg_pool_alloc(&mrMsgPool);
+
+  if (pMsg)
+  {
+    return pMsg;
   }
+#endif
 
-  return(bleMemAllocError);
+  return ICall_malloc(sizeof(mrEvt_t));
+}
+
+/*********************************************************************
+ * @fn      multi_role_freeMsg
+ *
+ * @brief   Returns a message to wherever multi_role_allocMsg() took it from.
+ *
+ * @param   pMsg - message to free.
+ */
+static void multi_role_freeMsg(mrEvt_t *pMsg)
+{
+#ifndef FREERTOS
+  if (msg_pool_owns(&mrMsgPool, pMsg))
+  {
+    msg_pool_free(&mrMsgPool, pMsg);
+    return;
+  }
+#endif
+
+  ICall_free(pMsg);
+}
+
+/*********************************************************************
+ * @fn      multi_role_getMsgPoolStats
+ *
+ * @brief   Usage of the app message pool.
+ *
+ * @param   stats - filled in with the pool counters.
+ */
+void multi_role_getMsgPoolStats(MsgPool_Stats *stats)
+{
+#ifndef FREERTOS
+  msg_pool_getStats(&mrMsgPool, stats);
+#else
+  memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+/*********************************************************************
+ * @fn      multi_role_snvWrite
+ *
+ * @brief   nv_cache backend write for SNV items. Only called from the
+ *          application task, which is registered with ICall.
+ *
+ * @param   id - SNV item id.
+ * @param   pData - value to write.
+ * @param   len - length of the value.
+ *
+ * @return  0 on success, the osal_snv_write() status otherwise.
+ */
+static int multi_role_snvWrite(uint16_t id, const void *pData, size_t len)
+{
+  return osal_snv_write((osalSnvId_t)id, (osalSnvLen_t)len, (void *)pData);
+}
+
+/*********************************************************************
+ * @fn      multi_role_nvFlushDue
+ *
+ * @brief   Called by nv_cache from a clock SWI when cached SNV writes
+ *          are due; has the application task flush them.
+ */
+static void multi_role_nvFlushDue(void)
+{
+  multi_role_enqueueMsg(MR_EVT_NV_FLUSH, NULL);
 }
 
 /*********************************************************************
@@ -2288,8 +2518,10 @@ static void multi_role_clockHandler(UArg arg)
   }
   else if (pData->event == MR_EVT_SEND_PARAM_UPDATE)
   {
-    // Send message to app
-    multi_role_enqueueMsg(MR_EVT_SEND_PARAM_UPDATE, pData);
+    // Send a copy of the connection reference, since pData is freed
+    // if the connection ends before the app gets to the message
+    multi_role_enqueueMsgCopy(MR_EVT_SEND_PARAM_UPDATE, pData->data,
+                              sizeof(uint32_t));
   }
 }
 
@@ -2304,14 +2536,7 @@ static void multi_role_clockHandler(UArg arg)
 */
 static void multi_role_keyChangeHandler(uint8_t keys)
 {
-  uint8_t *pValue = ICall_malloc(sizeof(uint8_t));
-
-  if (pValue)
-  {
-    *pValue = keys;
-
-    multi_role_enqueueMsg(MR_EVT_KEY_CHANGE, pValue);
-  }
+  multi_role_enqueueMsgCopy(MR_EVT_KEY_CHANGE, &keys, sizeof(keys));
 }
 
 /*********************************************************************
@@ -2458,19 +2683,8 @@ static void multi_role_processGATTDiscEvent(gattMsgEvent_t *pMsg)
 */
 uint16_t multi_role_getConnIndex(uint16_t connHandle)
 {
-  uint8_t i;
-  // Loop through connection
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
-  {
-    // If matching connection handle found
-    if (connList[i].connHandle == connHandle)
-    {
-      return i;
-    }
-  }
-
-  // Not found if we got here
-  return(MAX_NUM_BLE_CONNS);
+  // Direct lookup; connList[] slots are handed out by the registry
+  return conn_registry_find(connHandle);
 }
 
 #ifndef Display_DISABLE_ALL
@@ -2485,14 +2699,11 @@ uint16_t multi_role_getConnIndex(uint16_t connHandle)
  */
 static char* multi_role_getConnAddrStr(uint16_t connHandle)
 {
-  uint8_t i;
+  uint8_t i = conn_registry_find(connHandle);
 
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+  if (i < MAX_NUM_BLE_CONNS)
   {
-    if (connList[i].connHandle == connHandle)
-    {
-      return Util_convertBdAddr2Str(connList[i].addr);
-    }
+    return Util_convertBdAddr2Str(connList[i].addr);
   }
 
   return NULL;
@@ -2515,13 +2726,17 @@ static uint8_t multi_role_clearConnListEntry(uint16_t connHandle)
 
   if(connHandle != LINKDB_CONNHANDLE_ALL)
   {
-    connIndex = multi_role_getConnIndex(connHandle);
-    // Get connection index from handle
+    // Release the connection index of the handle
+    connIndex = conn_registry_remove(connHandle);
     if(connIndex >= MAX_NUM_BLE_CONNS)
     {
       return bleInvalidRange;
     }
   }
+  else
+  {
+    conn_registry_reset();
+  }
 
   // Clear specific handle or all handles
   for(i = 0; i < MAX_NUM_BLE_CONNS; i++)
@@ -2531,6 +2746,7 @@ static uint8_t multi_role_clearConnListEntry(uint16_t connHandle)
       connList[i].connHandle = LINKDB_CONNHANDLE_INVALID;
       connList[i].charHandle = 0;
       connList[i].discState  =  0;
+      connList[i].connEvtCb  = FALSE;
     }
   }
 
@@ -2666,6 +2882,9 @@ static void multi_role_processPairState(mrPairStateData_t *pPairData)
       if (status == SUCCESS)
       {
         Display_printf(dispHandle, MR_ROW_SECURITY, 0, "Encryption success");
+
+        // Bonded CCCDs may only be restored once the link is encrypted
+        multi_role_restoreStreamCccd(pPairData->connHandle);
       }
       else
       {
@@ -2748,10 +2967,12 @@ static void multi_role_processConnEvt(Gap_ConnEventRpt_t *pReport)
       // be sent at the next boot
       sendSvcChngdOnNextBoot = TRUE;
 
-      uint8_t status = osal_snv_write(BLE_NVID_CUST_START,
-                                      sizeof(sendSvcChngdOnNextBoot),
-                                      (uint8 *)&sendSvcChngdOnNextBoot);
-      if(status != SUCCESS)
+      nv_cache_write(APPS_NV_SNV, BLE_NVID_CUST_START,
+                     &sendSvcChngdOnNextBoot, sizeof(sendSvcChngdOnNextBoot));
+
+      // Nothing cached may be lost to the reset
+      int status = nv_cache_flush(APPS_NV_SNV);
+      if(status != NV_CACHE_STATUS_SUCCESS)
       {
         Display_print1(dispHandle, 5, 0, "SNV WRITE FAIL: %d", status);
       }
@@ -2766,6 +2987,9 @@ static void multi_role_processConnEvt(Gap_ConnEventRpt_t *pReport)
   }
   else
   {
+    bulk_write_connEvent(pReport->handle);
+    stream_service_connEvent(pReport->handle);
+
     // Get index from handle
     uint8_t connIndex = multi_role_getConnIndex(pReport->handle);
 
@@ -2778,6 +3002,173 @@ static void multi_role_processConnEvt(Gap_ConnEventRpt_t *pReport)
   }
 }
 
+/*********************************************************************
+ * @fn      multi_role_startBulkWrite
+ *
+ * @brief   Have the app task write len bytes of a test pattern to the
+ *          characteristic of the current connection, as fast as the link
+ *          takes them. Callable from any task.
+ *
+ * @param   len - bytes to write, at most MR_BULK_TEST_SIZE
+ */
+void multi_role_startBulkWrite(uint32_t len)
+{
+  multi_role_enqueueMsgCopy(MR_EVT_BULK_WRITE, &len, sizeof(len));
+}
+
+/*********************************************************************
+ * @fn      multi_role_processBulkWrite
+ *
+ * @brief   Start a bulk write on the current connection. Connection
+ *          events and L2CAP flow control events pace the transfer until
+ *          multi_role_bulkWriteDone() is called.
+ *
+ * @param   len - bytes to write
+ */
+static void multi_role_processBulkWrite(uint32_t len)
+{
+  uint8_t connIndex = multi_role_getConnIndex(mrConnHandle);
+  uint32_t i;
+  int status;
+
+  if ((connIndex >= MAX_NUM_BLE_CONNS) || (connList[connIndex].charHandle == 0))
+  {
+    uart_trace_printf(&mrTrace, "bulk: no discovered connection\r\n");
+    return;
+  }
+  if (bulk_write_isActive())
+  {
+    uart_trace_printf(&mrTrace, "bulk: busy\r\n");
+    return;
+  }
+
+  if (len > sizeof(mrBulkBuf))
+  {
+    len = sizeof(mrBulkBuf);
+  }
+
+  // A counting pattern lets the peer spot lost or reordered segments
+  for (i = 0; i < len; i++)
+  {
+    mrBulkBuf[i] = (uint8_t)i;
+  }
+
+  L2CAP_RegisterFlowCtrlTask(selfEntity);
+
+  status = bulk_write_start(mrConnHandle, connList[connIndex].charHandle,
+                            mrBulkBuf, len);
+  uart_trace_printf(&mrTrace, "bulk: %u bytes to conn %d handle 0x%04x status %d\r\n",
+                    len, mrConnHandle, connList[connIndex].charHandle, status);
+
+  multi_role_updateConnEvtCb(mrConnHandle);
+}
+
+/*********************************************************************
+ * @fn      multi_role_bulkWriteDone
+ *
+ * @brief   Report the result and throughput of a bulk write.
+ *
+ * @param   connHandle - connection written to
+ * @param   status - BULK_WRITE_STATUS_*
+ * @param   stats - counters of the transfer
+ */
+static void multi_role_bulkWriteDone(uint16_t connHandle, int status,
+                                     const BulkWrite_Stats *stats)
+{
+  multi_role_updateConnEvtCb(connHandle);
+
+  uart_trace_printf(&mrTrace, "bulk: conn %d status %d, %u bytes in %u writes of %u\r\n",
+                    connHandle, status, stats->bytes, stats->writes,
+                    stats->segment);
+  uart_trace_printf(&mrTrace, "bulk: %u us, %u B/s, %u stalls in %u conn events\r\n",
+                    stats->elapsedUs, stats->bytesPerSec, stats->stalls,
+                    stats->connEvents);
+  Display_printf(dispHandle, MR_ROW_CUR_CONN, 0, "Bulk write: %d B/s",
+                 stats->bytesPerSec);
+}
+
+/*********************************************************************
+ * @fn      multi_role_streamCccdCB
+ *
+ * @brief   A client turned stream notifications on or off. Called in the
+ *          stack's context, so the change is handed to the app task.
+ *
+ * @param   connHandle - connection of the client
+ * @param   enabled - TRUE if notifications are now enabled
+ */
+static void multi_role_streamCccdCB(uint16_t connHandle, bool enabled)
+{
+  uint32_t arg = connHandle | ((uint32_t)enabled << 16);
+
+  multi_role_enqueueMsgCopy(MR_EVT_STREAM_CCCD, &arg, sizeof(arg));
+}
+
+/*********************************************************************
+ * @fn      multi_role_processStreamCccd
+ *
+ * @brief   Start or stop streaming to a client. While it is subscribed,
+ *          its connection events pace the notifications.
+ *
+ * @param   connHandle - connection of the client
+ * @param   enabled - TRUE if notifications are now enabled
+ */
+static void multi_role_processStreamCccd(uint16_t connHandle, bool enabled)
+{
+  stream_service_subscribe(connHandle, enabled);
+  multi_role_updateConnEvtCb(connHandle);
+
+  uart_trace_printf(&mrTrace, "stream: conn %d %s\r\n", connHandle,
+                    enabled ? "subscribed" : "unsubscribed");
+}
+
+/*********************************************************************
+ * @fn      multi_role_restoreStreamCccd
+ *
+ * @brief   Subscribe a client whose CCCD was restored from its bond
+ *          rather than written, which reports no CCCD change.
+ *
+ * @param   connHandle - connection of the client
+ */
+static void multi_role_restoreStreamCccd(uint16_t connHandle)
+{
+  if (stream_service_isEnabled(connHandle) &&
+      !stream_service_isSubscribed(connHandle))
+  {
+    multi_role_processStreamCccd(connHandle, TRUE);
+  }
+}
+
+/*********************************************************************
+ * @fn      multi_role_updateConnEvtCb
+ *
+ * @brief   Register for the connection events of a link while a bulk
+ *          write or the notification stream uses it, and unregister
+ *          when neither does. A pending OAD reboot keeps its own
+ *          registration, so nothing is changed then.
+ *
+ * @param   connHandle - connection to update
+ */
+static void multi_role_updateConnEvtCb(uint16_t connHandle)
+{
+  uint8_t connIndex = multi_role_getConnIndex(connHandle);
+  bool needed;
+
+  if ((connIndex >= MAX_NUM_BLE_CONNS) || oadWaitReboot)
+  {
+    return;
+  }
+
+  needed = bulk_write_isActiveOn(connHandle) ||
+           stream_service_isSubscribed(connHandle);
+  if (needed != connList[connIndex].connEvtCb)
+  {
+    Gap_RegisterConnEventCb(multi_role_connEvtCB,
+                            needed ? GAP_CB_REGISTER : GAP_CB_UNREGISTER,
+                            GAP_CB_CONN_EVENT_ALL, connHandle);
+    connList[connIndex].connEvtCb = needed;
+  }
+}
+
 /*********************************************************************
  * @fn      multi_role_startSvcDiscovery
  *
@@ -2821,65 +3212,63 @@ static void multi_role_startSvcDiscovery(void)
 static uint8_t multi_role_addConnInfo(uint16_t connHandle, uint8_t *pAddr,
                                       uint8_t role)
 {
-  uint8_t i;
+  // Take the lowest free entry for the new connection
+  uint8_t i = conn_registry_add(connHandle);
 
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+  if (i < MAX_NUM_BLE_CONNS)
   {
-    if (connList[i].connHandle == LINKDB_CONNHANDLE_INVALID)
-    {
-      // Found available entry to put a new connection info in
-      connList[i].connHandle = connHandle;
-      memcpy(connList[i].addr, pAddr, B_ADDR_LEN);
-      numConn++;
+    connList[i].connHandle = connHandle;
+    memcpy(connList[i].addr, pAddr, B_ADDR_LEN);
+    numConn++;
 
 #ifdef DEFAULT_SEND_PARAM_UPDATE_REQ
-      // If a peripheral, start the clock to send a connection parameter update
-      if(role == GAP_PROFILE_PERIPHERAL)
+    // If a peripheral, start the clock to send a connection parameter update
+    if(role == GAP_PROFILE_PERIPHERAL)
+    {
+      // Allocate data to send through clock handler
+      connList[i].pParamUpdateEventData = ICall_malloc(sizeof(mrClockEventData_t) +
+                                                       sizeof(uint32_t));
+      if(connList[i].pParamUpdateEventData)
       {
-        // Allocate data to send through clock handler
-        connList[i].pParamUpdateEventData = ICall_malloc(sizeof(mrClockEventData_t) +
-                                                         sizeof(uint16_t));
-        if(connList[i].pParamUpdateEventData)
+        // Set clock data
+        connList[i].pParamUpdateEventData->event = MR_EVT_SEND_PARAM_UPDATE;
+        // Refer to this connection rather than to its handle, which the
+        // stack may have reused by the time the clock expires
+        uint32_t ref = conn_registry_ref(connHandle);
+        memcpy(connList[i].pParamUpdateEventData->data, &ref, sizeof(ref));
+
+        // Create a clock object and start
+        connList[i].pUpdateClock
+          = (Clock_Struct*) ICall_malloc(sizeof(Clock_Struct));
+
+        if (connList[i].pUpdateClock)
         {
-          // Set clock data
-          connList[i].pParamUpdateEventData->event = MR_EVT_SEND_PARAM_UPDATE;
-          *((uint16_t *)connList[i].pParamUpdateEventData->data) = connHandle;
-
-          // Create a clock object and start
-          connList[i].pUpdateClock
-            = (Clock_Struct*) ICall_malloc(sizeof(Clock_Struct));
-
-          if (connList[i].pUpdateClock)
-          {
 #ifdef FREERTOS
-              Util_constructClock(connList[i].pUpdateClock,
-                                              (void*)multi_role_clockHandler,
-                                              SEND_PARAM_UPDATE_DELAY, 0, true,
-                                              (void*) connList[i].pParamUpdateEventData);
+            Util_constructClock(connList[i].pUpdateClock,
+                                            (void*)multi_role_clockHandler,
+                                            SEND_PARAM_UPDATE_DELAY, 0, true,
+                                            (void*) connList[i].pParamUpdateEventData);
 
 #else
-              Util_constructClock(connList[i].pUpdateClock,
-                                  multi_role_clockHandler,
-                                SEND_PARAM_UPDATE_DELAY, 0, true,
-                                (UArg) connList[i].pParamUpdateEventData);
+            Util_constructClock(connList[i].pUpdateClock,
+                                multi_role_clockHandler,
+                              SEND_PARAM_UPDATE_DELAY, 0, true,
+                              (UArg) connList[i].pParamUpdateEventData);
 #endif
-          }
-          else
-          {
-            // Clean up
-            ICall_free(connList[i].pParamUpdateEventData);
-          }
         }
         else
         {
-          // Memory allocation failed
-          MULTIROLE_ASSERT(false);
+          // Clean up
+          ICall_free(connList[i].pParamUpdateEventData);
         }
       }
-#endif
-
-      break;
+      else
+      {
+        // Memory allocation failed
+        MULTIROLE_ASSERT(false);
+      }
     }
+#endif
   }
 
   return i;
@@ -3751,6 +4140,7 @@ static void multi_role_processOadResetEvt(oadResetWrite_t *resetEvt)
    */
   // Register for L2CAP Flow Control Events
   L2CAP_RegisterFlowCtrlTask(selfEntity);
+  oadFlowCtrl = true;
 
   resetConnHandle = resetEvt->connHandle;
 
@@ -47,6 +47,7 @@ extern "C"
 /*********************************************************************
  * INCLUDES
  */
+#include "msg_pool.h"
 
 /*********************************************************************
 *  EXTERNAL VARIABLES
@@ -66,6 +67,18 @@ extern "C"
 #define MR_ADV_LEGACY_PHY_1_MBPS    0
 #define MR_ADV_EXT_PHY_1_MBPS       1
 #define MR_ADV_EXT_PHY_CODED        2
+
+// App messages preallocated for the queue, and the largest event data
+// carried inside the message itself
+#ifndef MR_MSG_POOL_SIZE
+#define MR_MSG_POOL_SIZE           16
+#endif
+#define MR_MSG_INLINE_SIZE         4
+
+// Largest bulk write test, see multi_role_startBulkWrite
+#ifndef MR_BULK_TEST_SIZE
+#define MR_BULK_TEST_SIZE          4096
+#endif
   
 /*********************************************************************
  * MACROS
@@ -125,6 +138,12 @@ bool multi_role_doConnPhy(uint8_t index);
 
 uint16_t multi_role_getConnIndex(uint16_t connHandle);
 
+/* Usage of the app message pool */
+void multi_role_getMsgPoolStats(MsgPool_Stats *stats);
+
+/* Write len bytes of test data to the current connection's characteristic */
+void multi_role_startBulkWrite(uint32_t len);
+
 /*********************************************************************
 *********************************************************************/
 
@@ -174,8 +193,12 @@ typedef enum {
 // App event passed from profiles.
 typedef struct
 {
+#ifndef FREERTOS
+  Queue_Elem _elem; // queue link, so no wrapper record is needed
+#endif
   uint8_t event;    // event type
   void *pData;   // event data pointer
+  uint8_t inlineData[MR_MSG_INLINE_SIZE]; // small event data, see multi_role_enqueueMsgCopy
 } mrEvt_t;
 
 // Container to store paring state info when passing from gapbondmgr callback
@@ -249,6 +272,7 @@ typedef struct
   uint8_t               rqPhy;
   uint8_t               phyRqFailCnt;                      // PHY change request count
   bool                  isAutoPHYEnable;                   // Flag to indicate auto phy change
+  bool                  connEvtCb;                         // Registered for connection events
 
 } mrConnRec_t;
 
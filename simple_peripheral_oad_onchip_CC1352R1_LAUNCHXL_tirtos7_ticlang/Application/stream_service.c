@@ -0,0 +1,358 @@
+/*
+ *  ======== stream_service.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include <icall.h>
+#include <bcomdef.h>
+/* This Header file contains all BLE API and icall structure definition */
+#include <icall_ble_api.h>
+#include <gatt_uuid.h>
+
+#include "stream_service.h"
+
+#if (STREAM_SERVICE_RING_SIZE & (STREAM_SERVICE_RING_SIZE - 1)) != 0
+    #error "STREAM_SERVICE_RING_SIZE must be a power of two"
+#endif
+
+/* Opcode and attribute handle in front of each notification */
+#define STREAM_SERVICE_ATT_HDR_SIZE 3
+
+/* Position of the characteristic value in streamAttrTbl */
+#define STREAM_SERVICE_DATA_IDX 2
+
+/*
+ * Keeps the compiler from moving ring accesses across the update of an
+ * index that hands the bytes to the other side.
+ */
+#define STREAM_SERVICE_BARRIER() __asm volatile("" ::: "memory")
+
+typedef struct
+{
+    uint16_t connHandle;
+    bool subscribed;
+    uint32_t tail;          /* Stream offset of the next byte to send */
+    uint32_t windowStart;   /* ClockP tick */
+    uint32_t windowBytes;
+    StreamService_Stats stats;
+} StreamService_Conn;
+
+static struct
+{
+    uint8_t ring[STREAM_SERVICE_RING_SIZE];
+    volatile uint32_t head;     /* Bytes ever written; producer only */
+    volatile uint32_t tailMin;  /* Oldest byte still needed; application task only */
+    volatile bool open;         /* Someone is subscribed */
+    StreamService_CccdFxn cccdFxn;
+    StreamService_Conn conns[MAX_NUM_BLE_CONNS];
+} stream;
+
+static const uint8_t streamServUUID[ATT_BT_UUID_SIZE] = {
+    LO_UINT16(STREAM_SERVICE_UUID), HI_UINT16(STREAM_SERVICE_UUID)};
+
+static const uint8_t streamDataUUID[ATT_BT_UUID_SIZE] = {
+    LO_UINT16(STREAM_SERVICE_DATA_UUID), HI_UINT16(STREAM_SERVICE_DATA_UUID)};
+
+static const gattAttrType_t streamService = {ATT_BT_UUID_SIZE, streamServUUID};
+
+static uint8_t streamDataProps = GATT_PROP_NOTIFY;
+
+/* Notifications carry their own data; nothing is kept here */
+static uint8_t streamDataValue = 0;
+
+static gattCharCfg_t streamDataCccd[MAX_NUM_BLE_CONNS];
+static gattCharCfg_t *streamDataConfig = streamDataCccd;
+
+static gattAttribute_t streamAttrTbl[] = {
+    /* Stream Service */
+    {{ATT_BT_UUID_SIZE, primaryServiceUUID}, GATT_PERMIT_READ, 0, (uint8_t *)&streamService},
+
+    /* Data Characteristic Declaration */
+    {{ATT_BT_UUID_SIZE, characterUUID}, GATT_PERMIT_READ, 0, &streamDataProps},
+
+    /* Data Characteristic Value; notify only */
+    {{ATT_BT_UUID_SIZE, streamDataUUID}, 0, 0, &streamDataValue},
+
+    /* Data Characteristic Configuration */
+    {{ATT_BT_UUID_SIZE, clientCharCfgUUID},
+     GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+     0,
+     (uint8_t *)&streamDataConfig},
+};
+
+static bStatus_t stream_service_readAttrCB(uint16_t connHandle,
+                                           gattAttribute_t *pAttr,
+                                           uint8_t *pValue,
+                                           uint16_t *pLen,
+                                           uint16_t offset,
+                                           uint16_t maxLen,
+                                           uint8_t method)
+{
+    /* Nothing of the service is read through here */
+    *pLen = 0;
+
+    return ATT_ERR_ATTR_NOT_FOUND;
+}
+
+static bStatus_t stream_service_writeAttrCB(uint16_t connHandle,
+                                            gattAttribute_t *pAttr,
+                                            uint8_t *pValue,
+                                            uint16_t len,
+                                            uint16_t offset,
+                                            uint8_t method)
+{
+    bStatus_t status;
+
+    if (pAttr->type.len != ATT_BT_UUID_SIZE ||
+        BUILD_UINT16(pAttr->type.uuid[0], pAttr->type.uuid[1]) != GATT_CLIENT_CHAR_CFG_UUID)
+    {
+        return ATT_ERR_ATTR_NOT_FOUND;
+    }
+
+    status = GATTServApp_ProcessCCCWriteReq(connHandle, pAttr, pValue, len, offset, GATT_CLIENT_CFG_NOTIFY);
+    if (status == SUCCESS && stream.cccdFxn != NULL)
+    {
+        stream.cccdFxn(connHandle,
+                       (GATTServApp_ReadCharCfg(connHandle, streamDataConfig) & GATT_CLIENT_CFG_NOTIFY) != 0);
+    }
+
+    return status;
+}
+
+static const gattServiceCBs_t streamCBs = {
+    stream_service_readAttrCB,
+    stream_service_writeAttrCB,
+    NULL,
+};
+
+static StreamService_Conn *stream_service_find(uint16_t connHandle)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+    {
+        if (stream.conns[i].subscribed && stream.conns[i].connHandle == connHandle)
+        {
+            return &stream.conns[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ *  ======== stream_service_release ========
+ *  Give the producer back the bytes every subscriber has sent.
+ */
+static void stream_service_release(void)
+{
+    uint32_t head  = stream.head;
+    uint32_t depth = 0;
+    bool open      = false;
+    uint8_t i;
+
+    for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+    {
+        if (stream.conns[i].subscribed && head - stream.conns[i].tail >= depth)
+        {
+            depth = head - stream.conns[i].tail;
+            open  = true;
+        }
+    }
+
+    STREAM_SERVICE_BARRIER();
+    stream.tailMin = head - depth;
+    stream.open    = open;
+}
+
+int stream_service_addService(StreamService_CccdFxn cccdFxn)
+{
+    memset(stream.conns, 0, sizeof(stream.conns));
+    stream.cccdFxn = cccdFxn;
+
+    GATTServApp_InitCharCfg(LINKDB_CONNHANDLE_INVALID, streamDataConfig);
+
+    if (GATTServApp_RegisterService(streamAttrTbl,
+                                    GATT_NUM_ATTRS(streamAttrTbl),
+                                    GATT_MAX_ENCRYPT_KEY_SIZE,
+                                    &streamCBs) != SUCCESS)
+    {
+        return STREAM_SERVICE_STATUS_FAILED;
+    }
+
+    return STREAM_SERVICE_STATUS_SUCCESS;
+}
+
+uint32_t stream_service_write(const uint8_t *data, uint32_t len)
+{
+    uint32_t head = stream.head;
+    uint32_t space;
+    uint32_t off;
+    uint32_t first;
+
+    if (!stream.open)
+    {
+        return 0;
+    }
+
+    space = STREAM_SERVICE_RING_SIZE - (head - stream.tailMin);
+    if (len > space)
+    {
+        len = space;
+    }
+
+    off   = head & (STREAM_SERVICE_RING_SIZE - 1);
+    first = (len < STREAM_SERVICE_RING_SIZE - off) ? len : STREAM_SERVICE_RING_SIZE - off;
+    memcpy(&stream.ring[off], data, first);
+    memcpy(stream.ring, data + first, len - first);
+
+    STREAM_SERVICE_BARRIER();
+    stream.head = head + len;
+
+    return len;
+}
+
+void stream_service_subscribe(uint16_t connHandle, bool enabled)
+{
+    StreamService_Conn *c = stream_service_find(connHandle);
+    uint8_t i;
+
+    if (enabled && c == NULL)
+    {
+        for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+        {
+            if (!stream.conns[i].subscribed)
+            {
+                c = &stream.conns[i];
+                memset(c, 0, sizeof(*c));
+                c->connHandle  = connHandle;
+                c->tail        = stream.head;  /* Live data only */
+                c->windowStart = ClockP_getSystemTicks();
+                c->subscribed  = true;
+                break;
+            }
+        }
+    }
+    else if (!enabled && c != NULL)
+    {
+        c->subscribed = false;
+    }
+
+    stream_service_release();
+}
+
+bool stream_service_isSubscribed(uint16_t connHandle)
+{
+    return stream_service_find(connHandle) != NULL;
+}
+
+bool stream_service_isEnabled(uint16_t connHandle)
+{
+    return (GATTServApp_ReadCharCfg(connHandle, streamDataConfig) & GATT_CLIENT_CFG_NOTIFY) != 0;
+}
+
+void stream_service_connEvent(uint16_t connHandle)
+{
+    StreamService_Conn *c = stream_service_find(connHandle);
+    attHandleValueNoti_t noti;
+    uint32_t head;
+    uint32_t now;
+    uint32_t us;
+    uint32_t depth;
+    uint32_t off;
+    uint32_t first;
+    uint16_t chunk;
+    uint16_t n;
+    uint8_t sent;
+
+    if (c == NULL)
+    {
+        return;
+    }
+
+    chunk = ATT_GetMTU(connHandle) - STREAM_SERVICE_ATT_HDR_SIZE;
+    head  = stream.head;
+    STREAM_SERVICE_BARRIER();
+
+    for (sent = 0; sent < STREAM_SERVICE_BURST; sent++)
+    {
+        depth = head - c->tail;
+        if (depth == 0 || (depth < chunk && sent > 0))
+        {
+            /* Let a short tail fill up until the next event */
+            break;
+        }
+        n = (depth < chunk) ? (uint16_t)depth : chunk;
+
+        noti.pValue = GATT_bm_alloc(connHandle, ATT_HANDLE_VALUE_NOTI, n, NULL);
+        if (noti.pValue == NULL)
+        {
+            c->stats.stalls++;
+            break;
+        }
+
+        off   = c->tail & (STREAM_SERVICE_RING_SIZE - 1);
+        first = (n < STREAM_SERVICE_RING_SIZE - off) ? n : STREAM_SERVICE_RING_SIZE - off;
+        memcpy(noti.pValue, &stream.ring[off], first);
+        memcpy(noti.pValue + first, stream.ring, n - first);
+        noti.handle = streamAttrTbl[STREAM_SERVICE_DATA_IDX].handle;
+        noti.len    = n;
+
+        if (GATT_Notification(connHandle, &noti, FALSE) != SUCCESS)
+        {
+            /* The controller is full for this event */
+            GATT_bm_free((gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI);
+            c->stats.stalls++;
+            break;
+        }
+
+        c->tail += n;
+        c->stats.bytes += n;
+        c->stats.notifications++;
+    }
+
+    if (sent > 0)
+    {
+        stream_service_release();
+    }
+
+    now = ClockP_getSystemTicks();
+    us  = (now - c->windowStart) * ClockP_getSystemTickPeriod();
+    if (us >= STREAM_SERVICE_RATE_MS * 1000u)
+    {
+        c->stats.bytesPerSec = (uint32_t)((uint64_t)(c->stats.bytes - c->windowBytes) * 1000000u / us);
+        c->windowStart       = now;
+        c->windowBytes       = c->stats.bytes;
+    }
+}
+
+int stream_service_getStats(uint8_t index, uint16_t *connHandle, StreamService_Stats *stats)
+{
+    StreamService_Conn *c;
+    int status = STREAM_SERVICE_STATUS_NOT_FOUND;
+    uintptr_t key;
+
+    if (index >= MAX_NUM_BLE_CONNS)
+    {
+        return status;
+    }
+
+    key = HwiP_disable();
+    c   = &stream.conns[index];
+    if (c->subscribed)
+    {
+        *connHandle  = c->connHandle;
+        *stats       = c->stats;
+        stats->depth = stream.head - c->tail;
+        status       = STREAM_SERVICE_STATUS_SUCCESS;
+    }
+    HwiP_restore(key);
+
+    return status;
+}
@@ -0,0 +1,103 @@
+/*
+ *  ======== stream_service.h ========
+ *  GATT service that streams a byte stream to subscribed clients as
+ *  notifications.
+ *
+ *  The service has one characteristic that can only be notified. Its
+ *  data comes from a ring buffer filled by a single producer, such as a
+ *  sensor or ADC task, through stream_service_write(). Each subscribed
+ *  connection has its own read position in the ring, so one producer
+ *  feeds every client. The producer is held back by the slowest client.
+ *
+ *  Sending is paced by connection events. For each connection event of
+ *  a subscribed link, stream_service_connEvent() queues as many
+ *  notifications as the stack takes, up to STREAM_SERVICE_BURST. Each
+ *  notification is ATT MTU - 3 bytes, so the controller can fill the
+ *  next event with full-size packets. A short notification goes out only
+ *  at the start of an event, with what is left over since the last one.
+ *
+ *  Per connection, the service counts bytes, notifications and stalls,
+ *  and keeps the bytes/s of the last full STREAM_SERVICE_RATE_MS window
+ *  and the number of bytes waiting in the ring.
+ *
+ *  The GATT server restores a bonded client's CCCD without a write, so
+ *  the CCCD function does not see those. Check stream_service_isEnabled()
+ *  when a link comes up or gets encrypted instead.
+ *
+ *  stream_service_write() may be called from any one task. The CCCD
+ *  function runs in the stack's context. Everything else is for the
+ *  application task, except stream_service_getStats(), which may be
+ *  called from any task.
+ */
+#ifndef STREAM_SERVICE_H_
+#define STREAM_SERVICE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Projects without -DMAX_NUM_BLE_CONNS get it from SysConfig */
+#ifndef MAX_NUM_BLE_CONNS
+    #include "ti_ble_config.h"
+#endif
+
+#define STREAM_SERVICE_UUID      0xFFE0
+#define STREAM_SERVICE_DATA_UUID 0xFFE1
+
+/* Ring buffer bytes; a power of two */
+#ifndef STREAM_SERVICE_RING_SIZE
+    #define STREAM_SERVICE_RING_SIZE 2048
+#endif
+
+/* Most notifications queued per connection event and link */
+#ifndef STREAM_SERVICE_BURST
+    #define STREAM_SERVICE_BURST 16
+#endif
+
+#ifndef STREAM_SERVICE_RATE_MS
+    #define STREAM_SERVICE_RATE_MS 1000
+#endif
+
+#define STREAM_SERVICE_STATUS_SUCCESS   (0)
+#define STREAM_SERVICE_STATUS_FAILED    (-1)
+#define STREAM_SERVICE_STATUS_NOT_FOUND (-2)
+
+typedef struct
+{
+    uint32_t bytes;
+    uint32_t notifications;
+    uint32_t stalls;        /* Bursts cut short by the stack */
+    uint32_t bytesPerSec;   /* Over the last full window */
+    uint32_t depth;         /* Bytes waiting in the ring */
+} StreamService_Stats;
+
+/* A client enabled or disabled notifications */
+typedef void (*StreamService_CccdFxn)(uint16_t connHandle, bool enabled);
+
+/* Register the service with the GATT server */
+int stream_service_addService(StreamService_CccdFxn cccdFxn);
+
+/*
+ * Producer: append up to len bytes to the stream. Returns the number of
+ * bytes taken, which is 0 while nobody is subscribed.
+ */
+uint32_t stream_service_write(const uint8_t *data, uint32_t len);
+
+/* Start or stop streaming to connHandle, e.g. on a CCCD write */
+void stream_service_subscribe(uint16_t connHandle, bool enabled);
+
+bool stream_service_isSubscribed(uint16_t connHandle);
+
+/* True if the CCCD of connHandle has notifications enabled */
+bool stream_service_isEnabled(uint16_t connHandle);
+
+/* A connection event of connHandle has ended; send what fits */
+void stream_service_connEvent(uint16_t connHandle);
+
+/*
+ * Statistics of subscriber index, 0 to MAX_NUM_BLE_CONNS - 1, and its
+ * connection handle. Returns STREAM_SERVICE_STATUS_NOT_FOUND if no
+ * connection is subscribed at that index.
+ */
+int stream_service_getStats(uint8_t index, uint16_t *connHandle, StreamService_Stats *stats);
+
+#endif /* STREAM_SERVICE_H_ */
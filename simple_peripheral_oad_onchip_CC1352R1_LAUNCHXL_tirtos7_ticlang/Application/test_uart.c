@@ -5,10 +5,20 @@
 /* Driver Header files */
 #include <ti/drivers/GPIO.h>
 #include <ti/drivers/UART2.h>
+#include <ti/drivers/dpl/HwiP.h>
 
 /* Driver configuration */
 #include "ti_drivers_config.h"
 
+#include "app_tasks.h"
+#include "kv_store.h"
+#include "nv_cache.h"
+#include "stream_service.h"
+#include "test_uart.h"
+#include "uart_cmd.h"
+#include "uart_log.h"
+#include "uart_trace.h"
+
 #include "simple_peripheral_oad_onchip.h"
 /*
  * The following function is from good old K & R.
@@ -50,6 +60,19 @@
 //     reverse(s);
 // }
 
+/* Longest the console sleeps before flushing trace records */
+#define TEST_UART_POLL_MS 50
+
+/*
+ * Poll period while the stream test produces data; short enough that the
+ * stream ring cannot run dry between two polls at 2M PHY rates.
+ */
+#define TEST_UART_STREAM_POLL_MS 5
+
+/* Stream test producer on, and the next byte of its counting pattern */
+static bool streamTest;
+static uint8_t streamSeq;
+
 char input;
 char tempStr[64] = "\r\nhello world\r\n";
 UART2_Handle uart_0;
@@ -59,234 +82,415 @@ UART2_Params uartParams_1;
 size_t bytesRead;
 size_t bytesWritten = 0;
 
+/*
+ * Console output on uart_1 is queued on the log ring and drained by the
+ * UART2 write callback, so these return without waiting for the wire.
+ * Both the BLE task and mainThread log here, and the ring takes a single
+ * producer, so each message is queued with interrupts held off; the copy
+ * is a few microseconds at most.
+ */
 void test_uart_puts(char *str)
 {
-    bytesWritten = 0;
-    while (bytesWritten == 0)
+    size_t len    = strlen(str);
+    uintptr_t key = HwiP_disable();
+
+    /* Queue the line with its "\r\n" or not at all */
+    if (len + 2 <= UART_LOG_BUF_SIZE - uart_log_pending())
     {
-        UART2_write(uart_1, str, strlen(str), &bytesWritten);
+        uart_log_write(str, len);
+        uart_log_write("\r\n", 2);
     }
-    // "\r\n"
-    bytesWritten = 0;
-    while (bytesWritten == 0)
+    else
     {
-        UART2_write(uart_1, "\r\n", 2, &bytesWritten);
+        /* Does not fit, so nothing is copied; this only counts the drop */
+        uart_log_write(str, len + 2);
     }
+    HwiP_restore(key);
 }
 
 void test_uart_print(char *str, size_t len)
 {
-    bytesWritten = 0;
-    while (bytesWritten == 0)
+    uintptr_t key = HwiP_disable();
+    uart_log_write(str, len);
+    HwiP_restore(key);
+}
+
+/* Deferred-format records logged by mainThread through test_uart_printf() */
+static UartTrace_Buffer consoleTrace;
+
+/*
+ * Records the format and arguments only; the text is produced later by
+ * uart_trace_flush() in test_uart_loop(). See uart_trace.h for the
+ * argument rules.
+ */
+void test_uart_printf(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    uart_trace_vprintf(&consoleTrace, format, args);
+    va_end(args);
+}
+
+extern mrConnRec_t connList[MAX_NUM_BLE_CONNS];
+extern ICall_EntityID selfEntity;
+extern uint16_t mrConnHandle;
+extern uint8_t charVal;
+extern int test_ble_flag;
+extern uint8_t advHandle;
+
+/*
+ *  ======== test_uart_cmdEcho ========
+ *  Every key is reported and echoed; keys with no entry stop here.
+ */
+static void test_uart_cmdEcho(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    input = (char)cmd;
+
+    sprintf(tempStr, "\r\ninput:%d\r\n", (int)input);
+    test_uart_print(tempStr, strlen(tempStr));
+
+    test_uart_print(&input, 1);
+    GPIO_toggle(CONFIG_GPIO_GLED);
+}
+
+/*
+ *  ======== test_uart_cmdStatus ========
+ *  '0': dump charVal, the CHAR6 value and the connection handles.
+ */
+static void test_uart_cmdStatus(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_cmdEcho(cmd, payload, len);
+
+    test_uart_print("hello world\r\n", 13);
+    GPIO_toggle(CONFIG_GPIO_GLED);
+
+    // view charVal
+    sprintf(tempStr, "\r\ncharVal:%d\r\n", (int)charVal);
+    test_uart_print(tempStr, strlen(tempStr));
+    GPIO_toggle(CONFIG_GPIO_GLED);
+
+    char multi_role_tmpbuf[20] = { 0 };
+    #define SIMPLEPROFILE_CHAR6                   5  // RW uint8 - Profile Characteristic 4 value
+    SimpleProfile_GetParameter(SIMPLEPROFILE_CHAR6, multi_role_tmpbuf);
+    // view multi_role_tmpbuf
+    sprintf(tempStr, "\r\nmulti_role_tmpbuf:%.*s\r\n", 20, multi_role_tmpbuf);
+    test_uart_puts(tempStr);
+
+    // Loop through connection
+    for (int i = 0; i < MAX_NUM_BLE_CONNS; i++)
     {
-        UART2_write(uart_1, str, len, &bytesWritten);
+        test_uart_puts("connHandle:");
+        sprintf(tempStr, "%d", (int)connList[i].connHandle);
+        test_uart_puts(tempStr);
     }
 }
 
-//void test_uart_printf(const char *format, ...)
-//{
-//    char buf[256];
-//    va_list args;
-//    va_start(args, format);
-//    vsprintf(buf, format, args);
-//    va_end(args);
+/*
+ *  ======== test_uart_cmdConnect ========
+ *  '1': connect to the test peer.
+ */
+static void test_uart_cmdConnect(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_cmdEcho(cmd, payload, len);
+
+    // Temporarily disable advertising
+    GapAdv_disable(advHandle);
+
+    // Scanned device information record
+    typedef struct
+    {
+    uint8_t addrType; // Peer Device's Address Type
+    uint8_t addr[6];  // Peer Device Address
+    } scanRec_t;
+
+    scanRec_t advRpt; // 09:df:00:71:77:60 addrType 0
+    advRpt.addrType = 0;
+    advRpt.addr[0] = 0x09;
+    advRpt.addr[1] = 0xdf;
+    advRpt.addr[2] = 0x00;
+    advRpt.addr[3] = 0x71;
+    advRpt.addr[4] = 0x77;
+    advRpt.addr[5] = 0x60;
+
+    GapInit_connect(advRpt.addrType & 0x01, advRpt.addr, 0x01, 0);
+
+    char tmp[64];
+    sprintf(tmp, "Connecting to %02x:%02x:%02x:%02x:%02x:%02x\r\n", advRpt.addr[0], advRpt.addr[1], advRpt.addr[2], advRpt.addr[3], advRpt.addr[4], advRpt.addr[5]);
+    test_uart_puts(tmp);
+
+    // Re-enable advertising
+    GapAdv_enable(advHandle, 0, 0);
+}
+
+// '2', '3' and '4' (scan / stop scan / connect to first report) are
+// parked until the scan path is reworked:
+//
+//     GapScan_enable(0, 100, 15);
+//     test_uart_puts("Discovering...\r\n");
 //
-//    test_uart_print(buf, strlen(buf));
-//}
+//     GapScan_disable();
+//     test_uart_puts("Stopped Discovering\r\n");
+//
+//     GapScan_Evt_AdvRpt_t advRpt;
+//     GapScan_getAdvReport(0, &advRpt);
+//     GapInit_connect(advRpt.addrType & 0x01, advRpt.addr, 0x01, 0);
 
-void test_uart_init(void)
+/*
+ *  ======== test_uart_cmdRead ========
+ *  '5': have the BLE task read the peer characteristic.
+ */
+static void test_uart_cmdRead(uint8_t cmd, const uint8_t *payload, size_t len)
 {
+    test_uart_cmdEcho(cmd, payload, len);
 
-    UART2_Params_init(&uartParams_1);
-    uartParams_1.baudRate = 115200;
+    test_ble_flag = 1;
+}
 
-    uart_1 = UART2_open(CONFIG_DISPLAY_UART, &uartParams_1);
+/*
+ *  ======== test_uart_cmdWrite ========
+ *  '6': have the BLE task write a random test value to the peer.
+ */
+static void test_uart_cmdWrite(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_cmdEcho(cmd, payload, len);
 
-    if (uart_1 == NULL)
+    test_ble_flag = rand() % 3 + 2;
+}
+
+/*
+ *  ======== test_uart_cmdDiscover ========
+ *  '7': select the first connection and discover its service if needed.
+ */
+static void test_uart_cmdDiscover(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_cmdEcho(cmd, payload, len);
+
+    uint8_t connIndex = multi_role_getConnIndex(0);
+    mrConnHandle = connList[connIndex].connHandle;
+
+    if (connList[connIndex].charHandle == 0)
     {
-        /* UART2_open() failed */
-        while (1) {}
+        #define MR_EVT_SVC_DISC            6
+
+        // Initiate service discovery
+        multi_role_enqueueMsg(MR_EVT_SVC_DISC, NULL);
     }
 
-    UART2_write(uart_1, tempStr, strlen(tempStr), &bytesWritten);
+    test_uart_puts("connHandle:");
+    sprintf(tempStr, "%d", (int)connList[connIndex].connHandle);
+    test_uart_puts(tempStr);
+}
 
+/*
+ *  ======== test_uart_cmdConnInfo ========
+ *  '8': show the selected connection.
+ */
+static void test_uart_cmdConnInfo(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_cmdEcho(cmd, payload, len);
+
+    uint8_t connIndex = multi_role_getConnIndex(mrConnHandle);
+    // connList[connIndex].discState == BLE_DISC_STATE_CHAR
+    test_uart_puts("connHandle:");
+    sprintf(tempStr, "%d", (int)connList[connIndex].connHandle);
+    test_uart_puts(tempStr);
+    // discExist == 1
+    test_uart_puts("discExist:");
+    sprintf(tempStr, "%d", (int)connList[connIndex].discExist);
+    test_uart_puts(tempStr);
 }
 
-void test_uart_loop()
+static void test_uart_putLine(const char *line)
 {
+    test_uart_puts((char *)line);
+}
 
-    extern mrConnRec_t connList[MAX_NUM_BLE_CONNS];
-    extern ICall_EntityID selfEntity;
-    extern uint16_t mrConnHandle;
+/*
+ *  ======== test_uart_cmdStacks ========
+ *  'k': stack high-water mark of every application task.
+ */
+static void test_uart_cmdStacks(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_puts("\r\n");
+    app_tasks_report(test_uart_putLine);
+}
 
-    int status           = UART2_STATUS_SUCCESS;
+/*
+ *  ======== test_uart_cmdKvStats ========
+ *  'n': flash traffic of the CONFIG_NVS_0 key/value store and of the
+ *  write-back cache in front of it and of SNV.
+ */
+static void test_uart_cmdKvStats(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    KvStore_Stats stats;
+    NvCache_Stats cacheStats;
+
+    kv_store_getStats(&stats);
+    nv_cache_getStats(&cacheStats);
+
+    test_uart_printf("\r\nkv: user %u flash %u skipped %u free %u\r\n",
+                     stats.userBytes,
+                     stats.flashBytes,
+                     stats.skipped,
+                     stats.freeBytes);
+    test_uart_printf("kv: erases %u/%u compactions %u torn %u\r\n",
+                     stats.erases[0],
+                     stats.erases[1],
+                     stats.compactions,
+                     stats.torn);
+    test_uart_printf("nv: writes %u coalesced %u flash %u batches %u full %u errors %u\r\n",
+                     cacheStats.writes,
+                     cacheStats.coalesced,
+                     cacheStats.flashWrites,
+                     cacheStats.batches,
+                     cacheStats.full,
+                     cacheStats.errors);
+}
 
-    bytesRead = 0;
-    status = UART2_readTimeout(uart_1, &input, 1, &bytesRead, 1000); // 1ms
-    if (status == UART2_STATUS_SUCCESS)
-    {
-        bytesWritten = 0;
-        sprintf(tempStr, "\r\ninput:%d\r\n", (int)input);
-        UART2_write(uart_1, tempStr, strlen(tempStr), &bytesWritten);
+/*
+ *  ======== test_uart_cmdMsgPool ========
+ *  'm': usage of the preallocated application message pool.
+ */
+static void test_uart_cmdMsgPool(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    MsgPool_Stats stats;
 
-        bytesWritten = 0;
-        while (bytesWritten == 0)
-        {
-            status = UART2_write(uart_1, &input, 1, &bytesWritten);
-            GPIO_toggle(CONFIG_GPIO_GLED);
-        }
-        
-        if (input == '0')
-        {
-            bytesWritten = 0;
-            while (bytesWritten == 0)
-            {
-                status = UART2_write(uart_1, "hello world\r\n", 13, &bytesWritten);
-                GPIO_toggle(CONFIG_GPIO_GLED);
-            }
-        }
+    multi_role_getMsgPoolStats(&stats);
 
-        extern uint8_t charVal;
-        
-        if (input == '0')
-        {
-            // view charVal
-            bytesWritten = 0;
-            while (bytesWritten == 0)
-            {
-                sprintf(tempStr, "\r\ncharVal:%d\r\n", (int)charVal);
-                status = UART2_write(uart_1, tempStr, strlen(tempStr), &bytesWritten);
-                GPIO_toggle(CONFIG_GPIO_GLED);
-            }
-
-            char multi_role_tmpbuf[20] = { 0 };
-            #define SIMPLEPROFILE_CHAR6                   5  // RW uint8 - Profile Characteristic 4 value
-            SimpleProfile_GetParameter(SIMPLEPROFILE_CHAR6, multi_role_tmpbuf);
-            // view multi_role_tmpbuf
-            sprintf(tempStr, "\r\nmulti_role_tmpbuf:%.*s\r\n", 20, multi_role_tmpbuf);
-            test_uart_puts(tempStr);
-
-            // Loop through connection
-            for (int i = 0; i < MAX_NUM_BLE_CONNS; i++)
-            {
-                test_uart_puts("connHandle:");
-                sprintf(tempStr, "%d", (int)connList[i].connHandle);
-                test_uart_puts(tempStr);
-            }
-        }
+    test_uart_printf("\r\nmsg: blocks %u inUse %u peak %u allocs %u exhausted %u\r\n",
+                     stats.blocks,
+                     stats.inUse,
+                     stats.peak,
+                     stats.allocs,
+                     stats.exhausted);
+}
 
-        if (input == '8')
-        {
-            uint8_t connIndex = multi_role_getConnIndex(mrConnHandle);
-            // connList[connIndex].discState == BLE_DISC_STATE_CHAR
-            test_uart_puts("connHandle:");
-            sprintf(tempStr, "%d", (int)connList[connIndex].connHandle);
-            test_uart_puts(tempStr);
-            // discExist == 1
-            test_uart_puts("discExist:");
-            sprintf(tempStr, "%d", (int)connList[connIndex].discExist);
-            test_uart_puts(tempStr);
-            return;
-        }
+/*
+ *  ======== test_uart_cmdBulkWrite ========
+ *  'w': bulk write MR_BULK_TEST_SIZE bytes to the selected connection;
+ *  the BLE task traces the throughput when it is done.
+ */
+static void test_uart_cmdBulkWrite(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    test_uart_cmdEcho(cmd, payload, len);
 
-        if (input == '7')
-        {
-            uint8_t connIndex = multi_role_getConnIndex(0);
-            mrConnHandle = connList[connIndex].connHandle;
-
-            if (connList[connIndex].charHandle == 0)
-            {
-                #define MR_EVT_SVC_DISC            6
-                
-                // Initiate service discovery
-                multi_role_enqueueMsg(MR_EVT_SVC_DISC, NULL);
-            }
-
-            test_uart_puts("connHandle:");
-            sprintf(tempStr, "%d", (int)connList[connIndex].connHandle);
-            test_uart_puts(tempStr);
-            return;
-        }
+    multi_role_startBulkWrite(MR_BULK_TEST_SIZE);
+}
 
-        if (input == '6')
+/*
+ *  ======== test_uart_cmdStream ========
+ *  's': start or stop feeding a counting pattern into the notification
+ *  stream.
+ */
+static void test_uart_cmdStream(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    streamTest = !streamTest;
+
+    test_uart_printf("\r\nstream test %s\r\n", streamTest ? "on" : "off");
+}
+
+/*
+ *  ======== test_uart_cmdStreamStats ========
+ *  't': throughput and queue depth of every subscribed connection.
+ */
+static void test_uart_cmdStreamStats(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    StreamService_Stats stats;
+    uint16_t connHandle;
+    int i;
+
+    test_uart_puts("\r\n");
+    for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+    {
+        if (stream_service_getStats(i, &connHandle, &stats) == STREAM_SERVICE_STATUS_SUCCESS)
         {
-            extern int test_ble_flag;
-            test_ble_flag = rand() % 3 + 2;
-            return;
+            test_uart_printf("stream: conn %d %u B/s depth %u bytes %u notis %u stalls %u\r\n",
+                             connHandle,
+                             stats.bytesPerSec,
+                             stats.depth,
+                             stats.bytes,
+                             stats.notifications,
+                             stats.stalls);
         }
+    }
+}
+
+/*
+ *  ======== test_uart_produce ========
+ *  Top up the stream ring with the counting pattern.
+ */
+static void test_uart_produce(void)
+{
+    uint8_t block[64];
+    uint32_t n;
+    uint8_t i;
 
-        if (input == '5')
+    do
+    {
+        for (i = 0; i < sizeof(block); i++)
         {
-            extern int test_ble_flag;
-            test_ble_flag = 1;
-            return;
+            block[i] = (uint8_t)(streamSeq + i);
         }
+        n = stream_service_write(block, sizeof(block));
+        streamSeq += (uint8_t)n;
+    } while (n == sizeof(block));
+}
 
-        // if (input == '4')
-        // {
-        //     GapScan_enable(0, 100, 15);
-        //     test_uart_puts("Discovering...\r\n");
-        //     return;
-        // }
+static const UartCmd_Entry uartCmdTable[] = {
+    {'0', test_uart_cmdStatus},
+    {'1', test_uart_cmdConnect},
+    {'5', test_uart_cmdRead},
+    {'6', test_uart_cmdWrite},
+    {'7', test_uart_cmdDiscover},
+    {'8', test_uart_cmdConnInfo},
+    {'k', test_uart_cmdStacks},
+    {'m', test_uart_cmdMsgPool},
+    {'n', test_uart_cmdKvStats},
+    {'s', test_uart_cmdStream},
+    {'t', test_uart_cmdStreamStats},
+    {'w', test_uart_cmdBulkWrite},
+};
 
-        // if (input == '3')
-        // {
-        //     GapScan_disable();
-        //     test_uart_puts("Stopped Discovering\r\n");
-        //     return;
-        // }
+void test_uart_init(void)
+{
+
+    UART2_Params_init(&uartParams_1);
+    uartParams_1.baudRate       = 115200;
+    uartParams_1.writeMode      = UART2_Mode_CALLBACK;
+    uartParams_1.writeCallback  = uart_log_writeCallback;
+    uartParams_1.readMode       = UART2_Mode_CALLBACK;
+    uartParams_1.readReturnMode = UART2_ReadReturnMode_PARTIAL;
+    uartParams_1.readCallback   = uart_cmd_readCallback;
 
-        // if (input == '2')
-        // {
-        //     GapScan_Evt_AdvRpt_t advRpt;
+    uart_1 = UART2_open(CONFIG_DISPLAY_UART, &uartParams_1);
 
-        //     GapScan_getAdvReport(0, &advRpt);
+    if (uart_1 == NULL)
+    {
+        /* UART2_open() failed */
+        while (1) {}
+    }
 
-        //     static tmp[64] = {0};
-        //     sprintf(tmp, "mac: %02x:%02x:%02x:%02x:%02x:%02x\r\n", advRpt.addr[0], advRpt.addr[1], advRpt.addr[2], advRpt.addr[3], advRpt.addr[4], advRpt.addr[5]);
-        //     test_uart_puts(tmp);
+    uart_log_init(uart_1);
+    uart_trace_register(&consoleTrace);
+    uart_cmd_init(uart_1, uartCmdTable, sizeof(uartCmdTable) / sizeof(uartCmdTable[0]), test_uart_cmdEcho);
 
-        //     GapInit_connect(advRpt.addrType & 0x01, advRpt.addr, 0x01, 0);
+    test_uart_print(tempStr, strlen(tempStr));
 
-        //     // multi_role_doConnUpdate(0);
-        //     // test_uart_puts("Connection Update Request\r\n");
-        //     return;
-        // }
+}
 
-        if (input == '1')
-        {
-            // Temporarily disable advertising
-            extern uint8_t advHandle;
-            GapAdv_disable(advHandle);
-
-            // Scanned device information record
-            typedef struct
-            {
-            uint8_t addrType; // Peer Device's Address Type
-            uint8_t addr[6];  // Peer Device Address
-            } scanRec_t;
-
-            scanRec_t advRpt; // 09:df:00:71:77:60 addrType 0
-            advRpt.addrType = 0;
-            advRpt.addr[0] = 0x09;
-            advRpt.addr[1] = 0xdf;
-            advRpt.addr[2] = 0x00;
-            advRpt.addr[3] = 0x71;
-            advRpt.addr[4] = 0x77;
-            advRpt.addr[5] = 0x60;
-
-            GapInit_connect(advRpt.addrType & 0x01, advRpt.addr, 0x01, 0);
-
-            char tmp[64];
-            sprintf(tmp, "Connecting to %02x:%02x:%02x:%02x:%02x:%02x\r\n", advRpt.addr[0], advRpt.addr[1], advRpt.addr[2], advRpt.addr[3], advRpt.addr[4], advRpt.addr[5]);
-            test_uart_puts(tmp);
-
-            // Re-enable advertising
-            GapAdv_enable(advHandle, 0, 0);
-
-            return;
-        }
+void test_uart_loop()
+{
+    /*
+     * Sleep until input arrives, waking at least every TEST_UART_POLL_MS
+     * so trace records from the BLE task still get flushed.
+     */
+    uart_cmd_process(streamTest ? TEST_UART_STREAM_POLL_MS : TEST_UART_POLL_MS);
 
+    if (streamTest)
+    {
+        test_uart_produce();
     }
 
+    uart_trace_flush();
 }
@@ -0,0 +1,345 @@
+/*
+ *  ======== uart_cmd.c ========
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Driver Header files */
+#include <ti/drivers/UART2.h>
+#include <ti/drivers/dpl/ClockP.h>
+#include <ti/drivers/dpl/HwiP.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+
+#include "uart_cmd.h"
+
+#define UART_CMD_RX_MASK (UART_CMD_RX_SIZE - 1)
+
+#if (UART_CMD_RX_SIZE & UART_CMD_RX_MASK) != 0
+    #error "UART_CMD_RX_SIZE must be a power of two"
+#endif
+
+typedef enum
+{
+    UART_CMD_STATE_IDLE,
+    UART_CMD_STATE_LEN,
+    UART_CMD_STATE_CMD,
+    UART_CMD_STATE_PAYLOAD,
+    UART_CMD_STATE_CRC
+} UartCmd_State;
+
+/*
+ * The read callback is the only writer of head, uart_cmd_process() the
+ * only writer of tail. A read is always armed on the free space after
+ * head unless the ring is full, in which case rxStalled is set and the
+ * consumer re-arms it once it has made room.
+ */
+static struct
+{
+    UART2_Handle handle;
+    const UartCmd_Entry *table;
+    size_t count;
+    UartCmd_Handler defaultFxn;
+    void (*notify)(void);
+
+    SemaphoreP_Struct semStruct;
+    SemaphoreP_Handle sem;
+
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile bool rxStalled;
+    volatile bool stopped;
+    volatile uint32_t rxTick;   /* ClockP tick of the last read completion */
+
+    uint32_t frameTick;         /* rxTick of the last byte parsed */
+
+    UartCmd_State state;
+    uint8_t len;
+    uint8_t cmd;
+    uint8_t crc;
+    uint8_t pos;
+    uint8_t payload[UART_CMD_MAX_PAYLOAD];
+
+    UartCmd_Stats stats;
+    uint8_t rx[UART_CMD_RX_SIZE];
+} uartCmd;
+
+/*
+ *  ======== uart_cmd_crc8 ========
+ *  CRC-8, polynomial 0x07.
+ */
+static uint8_t uart_cmd_crc8(uint8_t crc, uint8_t data)
+{
+    uint_fast8_t i;
+
+    crc ^= data;
+    for (i = 0; i < 8; i++)
+    {
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+
+    return crc;
+}
+
+/*
+ *  ======== uart_cmd_armRead ========
+ *  Start a read into the contiguous free space after head. Called from
+ *  the read callback or with hardware interrupts disabled.
+ */
+static void uart_cmd_armRead(void)
+{
+    uint32_t head = uartCmd.head;
+    uint32_t idx  = head & UART_CMD_RX_MASK;
+    size_t space  = UART_CMD_RX_SIZE - (head - uartCmd.tail);
+
+    if (space == 0)
+    {
+        uartCmd.rxStalled = true;
+        uartCmd.stats.stalls++;
+        return;
+    }
+
+    if (space > UART_CMD_RX_SIZE - idx)
+    {
+        space = UART_CMD_RX_SIZE - idx;
+    }
+
+    uartCmd.rxStalled = false;
+    UART2_read(uartCmd.handle, &uartCmd.rx[idx], space, NULL);
+}
+
+/*
+ *  ======== uart_cmd_dispatch ========
+ */
+static void uart_cmd_dispatch(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < uartCmd.count; i++)
+    {
+        if (uartCmd.table[i].cmd == cmd)
+        {
+            uartCmd.table[i].fxn(cmd, payload, len);
+            return;
+        }
+    }
+
+    uartCmd.stats.unknown++;
+    if (uartCmd.defaultFxn != NULL)
+    {
+        uartCmd.defaultFxn(cmd, payload, len);
+    }
+}
+
+/*
+ *  ======== uart_cmd_parse ========
+ */
+static void uart_cmd_parse(uint8_t c)
+{
+    switch (uartCmd.state)
+    {
+        case UART_CMD_STATE_IDLE:
+            if (c == UART_CMD_SOF)
+            {
+                uartCmd.state = UART_CMD_STATE_LEN;
+                uartCmd.crc   = 0;
+            }
+            else
+            {
+                uartCmd.stats.keys++;
+                uart_cmd_dispatch(c, NULL, 0);
+            }
+            break;
+
+        case UART_CMD_STATE_LEN:
+            if (c > UART_CMD_MAX_PAYLOAD)
+            {
+                uartCmd.stats.crcErrors++;
+                uartCmd.state = UART_CMD_STATE_IDLE;
+                break;
+            }
+            uartCmd.len   = c;
+            uartCmd.pos   = 0;
+            uartCmd.crc   = uart_cmd_crc8(uartCmd.crc, c);
+            uartCmd.state = UART_CMD_STATE_CMD;
+            break;
+
+        case UART_CMD_STATE_CMD:
+            uartCmd.cmd   = c;
+            uartCmd.crc   = uart_cmd_crc8(uartCmd.crc, c);
+            uartCmd.state = (uartCmd.len != 0) ? UART_CMD_STATE_PAYLOAD : UART_CMD_STATE_CRC;
+            break;
+
+        case UART_CMD_STATE_PAYLOAD:
+            uartCmd.payload[uartCmd.pos++] = c;
+            uartCmd.crc                    = uart_cmd_crc8(uartCmd.crc, c);
+            if (uartCmd.pos == uartCmd.len)
+            {
+                uartCmd.state = UART_CMD_STATE_CRC;
+            }
+            break;
+
+        case UART_CMD_STATE_CRC:
+            uartCmd.state = UART_CMD_STATE_IDLE;
+            if (c != uartCmd.crc)
+            {
+                uartCmd.stats.crcErrors++;
+                break;
+            }
+            uartCmd.stats.frames++;
+            uart_cmd_dispatch(uartCmd.cmd, uartCmd.payload, uartCmd.len);
+            break;
+    }
+}
+
+void uart_cmd_init(UART2_Handle handle, const UartCmd_Entry *table, size_t count, UartCmd_Handler defaultFxn)
+{
+    uintptr_t key;
+
+    uartCmd.handle     = handle;
+    uartCmd.table      = table;
+    uartCmd.count      = count;
+    uartCmd.defaultFxn = defaultFxn;
+    uartCmd.state      = UART_CMD_STATE_IDLE;
+
+    uartCmd.sem = SemaphoreP_constructBinary(&uartCmd.semStruct, 0);
+
+    key = HwiP_disable();
+    uart_cmd_armRead();
+    HwiP_restore(key);
+}
+
+/*
+ *  ======== uart_cmd_readCallback ========
+ */
+void uart_cmd_readCallback(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status)
+{
+    if (status == UART2_STATUS_EOVERRUN)
+    {
+        uartCmd.stats.overruns++;
+    }
+
+    if (count != 0)
+    {
+        uartCmd.rxTick = ClockP_getSystemTicks();
+    }
+    uartCmd.head += count;
+    uartCmd.stats.bytesRead += count;
+
+    if (status != UART2_STATUS_ECANCELLED && !uartCmd.stopped)
+    {
+        uart_cmd_armRead();
+    }
+
+    if (count != 0)
+    {
+        SemaphoreP_post(uartCmd.sem);
+        if (uartCmd.notify != NULL)
+        {
+            uartCmd.notify();
+        }
+    }
+}
+
+void uart_cmd_setNotify(void (*notify)(void))
+{
+    uartCmd.notify = notify;
+}
+
+/*
+ *  ======== uart_cmd_resync ========
+ *  Drop a partial frame whose next byte did not come in time. arrival is
+ *  when the bytes about to be parsed came in, or now if there are none.
+ */
+static void uart_cmd_resync(uint32_t arrival)
+{
+    uint32_t limit = (UART_CMD_FRAME_TIMEOUT_MS * 1000) / ClockP_getSystemTickPeriod();
+
+    if (uartCmd.state != UART_CMD_STATE_IDLE && arrival - uartCmd.frameTick > limit)
+    {
+        uartCmd.stats.timeouts++;
+        uartCmd.state = UART_CMD_STATE_IDLE;
+    }
+}
+
+void uart_cmd_process(uint32_t timeoutMs)
+{
+    uint32_t timeout = SemaphoreP_WAIT_FOREVER;
+    uint32_t tail;
+    uint32_t head;
+    uint32_t arrival;
+    uintptr_t key;
+
+    if (timeoutMs != UART_CMD_WAIT_FOREVER)
+    {
+        timeout = (timeoutMs * 1000) / ClockP_getSystemTickPeriod();
+    }
+
+    if (uartCmd.head == uartCmd.tail)
+    {
+        /* Mid-frame, wait no longer than the frame may pause */
+        if (uartCmd.state != UART_CMD_STATE_IDLE &&
+            timeout > (UART_CMD_FRAME_TIMEOUT_MS * 1000) / ClockP_getSystemTickPeriod())
+        {
+            timeout = (UART_CMD_FRAME_TIMEOUT_MS * 1000) / ClockP_getSystemTickPeriod();
+        }
+        SemaphoreP_pend(uartCmd.sem, timeout);
+    }
+
+    key     = HwiP_disable();
+    head    = uartCmd.head;
+    arrival = uartCmd.rxTick;
+    HwiP_restore(key);
+
+    if (head == uartCmd.tail)
+    {
+        uart_cmd_resync(ClockP_getSystemTicks());
+    }
+    else
+    {
+        uart_cmd_resync(arrival);
+        for (tail = uartCmd.tail; tail != head; tail++)
+        {
+            uart_cmd_parse(uartCmd.rx[tail & UART_CMD_RX_MASK]);
+        }
+        uartCmd.tail      = tail;
+        uartCmd.frameTick = arrival;
+    }
+
+    if (uartCmd.rxStalled)
+    {
+        key = HwiP_disable();
+        if (uartCmd.rxStalled && !uartCmd.stopped)
+        {
+            uart_cmd_armRead();
+        }
+        HwiP_restore(key);
+    }
+}
+
+void uart_cmd_stop(void)
+{
+    uintptr_t key;
+
+    key             = HwiP_disable();
+    uartCmd.stopped = true;
+    HwiP_restore(key);
+
+    UART2_readCancel(uartCmd.handle);
+}
+
+void uart_cmd_start(void)
+{
+    uintptr_t key;
+
+    key               = HwiP_disable();
+    uartCmd.stopped   = false;
+    uartCmd.rxStalled = false;
+    uart_cmd_armRead();
+    HwiP_restore(key);
+}
+
+void uart_cmd_getStats(UartCmd_Stats *stats)
+{
+    *stats = uartCmd.stats;
+}
@@ -0,0 +1,85 @@
+/*
+ *  ======== uart_log.h ========
+ *  Non-blocking UART log output.
+ *
+ *  Log producers copy their bytes into a single-producer/single-consumer
+ *  ring buffer and return immediately. The ring is drained by a UART2
+ *  opened with writeMode = UART2_Mode_CALLBACK, one contiguous chunk per
+ *  write, with the next chunk started from the write callback.
+ *
+ *  Only one context may call uart_log_write() at a time; callers that log
+ *  from several tasks must serialize around it.
+ */
+#ifndef UART_LOG_H_
+#define UART_LOG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ti/drivers/UART2.h>
+
+/* Ring buffer size in bytes, must be a power of two */
+#ifndef UART_LOG_BUF_SIZE
+    #define UART_LOG_BUF_SIZE 1024
+#endif
+
+/* Caller-owned buffers that can be queued with uart_log_writeExternal() */
+#ifndef UART_LOG_EXT_DEPTH
+    #define UART_LOG_EXT_DEPTH 2
+#endif
+
+typedef struct
+{
+    uint32_t bytesQueued;   /* Bytes accepted into the ring */
+    uint32_t bytesSent;     /* Bytes handed back by the write callback */
+    uint32_t dropped;       /* Messages discarded because the ring was full */
+    uint32_t highWater;     /* Largest ring fill level seen, in bytes */
+    uint32_t writeErrors;   /* Chunks UART2_write() refused, retried later */
+} UartLog_Stats;
+
+/* Attach the log to a UART2 handle opened in write callback mode */
+void uart_log_init(UART2_Handle handle);
+
+/* UART2 writeCallback; install in UART2_Params before UART2_open() */
+void uart_log_writeCallback(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status);
+
+/*
+ * Queue len bytes for output. Returns false, and counts a drop, when the
+ * whole message does not fit; partial messages are never queued.
+ */
+bool uart_log_write(const void *data, size_t len);
+
+/*
+ * Queue a caller-owned buffer for output without copying it. It is sent
+ * after everything already in the ring, and must stay untouched until
+ * uart_log_waitExternal() says it is done. Any bytes, including NUL, are
+ * sent as-is. Same producer rules as uart_log_write(). Returns false if
+ * UART_LOG_EXT_DEPTH buffers are already queued.
+ */
+bool uart_log_writeExternal(const void *data, size_t len);
+
+/*
+ * Block until no more than maxPending external buffers are still queued
+ * or in flight; buffers complete in the order they were queued. Must be
+ * called from task context.
+ */
+void uart_log_waitExternal(size_t maxPending);
+
+/*
+ * Stop starting new writes so another user can borrow the UART; a write
+ * already in flight completes. Producers can keep queueing meanwhile.
+ */
+void uart_log_suspend(void);
+
+void uart_log_resume(void);
+
+/* True while a write is in flight on the UART */
+bool uart_log_isBusy(void);
+
+/* Number of bytes queued but not yet sent */
+size_t uart_log_pending(void);
+
+void uart_log_getStats(UartLog_Stats *stats);
+
+#endif /* UART_LOG_H_ */
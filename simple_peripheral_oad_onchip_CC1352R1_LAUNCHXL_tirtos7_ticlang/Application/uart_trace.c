@@ -0,0 +1,194 @@
+/*
+ *  ======== uart_trace.c ========
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "test_uart.h"
+#include "uart_log.h"
+#include "uart_trace.h"
+
+#define UART_TRACE_MASK (UART_TRACE_DEPTH - 1)
+
+#if (UART_TRACE_DEPTH & UART_TRACE_MASK) != 0
+    #error "UART_TRACE_DEPTH must be a power of two"
+#endif
+
+static UartTrace_Buffer *traceBuffers[UART_TRACE_MAX_BUFFERS];
+
+/*
+ *  ======== uart_trace_countArgs ========
+ *  Number of arguments consumed by a format string. Only the conversion
+ *  characters are looked at, which is much cheaper than formatting.
+ */
+static uint_fast8_t uart_trace_countArgs(const char *fmt)
+{
+    uint_fast8_t n = 0;
+
+    while (*fmt)
+    {
+        if (*fmt++ != '%')
+        {
+            continue;
+        }
+        if (*fmt == '%')
+        {
+            fmt++;
+            continue;
+        }
+
+        /* Flags, width, precision and length up to the conversion letter */
+        while (*fmt && !((*fmt >= 'a' && *fmt <= 'z' && *fmt != 'h' && *fmt != 'l') ||
+                         (*fmt >= 'A' && *fmt <= 'Z')))
+        {
+            if (*fmt == '*')
+            {
+                n++;
+            }
+            fmt++;
+        }
+        if (*fmt)
+        {
+            fmt++;
+            n++;
+        }
+    }
+
+    return n;
+}
+
+int uart_trace_register(UartTrace_Buffer *buf)
+{
+    uintptr_t key;
+    int i;
+    int ret = -1;
+
+    buf->head         = 0;
+    buf->tail         = 0;
+    buf->dropped      = 0;
+    buf->dropReported = 0;
+
+    key = HwiP_disable();
+    for (i = 0; i < UART_TRACE_MAX_BUFFERS; i++)
+    {
+        if (traceBuffers[i] == NULL || traceBuffers[i] == buf)
+        {
+            traceBuffers[i] = buf;
+            ret             = 0;
+            break;
+        }
+    }
+    HwiP_restore(key);
+
+    return ret;
+}
+
+void uart_trace_vprintf(UartTrace_Buffer *buf, const char *fmt, va_list ap)
+{
+    uint32_t head = buf->head;
+    UartTrace_Record *rec;
+    uint_fast8_t nargs;
+    uint_fast8_t i;
+
+    if (head - buf->tail >= UART_TRACE_DEPTH)
+    {
+        buf->dropped++;
+        return;
+    }
+
+    rec      = &buf->rec[head & UART_TRACE_MASK];
+    rec->fmt = fmt;
+
+    nargs = uart_trace_countArgs(fmt);
+    if (nargs > UART_TRACE_MAX_ARGS)
+    {
+        nargs = UART_TRACE_MAX_ARGS;
+    }
+    for (i = 0; i < nargs; i++)
+    {
+        rec->args[i] = va_arg(ap, uint32_t);
+    }
+
+    /* Publish only after the record is complete */
+    __asm volatile("" ::: "memory");
+    buf->head = head + 1;
+}
+
+void uart_trace_printf(UartTrace_Buffer *buf, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    uart_trace_vprintf(buf, fmt, ap);
+    va_end(ap);
+}
+
+/*
+ *  ======== uart_trace_flush ========
+ *  Records are expanded by passing every stored argument; printf ignores
+ *  arguments beyond those the format uses, so unused slots are harmless.
+ */
+void uart_trace_flush(void)
+{
+    char line[UART_TRACE_LINE_SIZE];
+    UartTrace_Buffer *buf;
+    UartTrace_Record *rec;
+    uint32_t dropped;
+    int len;
+    int i;
+
+    for (i = 0; i < UART_TRACE_MAX_BUFFERS; i++)
+    {
+        buf = traceBuffers[i];
+        if (buf == NULL)
+        {
+            continue;
+        }
+
+        while (buf->tail != buf->head)
+        {
+            if (UART_LOG_BUF_SIZE - uart_log_pending() < UART_TRACE_LINE_SIZE)
+            {
+                /* Console is backed up, leave the rest for the next flush */
+                return;
+            }
+
+            rec = &buf->rec[buf->tail & UART_TRACE_MASK];
+            len = snprintf(line,
+                           sizeof(line),
+                           rec->fmt,
+                           rec->args[0],
+                           rec->args[1],
+                           rec->args[2],
+                           rec->args[3],
+                           rec->args[4],
+                           rec->args[5]);
+            buf->tail++;
+
+            if (len > 0)
+            {
+                if (len >= (int)sizeof(line))
+                {
+                    len = sizeof(line) - 1;
+                }
+                test_uart_print(line, len);
+            }
+        }
+
+        dropped = buf->dropped;
+        if (dropped != buf->dropReported)
+        {
+            len = snprintf(line,
+                           sizeof(line),
+                           "[trace: %lu dropped]\r\n",
+                           (unsigned long)(dropped - buf->dropReported));
+            buf->dropReported = dropped;
+            test_uart_print(line, len);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ *  ======== uart_trace.h ========
+ *  Deferred-format logging.
+ *
+ *  A trace call stores the format string pointer and its raw 32-bit
+ *  arguments in a buffer owned by the calling task; nothing is formatted
+ *  on the caller's time. uart_trace_flush(), run from a low priority
+ *  context, expands the records and hands the text to the console.
+ *
+ *  Supported conversions are those taking int, unsigned or pointer sized
+ *  arguments (%d %u %x %c %p %s, with flags, width and "*"). Strings passed
+ *  for %s are read at flush time, so they must outlive the record: string
+ *  literals and constant tables are fine, stack buffers are not.
+ */
+#ifndef UART_TRACE_H_
+#define UART_TRACE_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+
+/* Records per trace buffer, must be a power of two */
+#ifndef UART_TRACE_DEPTH
+    #define UART_TRACE_DEPTH 16
+#endif
+
+/* Arguments kept per record; extra arguments are discarded */
+#define UART_TRACE_MAX_ARGS 6
+
+/* Number of task buffers that can be registered */
+#ifndef UART_TRACE_MAX_BUFFERS
+    #define UART_TRACE_MAX_BUFFERS 4
+#endif
+
+/* Longest line produced by one record at flush time */
+#ifndef UART_TRACE_LINE_SIZE
+    #define UART_TRACE_LINE_SIZE 96
+#endif
+
+typedef struct
+{
+    const char *fmt;
+    uint32_t args[UART_TRACE_MAX_ARGS];
+} UartTrace_Record;
+
+/*
+ * One buffer per logging task. The owning task is the only producer and
+ * uart_trace_flush() the only consumer, so no locking is needed.
+ */
+typedef struct
+{
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t dropped;       /* Written by the producer only */
+    uint32_t dropReported;  /* Written by the flusher only */
+    UartTrace_Record rec[UART_TRACE_DEPTH];
+} UartTrace_Buffer;
+
+/* Register a task's buffer with the flusher; returns 0 on success */
+int uart_trace_register(UartTrace_Buffer *buf);
+
+void uart_trace_printf(UartTrace_Buffer *buf, const char *fmt, ...);
+
+void uart_trace_vprintf(UartTrace_Buffer *buf, const char *fmt, va_list ap);
+
+/* Expand queued records into the console for as long as it has room */
+void uart_trace_flush(void);
+
+#endif /* UART_TRACE_H_ */
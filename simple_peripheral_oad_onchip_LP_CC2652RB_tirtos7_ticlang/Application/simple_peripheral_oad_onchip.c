@@ -97,6 +97,7 @@
 
 #include "simple_peripheral_oad_onchip_menu.h"
 #include "simple_peripheral_oad_onchip.h"
+#include "conn_registry.h"
 
 // Used for imgHdr_t structure
 #include <common/cc26xx/oad/oad_image_header.h>
@@ -1927,51 +1928,46 @@ bool SimplePeripheral_doSelectConn(uint8_t index)
  */
 static uint8_t SimplePeripheral_addConn(uint16_t connHandle)
 {
-  uint8_t i;
   uint8_t status = bleNoResources;
 
-  // Try to find an available entry
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
+  // Take the lowest free entry
+  uint8_t i = conn_registry_add(connHandle);
+
+  if (i < MAX_NUM_BLE_CONNS)
   {
-    if (connList[i].connHandle == LINKDB_CONNHANDLE_INVALID)
-    {
 #ifdef DEFAULT_SEND_PARAM_UPDATE_REQ
-      spClockEventData_t *paramUpdateEventData;
+    spClockEventData_t *paramUpdateEventData;
 
-      // Allocate data to send through clock handler
-      paramUpdateEventData = ICall_malloc(sizeof(spClockEventData_t) +
-                                          sizeof (uint16_t));
-      if(paramUpdateEventData)
-      {
-        paramUpdateEventData->event = SP_SEND_PARAM_UPDATE_EVT;
-        *((uint16_t *)paramUpdateEventData->data) = connHandle;
+    // Allocate data to send through clock handler
+    paramUpdateEventData = ICall_malloc(sizeof(spClockEventData_t) +
+                                        sizeof (uint16_t));
+    if(paramUpdateEventData)
+    {
+      paramUpdateEventData->event = SP_SEND_PARAM_UPDATE_EVT;
+      *((uint16_t *)paramUpdateEventData->data) = connHandle;
 
-        // Create a clock object and start
-        connList[i].pUpdateClock
-          = (Clock_Struct*) ICall_malloc(sizeof(Clock_Struct));
+      // Create a clock object and start
+      connList[i].pUpdateClock
+        = (Clock_Struct*) ICall_malloc(sizeof(Clock_Struct));
 
-        if (connList[i].pUpdateClock)
-        {
-          Util_constructClock(connList[i].pUpdateClock,
-                              SimplePeripheral_clockHandler,
-                              SEND_PARAM_UPDATE_DELAY, 0, true,
-                              (UArg) paramUpdateEventData);
-        }
-      }
-      else
+      if (connList[i].pUpdateClock)
       {
-        status = bleMemAllocError;
+        Util_constructClock(connList[i].pUpdateClock,
+                            SimplePeripheral_clockHandler,
+                            SEND_PARAM_UPDATE_DELAY, 0, true,
+                            (UArg) paramUpdateEventData);
       }
+    }
+    else
+    {
+      status = bleMemAllocError;
+    }
 #endif
 
-      // Found available entry to put a new connection info in
-      connList[i].connHandle = connHandle;
+    connList[i].connHandle = connHandle;
 
-      // Set default PHY to 1M
-      connList[i].currPhy = HCI_PHY_1_MBPS;
-
-      break;
-    }
+    // Set default PHY to 1M
+    connList[i].currPhy = HCI_PHY_1_MBPS;
   }
 
   return status;
@@ -1987,17 +1983,7 @@ static uint8_t SimplePeripheral_addConn(uint16_t connHandle)
  */
 static uint8_t SimplePeripheral_getConnIndex(uint16_t connHandle)
 {
-  uint8_t i;
-
-  for (i = 0; i < MAX_NUM_BLE_CONNS; i++)
-  {
-    if (connList[i].connHandle == connHandle)
-    {
-      return i;
-    }
-  }
-
-  return(MAX_NUM_BLE_CONNS);
+  return conn_registry_find(connHandle);
 }
 
 /*********************************************************************
@@ -2016,13 +2002,17 @@ static uint8_t SimplePeripheral_clearConnListEntry(uint16_t connHandle)
 
   if(connHandle != LINKDB_CONNHANDLE_ALL)
   {
-    // Get connection index from handle
-    connIndex = SimplePeripheral_getConnIndex(connHandle);
+    // Release the connection index of the handle
+    connIndex = conn_registry_remove(connHandle);
     if(connIndex >= MAX_NUM_BLE_CONNS)
 	{
 	  return(bleInvalidRange);
 	}
   }
+  else
+  {
+    conn_registry_reset();
+  }
 
   // Clear specific handle or all handles
   for(i = 0; i < MAX_NUM_BLE_CONNS; i++)